@@ -12,14 +12,14 @@ out vec2 texCoord;
 uniform mat4 transform;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+#include "include/camera.glsl"
 
 void main()
 {
     // This is a predefined variable by OpenGL
     //gl_Position = transform * vec4(aPosition, 1.0);
-    gl_Position = projection * view * model * vec4(aPosition, 1.0);
+    gl_Position = projectionView * model * vec4(aPosition, 1.0);
     //gl_Position = vec4(position.x, -position.y, position.z, 1.0);
     //ourColor = aColor;
     texCoord = aTexCoord;
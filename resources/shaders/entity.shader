@@ -3,20 +3,29 @@
 
 // GLSL is the opengl shading language
 // gl_Position must be a vec4, and since we told OpenGL we are passing in a vec3, we do so here
-in vec3 position;
-in vec2 textureCoord;
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec2 textureCoord;
+
+#ifdef INSTANCED
+// The transform comes from a per-instance attribute so a whole batch of
+// entities sharing a model can be drawn in one call. A mat4 takes locations 2 to 5.
+layout(location = 2) in mat4 instanceTransform;
+#else
+uniform mat4 transform;
+#endif
 
 out vec2 pass_textureCoord;
 
-uniform mat4 transform;
-uniform mat4 projection;
-uniform mat4 view;
+#include "include/camera.glsl"
 
 void main()
 {
+#ifdef INSTANCED
+    mat4 transform = instanceTransform;
+#endif
     // This is a predefined variable by OpenGL
     //l_Position = vec4(position, 1.0);
-    gl_Position = projection * view * transform * vec4(position, 1.0);
+    gl_Position = projectionView * transform * vec4(position, 1.0);
     pass_textureCoord = textureCoord;
 };
 
@@ -32,4 +41,4 @@ uniform sampler2D modelTexture;
 void main()
 {
     fragColor = texture(modelTexture, pass_textureCoord);
-};
\ No newline at end of file
+};
@@ -0,0 +1,50 @@
+#shader vertex
+#version 460 core
+
+// Used by IndirectRenderer. Every draw of a multi-draw is one model, and every instance one entity.
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec2 textureCoord;
+
+// Where this draw's transforms start, indexed by gl_DrawID
+struct DrawData
+{
+    uint firstTransform;
+};
+
+layout(std430, binding = 1) readonly buffer Transforms
+{
+    mat4 transforms[];
+};
+
+layout(std430, binding = 2) readonly buffer DrawDataBuffer
+{
+    DrawData drawData[];
+};
+
+// gl_DrawID counts from 0 in each multi-draw, this is the first draw's index in drawData
+uniform int drawOffset;
+
+out vec2 pass_textureCoord;
+
+#include "include/camera.glsl"
+
+void main()
+{
+    mat4 transform = transforms[drawData[drawOffset + gl_DrawID].firstTransform + gl_InstanceID];
+    gl_Position = projectionView * transform * vec4(position, 1.0);
+    pass_textureCoord = textureCoord;
+};
+
+#shader fragment
+#version 460 core
+
+in vec2 pass_textureCoord;
+
+out vec4 fragColor;
+
+uniform sampler2D modelTexture;
+
+void main()
+{
+    fragColor = texture(modelTexture, pass_textureCoord);
+};
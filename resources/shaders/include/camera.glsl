@@ -0,0 +1,8 @@
+// Per-frame camera data, uploaded once by Renderer::prepare
+layout(std140) uniform CameraBlock
+{
+    mat4 projection;
+    mat4 view;
+    mat4 projectionView;
+    vec4 cameraPosition;
+};
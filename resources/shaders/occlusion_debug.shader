@@ -0,0 +1,34 @@
+#shader vertex
+#version 330 core
+
+// Quad in the bottom left corner of the screen, made from the vertex index
+out vec2 pass_textureCoord;
+
+void main()
+{
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    pass_textureCoord = corner;
+    gl_Position = vec4(corner * 0.8 - 1.0, 0.0, 1.0);
+};
+
+#shader fragment
+#version 330 core
+
+in vec2 pass_textureCoord;
+
+out vec4 fragColor;
+
+uniform sampler2D occlusionDepth;
+uniform float nearPlane;
+uniform float farPlane;
+
+void main()
+{
+    // Window depth is very non-linear, convert it back to view distance so walls at different ranges are distinguishable
+    float depth = texture(occlusionDepth, pass_textureCoord).r;
+    float ndc = depth * 2.0 - 1.0;
+    float distance = (2.0 * nearPlane * farPlane) / (farPlane + nearPlane - ndc * (farPlane - nearPlane));
+    // Close occluders bright, empty (far) pixels black
+    float shade = 1.0 - clamp(distance / farPlane, 0.0, 1.0);
+    fragColor = vec4(shade, shade * 0.6, 0.0, 1.0);
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include <cfloat>
+
+#include <glm/glm.hpp>
+
+// Axis aligned bounding box
+struct AABB
+{
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+
+	AABB() = default;
+	AABB(const glm::vec3& pMin, const glm::vec3& pMax) : min(pMin), max(pMax) {}
+
+	void grow(const glm::vec3& point) { min = glm::min(min, point); max = glm::max(max, point); }
+	void grow(const AABB& other) { min = glm::min(min, other.min); max = glm::max(max, other.max); }
+
+	bool isEmpty() const { return min.x > max.x; }
+	glm::vec3 center() const { return (min + max) * 0.5f; }
+	glm::vec3 extent() const { return max - min; }
+
+	// Half the surface area, all the SAH needs since only ratios matter
+	float halfArea() const
+	{
+		if (isEmpty())
+			return 0.0f;
+		glm::vec3 e = extent();
+		return e.x * e.y + e.y * e.z + e.z * e.x;
+	}
+
+	bool overlaps(const AABB& other) const
+	{
+		return min.x <= other.max.x && max.x >= other.min.x
+			&& min.y <= other.max.y && max.y >= other.min.y
+			&& min.z <= other.max.z && max.z >= other.min.z;
+	}
+
+	// Bounds of this box after transforming it. Same box as Arvo's method gives, from the center
+	// and half extent: the half extent along each axis is the sum of the absolute matrix columns
+	// scaled by it, about half the work of taking the min and max of every product.
+	AABB transformed(const glm::mat4& transform) const
+	{
+		glm::vec3 halfExtent = (max - min) * 0.5f;
+		glm::vec3 newCenter(transform * glm::vec4(center(), 1.0f));
+		glm::vec3 newHalfExtent = glm::abs(glm::vec3(transform[0])) * halfExtent.x
+			+ glm::abs(glm::vec3(transform[1])) * halfExtent.y
+			+ glm::abs(glm::vec3(transform[2])) * halfExtent.z;
+		return AABB(newCenter - newHalfExtent, newCenter + newHalfExtent);
+	}
+};
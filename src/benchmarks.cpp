@@ -0,0 +1,609 @@
+#include "benchmarks.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "bvh.h"
+#include "camera.h"
+#include "command_list.h"
+#include "components.h"
+#include "culling.h"
+#include "mesh_file.h"
+#include "mesh_importer.h"
+#include "mesh_optimizer.h"
+#include "mesh_data.h"
+#include "model.h"
+#include "obj_file.h"
+#include "systems.h"
+#include "thread_pool.h"
+
+// Runs function repeatedly for roughly the given time and returns the average milliseconds per run
+template<typename Function>
+static double timeAverage(Function function, double minimumMilliseconds = 200.0)
+{
+	auto start = std::chrono::steady_clock::now();
+	int runs = 0;
+	double elapsed = 0.0;
+	do
+	{
+		function();
+		runs++;
+		elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	} while (elapsed < minimumMilliseconds);
+	return elapsed / runs;
+}
+
+void runBenchmarks()
+{
+	for (size_t count : { 10000, 100000, 1000000 })
+		runCullingBenchmark(count);
+	for (size_t count : { 10000, 100000, 1000000 })
+		runBvhBenchmark(count);
+	runIndexOptimizerBenchmark();
+	runMeshLoadBenchmark();
+	runImporterBenchmark();
+	runEcsBenchmark(1000000);
+}
+
+void runCullingBenchmark(size_t entityCount)
+{
+	// Spheres scattered in a box around the default camera, a few percent end up visible
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+	size_t padded = (entityCount + FrustumCuller::BLOCK - 1) / FrustumCuller::BLOCK * FrustumCuller::BLOCK;
+	std::vector<float> x(padded), y(padded), z(padded), r(padded, -INFINITY);
+	for (size_t i = 0; i < entityCount; i++)
+	{
+		x[i] = position(random);
+		y[i] = position(random);
+		z[i] = position(random);
+		r[i] = size(random);
+	}
+	std::vector<uint32_t> visible(padded);
+
+	Camera camera;
+	Frustum frustum = camera.getFrustum(800.0f / 600.0f);
+
+	std::cout << "Frustum culling " << entityCount << " spheres:" << std::endl;
+
+	auto report = [&](const char* name, size_t(*kernel)(const float*, const float*, const float*, const float*, size_t, const Frustum&, uint32_t*))
+	{
+		size_t visibleCount = 0;
+		double milliseconds = timeAverage([&]() { visibleCount = kernel(x.data(), y.data(), z.data(), r.data(), padded, frustum, visible.data()); });
+		std::cout << "  " << name << ": " << visibleCount << " visible, " << entityCount - visibleCount << " culled, "
+			<< milliseconds * 1e6 / entityCount << " ns/entity" << std::endl;
+	};
+
+	report("scalar", FrustumCuller::cullScalar);
+	if (FrustumCuller::hasSSE())
+		report("SSE   ", FrustumCuller::cullSSE);
+	if (FrustumCuller::hasAVX2())
+		report("AVX2  ", FrustumCuller::cullAVX2);
+}
+
+void runBvhBenchmark(size_t entityCount)
+{
+	// Same kind of scene as the culling benchmark, boxes instead of spheres
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> size(0.1f, 2.0f);
+	std::uniform_real_distribution<float> jitter(-0.5f, 0.5f);
+
+	std::vector<AABB> bounds(entityCount);
+	for (AABB& box : bounds)
+	{
+		glm::vec3 center(position(random), position(random), position(random));
+		box = AABB(center - size(random), center + size(random));
+	}
+
+	ThreadPool threadPool;
+	BVH bvh;
+	Camera camera;
+	Frustum frustum = camera.getFrustum(800.0f / 600.0f);
+
+	std::cout << "BVH over " << entityCount << " boxes:" << std::endl;
+
+	double singleThreaded = timeAverage([&]() { bvh.build(bounds); });
+	double pooled = timeAverage([&]() { bvh.build(bounds, &threadPool); });
+	std::cout << "  build: " << singleThreaded << " ms on 1 thread, " << pooled << " ms on " << threadPool.threadCount() + 1
+		<< " threads, " << bvh.stats.nodeCount << " nodes, SAH cost " << bvh.cost() << std::endl;
+
+	// Every entity moves a little, as if they were all animated
+	std::vector<AABB> moved = bounds;
+	for (AABB& box : moved)
+	{
+		glm::vec3 offset(jitter(random), jitter(random), jitter(random));
+		box = AABB(box.min + offset, box.max + offset);
+	}
+	double refit = timeAverage([&]() { bvh.refit(moved); });
+	std::cout << "  refit all: " << refit << " ms, SAH cost after " << bvh.cost() << (bvh.needsRebuild() ? " (rebuild)" : "") << std::endl;
+
+	// A hundredth of them moves, the rest stays put
+	size_t movers = std::max<size_t>(entityCount / 100, 1);
+	double partialRefit = timeAverage([&]()
+		{
+			for (size_t i = 0; i < movers; i++)
+				bvh.update((uint32_t)(i * 97 % entityCount), moved[i * 97 % entityCount]);
+			bvh.refit();
+		});
+	std::cout << "  update + refit " << movers << ": " << partialRefit << " ms" << std::endl;
+
+	std::vector<uint32_t> results;
+	double frustumQuery = timeAverage([&]() { results.clear(); bvh.queryFrustum(frustum, results); });
+	std::cout << "  frustum query: " << frustumQuery << " ms, " << results.size() << " visible ("
+		<< frustumQuery * 1e6 / entityCount << " ns/entity)" << std::endl;
+
+	const int queryCount = 1000;
+	std::vector<glm::vec3> origins(queryCount), directions(queryCount);
+	for (int i = 0; i < queryCount; i++)
+	{
+		origins[i] = glm::vec3(position(random), position(random), position(random));
+		directions[i] = glm::normalize(glm::vec3(jitter(random), jitter(random), jitter(random)) + glm::vec3(1e-3f));
+	}
+
+	size_t hits = 0;
+	double rayQueries = timeAverage([&]()
+		{
+			hits = 0;
+			for (int i = 0; i < queryCount; i++)
+			{
+				results.clear();
+				bvh.queryRay(origins[i], directions[i], 50.0f, results);
+				hits += results.size();
+			}
+		});
+	std::cout << "  ray query: " << rayQueries * 1000.0 / queryCount << " us/ray, " << (double)hits / queryCount << " hits/ray" << std::endl;
+
+	double boxQueries = timeAverage([&]()
+		{
+			hits = 0;
+			for (int i = 0; i < queryCount; i++)
+			{
+				results.clear();
+				bvh.queryAABB(AABB(origins[i] - 5.0f, origins[i] + 5.0f), results);
+				hits += results.size();
+			}
+		});
+	std::cout << "  AABB query: " << boxQueries * 1000.0 / queryCount << " us/query, " << (double)hits / queryCount << " hits/query" << std::endl;
+}
+
+void runRecordingBenchmark(const std::vector<Entity>& entities, Shader& shader, const Camera& camera)
+{
+	std::vector<uint32_t> all(entities.size());
+	for (size_t i = 0; i < all.size(); i++)
+		all[i] = (uint32_t)i;
+	RenderQueue queue;
+
+	std::cout << "Recording " << entities.size() << " draws:" << std::endl;
+
+	double singleThreaded = 0.0;
+	for (unsigned int threads : { 1, 2, 4, 8, 16 })
+	{
+		// The caller takes part too, so a pool of n - 1 workers makes n threads.
+		// With one thread everything goes into a single slice and runs inline.
+		ThreadPool threadPool(std::max(1u, threads - 1));
+		CommandRecorder recorder(threadPool);
+		size_t slices = threads == 1 ? 1 : 0;
+
+		double milliseconds = timeAverage([&]() { recorder.record(entities, all, shader, camera, queue, slices); });
+		if (threads == 1)
+			singleThreaded = milliseconds;
+		std::cout << "  " << threads << " threads: " << milliseconds << " ms (record " << recorder.stats.recordMilliseconds
+			<< ", merge " << recorder.stats.mergeMilliseconds << ", sort " << recorder.stats.sortMilliseconds << "), "
+			<< singleThreaded / milliseconds << "x" << std::endl;
+	}
+}
+
+void runSubmissionBenchmark(Renderer& renderer, IndirectRenderer& indirectRenderer, std::vector<Entity>& entities,
+	Shader& shader, Shader& indirectShader, Camera& camera, Display& display)
+{
+	std::vector<uint32_t> all(entities.size());
+	for (size_t i = 0; i < all.size(); i++)
+		all[i] = (uint32_t)i;
+
+	std::cout << "Submitting " << entities.size() << " entities:" << std::endl;
+
+	// Frames aren't presented, glFinish stands in for the swap so the GPU time is included
+	auto report = [&](const char* name, auto submit)
+	{
+		const int frames = 50;
+		double submitMilliseconds = 0.0;
+		auto start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < frames; frame++)
+		{
+			renderer.prepare(camera, display);
+			auto submitStart = std::chrono::steady_clock::now();
+			submit();
+			submitMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - submitStart).count();
+			renderer.finishFrame();
+			glFinish();
+		}
+		double frameMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+		std::cout << "  " << name << ": submit " << submitMilliseconds / frames << " ms, frame " << frameMilliseconds << " ms" << std::endl;
+	};
+
+	unsigned int drawCalls = 0;
+	report("Renderer::render per entity", [&]()
+		{
+			for (Entity& entity : entities)
+				renderer.render(entity, shader);
+			drawCalls = renderer.stats.drawCalls;
+		});
+	std::cout << "    " << drawCalls << " draw calls" << std::endl;
+
+	report("IndirectRenderer          ", [&]() { indirectRenderer.render(entities, all, indirectShader); });
+	std::cout << "    " << indirectRenderer.stats.multiDrawCalls << " multi-draw calls, " << indirectRenderer.stats.drawCommands
+		<< " commands" << std::endl;
+}
+
+// UV sphere of radius 0.5, the seam column of vertices is duplicated so the uvs wrap
+static MeshData makeSphere(int rings, int segments)
+{
+	MeshData mesh;
+	for (int ring = 0; ring <= rings; ring++)
+	{
+		float theta = 3.14159265f * ring / rings;
+		for (int segment = 0; segment <= segments; segment++)
+		{
+			float phi = 2.0f * 3.14159265f * segment / segments;
+			mesh.positions.insert(mesh.positions.end(), { 0.5f * std::sin(theta) * std::cos(phi), 0.5f * std::cos(theta), 0.5f * std::sin(theta) * std::sin(phi) });
+			mesh.uvs.insert(mesh.uvs.end(), { (float)segment / segments, (float)ring / rings });
+		}
+	}
+	for (int ring = 0; ring < rings; ring++)
+	{
+		for (int segment = 0; segment < segments; segment++)
+		{
+			unsigned int a = ring * (segments + 1) + segment;
+			unsigned int b = a + segments + 1;
+			mesh.indices.insert(mesh.indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+		}
+	}
+	return mesh;
+}
+
+void runVertexFormatBenchmark(Renderer& renderer, Shader& shader, std::shared_ptr<Texture> texture, Camera& camera, Display& display)
+{
+	MeshData sphere = makeSphere(512, 1024);
+	std::cout << "Drawing 16 spheres of " << sphere.vertexCount() << " vertices, " << sphere.triangleCount() << " triangles:" << std::endl;
+
+	double baseline = 0.0;
+	for (VertexFormat format : { VERTEX_FORMAT_POSITION_UV, VERTEX_FORMAT_QUANTIZED })
+	{
+		Model model(texture, sphere.positions, sphere.uvs, sphere.indices, format);
+		std::vector<Entity> entities;
+		std::vector<uint32_t> all;
+		for (int i = 0; i < 16; i++)
+		{
+			entities.push_back(Entity(&model, glm::vec3((i % 4) - 1.5f, (i / 4) - 1.5f, -4.0f), 0.0f, 0.0f, 0.0f, 1.0f));
+			all.push_back((uint32_t)i);
+		}
+
+		// Frames aren't presented, glFinish stands in for the swap so the GPU time is included
+		const int frames = 50;
+		auto start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < frames; frame++)
+		{
+			renderer.prepare(camera, display);
+			renderer.renderInstanced(entities, all, shader);
+			renderer.finishFrame();
+			glFinish();
+		}
+		double frameMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+		if (baseline == 0.0)
+			baseline = frameMilliseconds;
+
+		unsigned int stride = vertexStride(format);
+		std::cout << "  " << (format == VERTEX_FORMAT_QUANTIZED ? "quantized  " : "float      ") << stride << " bytes/vertex, "
+			<< sphere.vertexCount() * stride / (1024.0 * 1024.0) << " MB of vertices, frame " << frameMilliseconds << " ms ("
+			<< (frameMilliseconds / baseline - 1.0) * 100.0 << "%)" << std::endl;
+	}
+}
+
+void runIndexOptimizerBenchmark()
+{
+	// A tidy row by row sphere, and the same triangles shuffled like an exporter that doesn't care
+	MeshData tidy = makeSphere(256, 512);
+	MeshData shuffled = tidy;
+	std::vector<size_t> triangles(shuffled.triangleCount());
+	for (size_t i = 0; i < triangles.size(); i++)
+		triangles[i] = i;
+	std::shuffle(triangles.begin(), triangles.end(), std::mt19937(1234));
+	for (size_t i = 0; i < triangles.size(); i++)
+		std::copy(&tidy.indices[triangles[i] * 3], &tidy.indices[triangles[i] * 3] + 3, &shuffled.indices[i * 3]);
+
+	auto print = [](const char* step, const MeshData& mesh)
+	{
+		VertexCacheStats fifo = MeshOptimizer::simulateFifo(mesh.indices, mesh.vertexCount());
+		VertexCacheStats lru = MeshOptimizer::simulateLru(mesh.indices, mesh.vertexCount());
+		std::cout << "    " << step << "FIFO ACMR " << fifo.acmr << " ATVR " << fifo.atvr << ", LRU ACMR " << lru.acmr << " ATVR " << lru.atvr << std::endl;
+	};
+	auto time = [](auto function)
+	{
+		auto start = std::chrono::steady_clock::now();
+		function();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	};
+
+	for (MeshData* mesh : { &tidy, &shuffled })
+	{
+		std::cout << "Optimizing " << (mesh == &tidy ? "row ordered" : "shuffled") << " sphere, " << mesh->triangleCount() << " triangles, cache size "
+			<< MeshOptimizer::CACHE_SIZE << ":" << std::endl;
+		print("source:         ", *mesh);
+		double cache = time([&]() { MeshOptimizer::optimizeVertexCache(mesh->indices, mesh->vertexCount()); });
+		print("vertex cache:   ", *mesh);
+		double overdraw = time([&]() { MeshOptimizer::optimizeOverdraw(mesh->indices, mesh->positions); });
+		print("overdraw:       ", *mesh);
+		double fetch = time([&]() { MeshOptimizer::optimizeVertexFetch(*mesh); });
+		std::cout << "    " << cache << " ms vertex cache, " << overdraw << " ms overdraw, " << fetch << " ms vertex fetch" << std::endl;
+	}
+}
+
+void runMeshLoadBenchmark()
+{
+	MeshData sphere = makeSphere(256, 512);
+	std::filesystem::path directory = std::filesystem::temp_directory_path();
+	std::string objPath = (directory / "mesh_load_benchmark.obj").string();
+	std::string meshPath = (directory / "mesh_load_benchmark.mesh").string();
+	MeshBounds bounds = computeMeshBounds(sphere.positions);
+	if (!saveObj(objPath, sphere) || !MeshFile::write(meshPath, VERTEX_FORMAT_POSITION_UV, bounds, { MeshFile::cook(sphere, VERTEX_FORMAT_POSITION_UV, bounds.min, bounds.max, 0.0f) }))
+		return;
+
+	// Both files were just written, so this measures parsing from the page cache, not the disk
+	std::cout << "Loading a sphere of " << sphere.vertexCount() << " vertices, " << sphere.triangleCount() << " triangles:" << std::endl;
+	size_t objBytes = (size_t)std::filesystem::file_size(objPath);
+	double obj = timeAverage([&]()
+	{
+		MeshData mesh;
+		loadObj(objPath, mesh);
+		MeshBounds meshBounds = computeMeshBounds(mesh.positions);
+		CookedLod lod = MeshFile::cook(std::move(mesh), VERTEX_FORMAT_POSITION_UV, meshBounds.min, meshBounds.max, 0.0f);
+	}, 1000.0);
+
+	size_t meshBytes = 0;
+	volatile unsigned int sink = 0;
+	double binary = timeAverage([&]()
+	{
+		MeshFile file;
+		if (!file.open(meshPath))
+			return;
+		meshBytes = file.size();
+		// Stands in for glBufferSubData reading the mapping, so every page is actually faulted in
+		const MeshFileLod& lod = file.getLod(0);
+		const unsigned int* words = (const unsigned int*)file.getVertices(0);
+		unsigned int sum = 0;
+		for (size_t i = 0; i < lod.vertexCount * vertexStride(file.getVertexFormat()) / sizeof(unsigned int); i++)
+			sum += words[i];
+		for (size_t i = 0; i < lod.indexCount; i++)
+			sum += file.getIndices(0)[i];
+		sink = sink + sum;
+	}, 1000.0);
+
+	auto report = [](const char* format, size_t bytes, double milliseconds)
+	{
+		std::cout << "    " << format << bytes / (1024.0 * 1024.0) << " MB, " << milliseconds << " ms, "
+			<< bytes / (1024.0 * 1024.0) / (milliseconds / 1000.0) << " MB/s" << std::endl;
+	};
+	report("OBJ, parsed and cooked:  ", objBytes, obj);
+	report("mesh file, mapped:       ", meshBytes, binary);
+	std::cout << "    " << obj / binary << "x faster" << std::endl;
+
+	std::remove(objPath.c_str());
+	std::remove(meshPath.c_str());
+}
+
+static std::string encodeBase64(const std::vector<unsigned char>& data)
+{
+	static const char* ALPHABET = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	std::string text;
+	text.reserve((data.size() + 2) / 3 * 4);
+	for (size_t i = 0; i < data.size(); i += 3)
+	{
+		uint32_t bits = data[i] << 16;
+		if (i + 1 < data.size())
+			bits |= data[i + 1] << 8;
+		if (i + 2 < data.size())
+			bits |= data[i + 2];
+		text += ALPHABET[(bits >> 18) & 63];
+		text += ALPHABET[(bits >> 12) & 63];
+		text += i + 1 < data.size() ? ALPHABET[(bits >> 6) & 63] : '=';
+		text += i + 2 < data.size() ? ALPHABET[bits & 63] : '=';
+	}
+	return text;
+}
+
+// Just the one mesh, as a .glb or as a .gltf with the buffer embedded as base64
+static bool saveGltf(const std::string& path, const MeshData& mesh, bool binary)
+{
+	size_t positionBytes = mesh.positions.size() * sizeof(float);
+	size_t uvBytes = mesh.uvs.size() * sizeof(float);
+	size_t indexBytes = mesh.indices.size() * sizeof(unsigned int);
+	std::vector<unsigned char> buffer(positionBytes + uvBytes + indexBytes);
+	std::memcpy(buffer.data(), mesh.positions.data(), positionBytes);
+	std::memcpy(buffer.data() + positionBytes, mesh.uvs.data(), uvBytes);
+	std::memcpy(buffer.data() + positionBytes + uvBytes, mesh.indices.data(), indexBytes);
+
+	std::string json = "{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"byteLength\":" + std::to_string(buffer.size());
+	if (!binary)
+		json += ",\"uri\":\"data:application/octet-stream;base64," + encodeBase64(buffer) + "\"";
+	json += "}],\"bufferViews\":["
+		"{\"buffer\":0,\"byteOffset\":0,\"byteLength\":" + std::to_string(positionBytes) + "},"
+		"{\"buffer\":0,\"byteOffset\":" + std::to_string(positionBytes) + ",\"byteLength\":" + std::to_string(uvBytes) + "},"
+		"{\"buffer\":0,\"byteOffset\":" + std::to_string(positionBytes + uvBytes) + ",\"byteLength\":" + std::to_string(indexBytes) + "}],"
+		"\"accessors\":["
+		"{\"bufferView\":0,\"componentType\":5126,\"count\":" + std::to_string(mesh.vertexCount()) + ",\"type\":\"VEC3\"},"
+		"{\"bufferView\":1,\"componentType\":5126,\"count\":" + std::to_string(mesh.vertexCount()) + ",\"type\":\"VEC2\"},"
+		"{\"bufferView\":2,\"componentType\":5125,\"count\":" + std::to_string(mesh.indices.size()) + ",\"type\":\"SCALAR\"}],"
+		"\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"TEXCOORD_0\":1},\"indices\":2}]}],"
+		"\"nodes\":[{\"mesh\":0}],\"scenes\":[{\"nodes\":[0]}],\"scene\":0}";
+
+	std::ofstream file(path, std::ios::binary);
+	if (!binary)
+	{
+		file << json;
+		return (bool)file;
+	}
+
+	// Chunks are padded to 4 bytes, JSON with spaces and the binary chunk with zeros
+	json.resize((json.size() + 3) / 4 * 4, ' ');
+	buffer.resize((buffer.size() + 3) / 4 * 4, 0);
+	uint32_t header[3] = { 0x46546C67, 2, (uint32_t)(12 + 8 + json.size() + 8 + buffer.size()) };
+	uint32_t jsonChunk[2] = { (uint32_t)json.size(), 0x4E4F534A };
+	uint32_t binaryChunk[2] = { (uint32_t)buffer.size(), 0x004E4942 };
+	file.write((const char*)header, sizeof(header));
+	file.write((const char*)jsonChunk, sizeof(jsonChunk));
+	file.write(json.data(), json.size());
+	file.write((const char*)binaryChunk, sizeof(binaryChunk));
+	file.write((const char*)buffer.data(), buffer.size());
+	return (bool)file;
+}
+
+void runImporterBenchmark()
+{
+	MeshData sphere = makeSphere(1024, 2048);
+	std::filesystem::path directory = std::filesystem::temp_directory_path();
+	std::string paths[] = {
+		(directory / "importer_benchmark.obj").string(),
+		(directory / "importer_benchmark.glb").string(),
+		(directory / "importer_benchmark.gltf").string()
+	};
+	if (!saveObj(paths[0], sphere) || !saveGltf(paths[1], sphere, true) || !saveGltf(paths[2], sphere, false))
+		return;
+
+	// Every file was just written, so this measures parsing from the page cache, not the disk
+	std::cout << "Importing a sphere of " << sphere.vertexCount() << " vertices, " << sphere.triangleCount() << " triangles:" << std::endl;
+	ThreadPool threadPool;
+	for (const std::string& path : paths)
+	{
+		double megabytes = std::filesystem::file_size(path) / (1024.0 * 1024.0);
+		std::cout << "    " << std::filesystem::path(path).extension().string() << ", " << megabytes << " MB:";
+		for (ThreadPool* pool : { (ThreadPool*)nullptr, &threadPool })
+		{
+			MeshData mesh;
+			auto start = std::chrono::steady_clock::now();
+			bool imported = importMesh(path, mesh, pool);
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			if (!imported || mesh.triangleCount() != sphere.triangleCount())
+				std::cout << " FAILED";
+			std::cout << " " << (pool ? pool->threadCount() + 1 : 1) << " thread(s) " << seconds * 1000.0 << " ms, " << megabytes / seconds << " MB/s;";
+		}
+		std::cout << std::endl;
+		std::remove(path.c_str());
+	}
+}
+
+// Laid out like Entity was before the World: the model pointer, both rotation representations
+// and three vectors nothing used, 128 bytes of which a frame reads 28
+struct LegacyEntity
+{
+	Model* model;
+	glm::vec3 rotation;
+	glm::vec3 position;
+	float rotationX, rotationY, rotationZ;
+	float scale;
+	unsigned int lod = 0;
+	std::vector<float> vertex_positions;
+	std::vector<float> vertex_texture_uvs;
+	std::vector<unsigned int> vertex_indices;
+};
+
+void runEcsBenchmark(size_t entityCount)
+{
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> speed(-90.0f, 90.0f);
+	AABB cube(glm::vec3(-0.5f), glm::vec3(0.5f));
+
+	std::cout << "Updating " << entityCount << " entities (animation, transform, bounds, render extraction):" << std::endl;
+
+	// The old way: the objects copied by value once a frame and the transform rebuilt from
+	// three matrix products, like Renderer::createTransformationMatrix did
+	std::vector<LegacyEntity> legacy(entityCount);
+	for (size_t i = 0; i < entityCount; i++)
+	{
+		legacy[i].position = glm::vec3(position(random), position(random), position(random));
+		legacy[i].rotationX = legacy[i].rotationY = 45.0f;
+		legacy[i].rotationZ = 0.0f;
+		legacy[i].rotation = glm::vec3(45.0f, 45.0f, 0.0f);
+		legacy[i].scale = 0.5f;
+	}
+	std::vector<AABB> legacyBounds(entityCount);
+	float time = 0.0f;
+	double legacyFrame = timeAverage([&]()
+	{
+		time += 0.016f;
+		for (size_t i = 0; i < entityCount; i++)
+			legacy[i].rotationZ = time * 20.0f * (i % 64);
+		size_t i = 0;
+		for (LegacyEntity entity : legacy)
+		{
+			glm::mat4 translate = glm::translate(glm::mat4(1.0f), entity.position);
+			glm::mat4 rotation = glm::mat4_cast(glm::quat(glm::radians(glm::vec3(entity.rotationX, entity.rotationY, entity.rotationZ))));
+			glm::mat4 scale = glm::scale(glm::mat4(1.0f), glm::vec3(entity.scale));
+			legacyBounds[i++] = cube.transformed(translate * rotation * scale);
+		}
+	}, 1000.0);
+	legacy = std::vector<LegacyEntity>();
+
+	World world;
+	const glm::quat tilt(glm::radians(glm::vec3(45.0f, 45.0f, 0.0f)));
+	std::vector<EntityHandle> handles(entityCount);
+	auto spawn = [&]()
+	{
+		glm::vec3 at(position(random), position(random), position(random));
+		return world.create(Position{ at }, Rotation{ tilt }, Scale{ 0.5f }, LocalToWorld{},
+			LocalBounds{ cube }, WorldBounds{}, Renderable{ nullptr }, LodLevel{ 0 }, Spin{ tilt, speed(random) });
+	};
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < entityCount; i++)
+		handles[i] = spawn();
+	double createMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	RenderList list;
+	double animation = timeAverage([&]() { time += 0.016f; AnimationSystem::update(world, time); }, 500.0);
+	double transform = timeAverage([&]() { TransformSystem::update(world); }, 1000.0);
+	double extraction = timeAverage([&]() { RenderExtractionSystem::extract(world, list); }, 1000.0);
+
+	auto report = [&](const char* name, double milliseconds)
+	{
+		std::cout << "  " << name << milliseconds << " ms, " << milliseconds * 1e6 / entityCount << " ns/entity" << std::endl;
+	};
+	std::cout << "  " << world.chunkCount() << " chunks of " << World::CHUNK_SIZE / 1024 << " KB" << std::endl;
+	report("create:                ", createMilliseconds);
+	report("AnimationSystem:       ", animation);
+	report("TransformSystem:       ", transform);
+	report("RenderExtractionSystem:", extraction);
+	report("World, whole frame:    ", animation + transform + extraction);
+	report("copied objects (old):  ", legacyFrame);
+	std::cout << "    " << legacyFrame / (animation + transform) << "x faster without extraction" << std::endl;
+
+	// Churn: destroy every other entity and fill the holes again. The old handles must go stale
+	// even though their slots get reused.
+	start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < entityCount; i += 2)
+		world.destroy(handles[i]);
+	double destroyMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::vector<EntityHandle> stale(handles.begin(), handles.end());
+	for (size_t i = 0; i < entityCount; i += 2)
+		handles[i] = spawn();
+	size_t staleAlive = 0;
+	for (size_t i = 0; i < entityCount; i += 2)
+		staleAlive += world.isAlive(stale[i]) ? 1 : 0;
+	report("destroy half:          ", destroyMilliseconds);
+	std::cout << "  " << world.size() << " alive after refilling, " << staleAlive << " stale handles still resolving" << std::endl;
+}
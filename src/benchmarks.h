@@ -0,0 +1,42 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+#include "camera.h"
+#include "display.h"
+#include "entity.h"
+#include "indirect_renderer.h"
+#include "renderer.h"
+#include "shader_s.h"
+#include "texture.h"
+
+// CPU-side benchmarks that don't need a window or GL context.
+// Enabled with RUN_BENCHMARKS in main.cpp, results go to std::cout.
+void runBenchmarks();
+
+void runCullingBenchmark(size_t entityCount);
+void runBvhBenchmark(size_t entityCount);
+// Reports simulated vertex cache efficiency of a sphere's indices before and after each MeshOptimizer step
+void runIndexOptimizerBenchmark();
+// Time from file to GPU-ready geometry for a sphere saved as OBJ (parse, optimize, encode) and
+// as a binary mesh file (map, validate, read every byte like the upload would)
+void runMeshLoadBenchmark();
+// Imports a sphere of about 4 million triangles saved as OBJ, .glb and .gltf with embedded
+// buffers (a few hundred MB each) on one thread and on the pool, and reports MB/s
+void runImporterBenchmark();
+// Animation, transform and render extraction over a World of entityCount entities, against the
+// same work on Entity-like objects copied by value, plus creating and destroying entities
+void runEcsBenchmark(size_t entityCount);
+
+// Command list recording at 1 to 16 threads. Needs a real shader and models to record
+// against, so main runs it after setting up the scene instead of from runBenchmarks.
+void runRecordingBenchmark(const std::vector<Entity>& entities, Shader& shader, const Camera& camera);
+
+// Draws every entity with one Renderer::render per entity, then with IndirectRenderer, and
+// reports CPU submission time and time until the GPU is done. Needs the GL context, run from main.
+void runSubmissionBenchmark(Renderer& renderer, IndirectRenderer& indirectRenderer, std::vector<Entity>& entities,
+	Shader& shader, Shader& indirectShader, Camera& camera, Display& display);
+
+// Draws a grid of copies of a dense sphere (about a million triangles) stored in each vertex
+// format and reports bytes per vertex and frame time. Needs the GL context, run from main.
+void runVertexFormatBenchmark(Renderer& renderer, Shader& shader, std::shared_ptr<Texture> texture, Camera& camera, Display& display);
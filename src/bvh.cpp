@@ -0,0 +1,388 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <chrono>
+
+// Below this many items a subtree is built on the current thread,
+// handing it to the pool costs more than it saves
+static const uint32_t PARALLEL_BUILD_THRESHOLD = 4096;
+
+void BVH::build(const std::vector<AABB>& itemBounds, ThreadPool* threadPool)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	items = itemBounds;
+	uint32_t count = (uint32_t)items.size();
+
+	itemOrder.resize(count);
+	for (uint32_t i = 0; i < count; i++)
+		itemOrder[i] = i;
+	itemLeaf.assign(count, 0);
+
+	std::vector<glm::vec3> centroids(count);
+	for (uint32_t i = 0; i < count; i++)
+		centroids[i] = items[i].center();
+
+	// A binary tree with at least one item per leaf never has more than 2n - 1 nodes.
+	// Children are allocated in pairs, so a child always comes after its parent.
+	nodes.resize(std::max(2 * count, 1u));
+	nodeCount = 1;
+	nodes[0].parent = UINT32_MAX;
+	buildNode(0, 0, count, 0, centroids, threadPool);
+	nodes.resize(nodeCount);
+
+	dirty.assign(nodes.size(), 0);
+	anyDirty = false;
+	builtCost = cost();
+
+	stats.nodeCount = nodes.size();
+	stats.buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void BVH::makeLeaf(uint32_t nodeIndex, uint32_t first, uint32_t count)
+{
+	Node& node = nodes[nodeIndex];
+	node.first = first;
+	node.count = count;
+	for (uint32_t i = first; i < first + count; i++)
+		itemLeaf[itemOrder[i]] = nodeIndex;
+}
+
+void BVH::buildNode(uint32_t nodeIndex, uint32_t first, uint32_t count, int depth, const std::vector<glm::vec3>& centroids, ThreadPool* threadPool)
+{
+	Node& node = nodes[nodeIndex];
+	node.bounds = AABB();
+	AABB centroidBounds;
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		node.bounds.grow(items[itemOrder[i]]);
+		centroidBounds.grow(centroids[itemOrder[i]]);
+	}
+
+	if (count <= 1 || depth >= MAX_DEPTH)
+	{
+		makeLeaf(nodeIndex, first, count);
+		return;
+	}
+
+	// Binned SAH: drop the centroids into bins along each axis and try every plane between bins
+	int bestAxis = -1;
+	int bestSplit = 0;
+	float bestCost = FLT_MAX;
+	glm::vec3 centroidExtent = centroidBounds.extent();
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (centroidExtent[axis] <= 0.0f)
+			continue;
+
+		AABB binBounds[BIN_COUNT];
+		uint32_t binCount[BIN_COUNT] = {};
+		float scale = BIN_COUNT / centroidExtent[axis];
+		for (uint32_t i = first; i < first + count; i++)
+		{
+			uint32_t item = itemOrder[i];
+			int bin = std::min(BIN_COUNT - 1, (int)((centroids[item][axis] - centroidBounds.min[axis]) * scale));
+			binBounds[bin].grow(items[item]);
+			binCount[bin]++;
+		}
+
+		// Sweep from the right to get the cost of everything right of each plane, then from the left
+		float rightArea[BIN_COUNT];
+		uint32_t rightCount[BIN_COUNT];
+		AABB accumulated;
+		uint32_t accumulatedCount = 0;
+		for (int bin = BIN_COUNT - 1; bin > 0; bin--)
+		{
+			accumulated.grow(binBounds[bin]);
+			accumulatedCount += binCount[bin];
+			rightArea[bin] = accumulated.halfArea();
+			rightCount[bin] = accumulatedCount;
+		}
+
+		accumulated = AABB();
+		accumulatedCount = 0;
+		for (int split = 1; split < BIN_COUNT; split++)
+		{
+			accumulated.grow(binBounds[split - 1]);
+			accumulatedCount += binCount[split - 1];
+			if (accumulatedCount == 0 || rightCount[split] == 0)
+				continue;
+
+			float splitCost = accumulated.halfArea() * accumulatedCount + rightArea[split] * rightCount[split];
+			if (splitCost < bestCost)
+			{
+				bestCost = splitCost;
+				bestAxis = axis;
+				bestSplit = split;
+			}
+		}
+	}
+
+	uint32_t leftCount;
+	if (bestAxis >= 0)
+	{
+		// Splitting costs one extra traversal step, which is about as expensive as testing an item
+		float leafCost = node.bounds.halfArea() * count;
+		float splitCost = node.bounds.halfArea() + bestCost;
+		if (count <= MAX_LEAF_SIZE && leafCost <= splitCost)
+		{
+			makeLeaf(nodeIndex, first, count);
+			return;
+		}
+
+		float scale = BIN_COUNT / centroidExtent[bestAxis];
+		float minimum = centroidBounds.min[bestAxis];
+		uint32_t* middle = std::partition(&itemOrder[first], &itemOrder[first] + count, [&](uint32_t item)
+			{
+				int bin = std::min(BIN_COUNT - 1, (int)((centroids[item][bestAxis] - minimum) * scale));
+				return bin < bestSplit;
+			});
+		leftCount = (uint32_t)(middle - &itemOrder[first]);
+	}
+	else if (count <= MAX_LEAF_SIZE)
+	{
+		makeLeaf(nodeIndex, first, count);
+		return;
+	}
+	else
+	{
+		// Every centroid is in the same spot, no plane separates them so just halve the range
+		leftCount = count / 2;
+	}
+
+	uint32_t left = nodeCount.fetch_add(2);
+	node.first = left;
+	node.count = 0;
+	nodes[left].parent = nodeIndex;
+	nodes[left + 1].parent = nodeIndex;
+
+	uint32_t rightCountTotal = count - leftCount;
+	if (threadPool && count >= PARALLEL_BUILD_THRESHOLD)
+	{
+		threadPool->parallelFor(2, 1, [&](size_t begin, size_t end)
+			{
+				for (size_t child = begin; child < end; child++)
+				{
+					if (child == 0)
+						buildNode(left, first, leftCount, depth + 1, centroids, threadPool);
+					else
+						buildNode(left + 1, first + leftCount, rightCountTotal, depth + 1, centroids, threadPool);
+				}
+			});
+	}
+	else
+	{
+		buildNode(left, first, leftCount, depth + 1, centroids, threadPool);
+		buildNode(left + 1, first + leftCount, rightCountTotal, depth + 1, centroids, threadPool);
+	}
+}
+
+void BVH::update(uint32_t item, const AABB& bounds)
+{
+	items[item] = bounds;
+	// Stop at the first node that's already marked, everything above it is marked too
+	for (uint32_t node = itemLeaf[item]; node != UINT32_MAX && !dirty[node]; node = nodes[node].parent)
+		dirty[node] = 1;
+	anyDirty = true;
+}
+
+void BVH::refit()
+{
+	if (!anyDirty || items.empty())
+		return;
+	auto start = std::chrono::steady_clock::now();
+
+	// Children always have a higher index than their parent, so walking backwards refits bottom up
+	for (size_t i = nodes.size(); i-- > 0;)
+	{
+		if (!dirty[i])
+			continue;
+		dirty[i] = 0;
+
+		Node& node = nodes[i];
+		node.bounds = AABB();
+		if (node.count > 0)
+		{
+			for (uint32_t j = node.first; j < node.first + node.count; j++)
+				node.bounds.grow(items[itemOrder[j]]);
+		}
+		else
+		{
+			node.bounds.grow(nodes[node.first].bounds);
+			node.bounds.grow(nodes[node.first + 1].bounds);
+		}
+	}
+	anyDirty = false;
+
+	stats.refitMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void BVH::refit(const std::vector<AABB>& itemBounds)
+{
+	items = itemBounds;
+	std::fill(dirty.begin(), dirty.end(), 1);
+	anyDirty = true;
+	refit();
+}
+
+float BVH::cost() const
+{
+	if (nodes.empty() || items.empty())
+		return 0.0f;
+
+	float total = 0.0f;
+	for (const Node& node : nodes)
+		total += node.bounds.halfArea() * (node.count > 0 ? node.count : 1);
+
+	float rootArea = nodes[0].bounds.halfArea();
+	return rootArea > 0.0f ? total / rootArea : 0.0f;
+}
+
+bool BVH::needsRebuild() const
+{
+	return !nodes.empty() && cost() > builtCost * REBUILD_THRESHOLD;
+}
+
+void BVH::collect(uint32_t nodeIndex, std::vector<uint32_t>& out) const
+{
+	uint32_t stack[MAX_DEPTH + 2];
+	int stackSize = 0;
+	stack[stackSize++] = nodeIndex;
+	while (stackSize > 0)
+	{
+		const Node& node = nodes[stack[--stackSize]];
+		if (node.count > 0)
+		{
+			out.insert(out.end(), &itemOrder[node.first], &itemOrder[node.first] + node.count);
+			continue;
+		}
+		stack[stackSize++] = node.first;
+		stack[stackSize++] = node.first + 1;
+	}
+}
+
+void BVH::queryFrustum(const Frustum& frustum, std::vector<uint32_t>& out) const
+{
+	if (nodes.empty() || items.empty())
+		return;
+
+	uint32_t stack[MAX_DEPTH + 2];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		uint32_t nodeIndex = stack[--stackSize];
+		const Node& node = nodes[nodeIndex];
+
+		// For each plane test the corner furthest along the normal (fully outside when that's behind)
+		// and the nearest corner (straddling when that's behind)
+		bool outside = false;
+		bool straddling = false;
+		for (const Plane& plane : frustum.planes)
+		{
+			glm::vec3 positive = glm::mix(node.bounds.min, node.bounds.max, glm::greaterThanEqual(plane.normal, glm::vec3(0.0f)));
+			glm::vec3 negative = glm::mix(node.bounds.max, node.bounds.min, glm::greaterThanEqual(plane.normal, glm::vec3(0.0f)));
+			if (glm::dot(plane.normal, positive) + plane.distance < 0.0f)
+			{
+				outside = true;
+				break;
+			}
+			if (glm::dot(plane.normal, negative) + plane.distance < 0.0f)
+				straddling = true;
+		}
+		if (outside)
+			continue;
+
+		if (!straddling)
+		{
+			// The whole subtree is inside, no need to test anything below
+			collect(nodeIndex, out);
+			continue;
+		}
+
+		if (node.count > 0)
+		{
+			for (uint32_t i = node.first; i < node.first + node.count; i++)
+			{
+				const AABB& bounds = items[itemOrder[i]];
+				if (frustum.intersectsAABB(bounds.min, bounds.max))
+					out.push_back(itemOrder[i]);
+			}
+			continue;
+		}
+		stack[stackSize++] = node.first;
+		stack[stackSize++] = node.first + 1;
+	}
+}
+
+void BVH::queryAABB(const AABB& box, std::vector<uint32_t>& out) const
+{
+	if (nodes.empty() || items.empty())
+		return;
+
+	uint32_t stack[MAX_DEPTH + 2];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		const Node& node = nodes[stack[--stackSize]];
+		if (!node.bounds.overlaps(box))
+			continue;
+
+		if (node.count > 0)
+		{
+			for (uint32_t i = node.first; i < node.first + node.count; i++)
+			{
+				if (items[itemOrder[i]].overlaps(box))
+					out.push_back(itemOrder[i]);
+			}
+			continue;
+		}
+		stack[stackSize++] = node.first;
+		stack[stackSize++] = node.first + 1;
+	}
+}
+
+// Slab test, true when the ray enters the box somewhere in [0, maxDistance]
+static bool rayIntersectsAABB(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, const AABB& box)
+{
+	glm::vec3 t0 = (box.min - origin) * inverseDirection;
+	glm::vec3 t1 = (box.max - origin) * inverseDirection;
+	glm::vec3 tNear = glm::min(t0, t1);
+	glm::vec3 tFar = glm::max(t0, t1);
+	float enter = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+	float exit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, maxDistance));
+	return enter <= exit;
+}
+
+void BVH::queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<uint32_t>& out) const
+{
+	if (nodes.empty() || items.empty())
+		return;
+
+	// Division by zero gives infinity, which the slab test handles fine
+	glm::vec3 inverseDirection = 1.0f / direction;
+
+	uint32_t stack[MAX_DEPTH + 2];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		const Node& node = nodes[stack[--stackSize]];
+		if (!rayIntersectsAABB(origin, inverseDirection, maxDistance, node.bounds))
+			continue;
+
+		if (node.count > 0)
+		{
+			for (uint32_t i = node.first; i < node.first + node.count; i++)
+			{
+				if (rayIntersectsAABB(origin, inverseDirection, maxDistance, items[itemOrder[i]]))
+					out.push_back(itemOrder[i]);
+			}
+			continue;
+		}
+		stack[stackSize++] = node.first;
+		stack[stackSize++] = node.first + 1;
+	}
+}
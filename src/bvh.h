@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "aabb.h"
+#include "frustum.h"
+#include "thread_pool.h"
+
+// Bounding volume hierarchy over a set of items (e.g. entities), each identified by its
+// index in the bounds array passed to build(). Built top down with binned SAH splits,
+// subtrees are built in parallel when a thread pool is given.
+// Moving items are handled by refitting the existing tree, which keeps queries correct
+// but slowly degrades quality; needsRebuild() says when it's worth building again.
+class BVH
+{
+public:
+	struct Node
+	{
+		AABB bounds;
+		// Leaf: first entry in itemOrder. Inner node: index of the left child, the right child follows it.
+		uint32_t first;
+		// Items in a leaf, 0 for inner nodes
+		uint32_t count;
+		uint32_t parent;
+	};
+
+	struct Stats
+	{
+		double buildMilliseconds = 0.0;
+		double refitMilliseconds = 0.0;
+		size_t nodeCount = 0;
+	};
+
+	static const uint32_t MAX_LEAF_SIZE = 4;
+	static const int BIN_COUNT = 16;
+	// Nodes deeper than this become leaves, which bounds the traversal stacks
+	static const int MAX_DEPTH = 60;
+	// needsRebuild() once the tree got this much worse than when it was built
+	static constexpr float REBUILD_THRESHOLD = 1.5f;
+
+	Stats stats;
+
+	BVH() = default;
+	BVH(const BVH&) = delete;
+	BVH& operator=(const BVH&) = delete;
+
+	void build(const std::vector<AABB>& itemBounds, ThreadPool* threadPool = nullptr);
+
+	// Moves one item. Only marks its path to the root, call refit() before querying.
+	void update(uint32_t item, const AABB& bounds);
+	// Recomputes the bounds of every node touched by update() since the last refit
+	void refit();
+	// Replaces the bounds of every item and refits the whole tree (same item count as the build)
+	void refit(const std::vector<AABB>& itemBounds);
+
+	// Surface area heuristic cost of the tree relative to its root
+	float cost() const;
+	bool needsRebuild() const;
+
+	// Append the indices of the items whose bounds pass the test
+	void queryFrustum(const Frustum& frustum, std::vector<uint32_t>& out) const;
+	void queryAABB(const AABB& box, std::vector<uint32_t>& out) const;
+	void queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<uint32_t>& out) const;
+
+	size_t itemCount() const { return items.size(); }
+	const std::vector<Node>& getNodes() const { return nodes; }
+
+private:
+	std::vector<Node> nodes;
+	std::atomic<uint32_t> nodeCount{ 0 };
+
+	std::vector<AABB> items;
+	// Item indices, grouped so each leaf owns a contiguous range
+	std::vector<uint32_t> itemOrder;
+	std::vector<uint32_t> itemLeaf;
+
+	std::vector<uint8_t> dirty;
+	bool anyDirty = false;
+	float builtCost = 0.0f;
+
+	void buildNode(uint32_t nodeIndex, uint32_t first, uint32_t count, int depth, const std::vector<glm::vec3>& centroids, ThreadPool* threadPool);
+	void makeLeaf(uint32_t nodeIndex, uint32_t first, uint32_t count);
+	// Adds every item below the node without testing
+	void collect(uint32_t nodeIndex, std::vector<uint32_t>& out) const;
+};
@@ -20,3 +20,18 @@ void Camera::adjustFront(float yaw, float pitch, float roll)
     direction.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
     cameraFront = glm::normalize(direction);
 }
+
+glm::mat4 Camera::getViewMatrix() const
+{
+    return glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+}
+
+glm::mat4 Camera::getProjectionMatrix(float aspectRatio) const
+{
+    return glm::perspective(glm::radians(FOV), aspectRatio, NEAR_PLANE, FAR_PLANE);
+}
+
+Frustum Camera::getFrustum(float aspectRatio) const
+{
+    return Frustum::fromMatrix(getProjectionMatrix(aspectRatio) * getViewMatrix());
+}
@@ -2,6 +2,8 @@
 
 #include <glm/glm.hpp>
 
+#include "frustum.h"
+
 class Camera
 {
 public:
@@ -16,4 +18,8 @@ public:
 	Camera();
 
     void adjustFront(float yaw, float pitch, float roll);
+
+    glm::mat4 getViewMatrix() const;
+    glm::mat4 getProjectionMatrix(float aspectRatio) const;
+    Frustum getFrustum(float aspectRatio) const;
 };
\ No newline at end of file
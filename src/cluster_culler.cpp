@@ -0,0 +1,86 @@
+#include "cluster_culler.h"
+
+#include <chrono>
+
+#include "frustum.h"
+#include "geometry_pool.h"
+#include "meshlet_builder.h"
+
+void ClusterDrawList::clear()
+{
+	batches.clear();
+	commands.clear();
+	transforms.clear();
+}
+
+void ClusterCuller::cull(const std::vector<Entity>& entities, const std::vector<uint32_t>& visible, const Camera& camera, float aspectRatio, ClusterDrawList& drawList)
+{
+	auto start = std::chrono::steady_clock::now();
+	stats = ClusterStats();
+	drawList.clear();
+	for (auto& bucket : buckets)
+		bucket.second.clear();
+
+	glm::mat4 projectionView = camera.getProjectionMatrix(aspectRatio) * camera.getViewMatrix();
+	const GeometryPool& pool = GeometryPool::shared();
+
+	for (uint32_t index : visible)
+	{
+		const Entity& entity = entities[index];
+		const ModelLod& lod = entity.model->getLod(entity.lod);
+		const GeometryRange& range = pool.getRange(lod.geometry);
+
+		// Planes extracted from projection * view * model are the frustum in model space,
+		// still normalized with the uniform scales entities use
+		const glm::mat4& transform = entity.transform;
+		Frustum frustum = Frustum::fromMatrix(projectionView * transform);
+		glm::vec3 eye = glm::vec3(glm::inverse(transform) * glm::vec4(camera.cameraPos, 1.0f));
+
+		std::vector<DrawElementsIndirectCommand>& bucket = buckets[((uint64_t)lod.VAO_ID << 32) | entity.model->texture->textureID];
+		unsigned int transformIndex = (unsigned int)drawList.transforms.size();
+		bool drawn = false;
+
+		for (const Meshlet& meshlet : lod.meshlets)
+		{
+			stats.clustersTested++;
+			stats.trianglesTested += meshlet.indexCount / 3;
+			if (!frustum.intersectsSphere(meshlet.center, meshlet.radius))
+			{
+				stats.frustumCulled++;
+				stats.trianglesRejected += meshlet.indexCount / 3;
+				continue;
+			}
+			if (coneCulling && MeshletBuilder::isBackFacing(meshlet, eye))
+			{
+				stats.backfaceCulled++;
+				stats.trianglesRejected += meshlet.indexCount / 3;
+				continue;
+			}
+
+			// Meshlets are contiguous in the index buffer, so a run of survivors is one command
+			unsigned int firstIndex = range.firstIndex + meshlet.firstIndex;
+			if (drawn && bucket.back().firstIndex + bucket.back().count == firstIndex)
+			{
+				bucket.back().count += meshlet.indexCount;
+			}
+			else
+			{
+				bucket.push_back({ meshlet.indexCount, 1, firstIndex, (int)range.baseVertex, transformIndex });
+				drawn = true;
+			}
+		}
+
+		if (drawn)
+			drawList.transforms.push_back(transform * entity.model->positionDecode);
+	}
+
+	for (auto& bucket : buckets)
+	{
+		if (bucket.second.empty())
+			continue;
+		drawList.batches.push_back({ (unsigned int)(bucket.first >> 32), (unsigned int)bucket.first, drawList.commands.size(), bucket.second.size() });
+		drawList.commands.insert(drawList.commands.end(), bucket.second.begin(), bucket.second.end());
+	}
+	stats.commands = (unsigned int)drawList.commands.size();
+	stats.cullMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "camera.h"
+#include "entity.h"
+#include "indirect_renderer.h"
+
+struct ClusterStats
+{
+	unsigned int clustersTested = 0;
+	unsigned int frustumCulled = 0;
+	unsigned int backfaceCulled = 0;
+	size_t trianglesTested = 0;
+	size_t trianglesRejected = 0;
+	// Runs of neighbouring surviving clusters become one command each
+	unsigned int commands = 0;
+	double cullMilliseconds = 0.0;
+};
+
+// What's left after cluster culling, ready for Renderer::submit
+struct ClusterDrawList
+{
+	// One multi-draw, all commands sharing a VAO and texture
+	struct Batch
+	{
+		unsigned int VAO_ID;
+		unsigned int textureID;
+		size_t firstCommand;
+		size_t commandCount;
+	};
+
+	std::vector<Batch> batches;
+	// baseInstance indexes transforms, the renderer offsets it to wherever it streams them
+	std::vector<DrawElementsIndirectCommand> commands;
+	// One per entity, decode matrix included
+	std::vector<glm::mat4> transforms;
+
+	void clear();
+};
+
+// Culls each entity's meshlets on the CPU instead of drawing the whole mesh whenever any of it
+// is on screen: clusters outside the frustum (or facing away, see coneCulling) are dropped, and the
+// survivors are turned into indirect draw commands. Runs after entity culling and LOD selection.
+// The tests happen in model space, the frustum and eye are moved there once per entity.
+class ClusterCuller
+{
+public:
+	ClusterStats stats;
+
+	// Also drop clusters whose normal cone faces away from the eye. Only turn this on when GL
+	// culls back faces too: with GL_CULL_FACE off those triangles are visible from behind and
+	// the culler would punch holes in the mesh. Nothing enables it yet, so it's off.
+	bool coneCulling = false;
+
+	// Draws entities[i] for each i in visible at the entity's LOD. drawList is cleared first.
+	void cull(const std::vector<Entity>& entities, const std::vector<uint32_t>& visible, const Camera& camera, float aspectRatio, ClusterDrawList& drawList);
+
+private:
+	// Keyed by (VAO << 32 | texture), reused between frames
+	std::unordered_map<uint64_t, std::vector<DrawElementsIndirectCommand>> buckets;
+};
@@ -0,0 +1,67 @@
+#include "command_list.h"
+
+#include <algorithm>
+#include <chrono>
+
+CommandRecorder::CommandRecorder(ThreadPool& pThreadPool)
+	: threadPool(pThreadPool)
+{
+}
+
+void CommandRecorder::record(const std::vector<Entity>& entities, const std::vector<uint32_t>& visible, Shader& shader, const Camera& camera,
+	RenderQueue& queue, size_t sliceCount)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	if (sliceCount == 0)
+		sliceCount = (threadPool.threadCount() + 1) * 4;
+	sliceCount = std::max<size_t>(1, std::min(sliceCount, (visible.size() + MIN_SLICE_SIZE - 1) / MIN_SLICE_SIZE));
+	if (lists.size() < sliceCount)
+		lists.resize(sliceCount);
+
+	size_t sliceSize = (visible.size() + sliceCount - 1) / sliceCount;
+	Shader* shaderPtr = &shader;
+	threadPool.parallelFor(sliceCount, 1, [&](size_t begin, size_t end)
+		{
+			for (size_t slice = begin; slice < end; slice++)
+			{
+				CommandList& list = lists[slice];
+				list.clear();
+				size_t first = slice * sliceSize;
+				size_t last = std::min(first + sliceSize, visible.size());
+				for (size_t i = first; i < last; i++)
+				{
+					const Entity& entity = entities[visible[i]];
+					float viewDepth = glm::dot(entity.position - camera.cameraPos, camera.cameraFront);
+					list.draw(shaderPtr, entity.model, entity.lod, entity.transform, viewDepth, camera.FAR_PLANE);
+				}
+			}
+		});
+	auto recorded = std::chrono::steady_clock::now();
+
+	// Every list gets its own range of the queue up front, so they can all be copied in at once
+	queue.clear();
+	size_t total = 0;
+	for (size_t slice = 0; slice < sliceCount; slice++)
+		total += lists[slice].size();
+	DrawPacket* destination = queue.append(total);
+
+	std::vector<size_t> offsets(sliceCount);
+	for (size_t slice = 1; slice < sliceCount; slice++)
+		offsets[slice] = offsets[slice - 1] + lists[slice - 1].size();
+	threadPool.parallelFor(sliceCount, 1, [&](size_t begin, size_t end)
+		{
+			for (size_t slice = begin; slice < end; slice++)
+				std::copy(lists[slice].getPackets().begin(), lists[slice].getPackets().end(), destination + offsets[slice]);
+		});
+	auto merged = std::chrono::steady_clock::now();
+
+	queue.sort();
+	auto sorted = std::chrono::steady_clock::now();
+
+	stats.slices = (unsigned int)sliceCount;
+	stats.commands = (unsigned int)total;
+	stats.recordMilliseconds = std::chrono::duration<double, std::milli>(recorded - start).count();
+	stats.mergeMilliseconds = std::chrono::duration<double, std::milli>(merged - recorded).count();
+	stats.sortMilliseconds = std::chrono::duration<double, std::milli>(sorted - merged).count();
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "camera.h"
+#include "entity.h"
+#include "render_queue.h"
+#include "shader_s.h"
+#include "thread_pool.h"
+
+// Draw commands recorded by one thread. Recording never touches OpenGL, a command is just
+// a DrawPacket (which shader/model/LOD, the transform and the sort key), so lists can be
+// filled on worker threads and handed to the GL thread afterwards.
+class CommandList
+{
+public:
+	void clear() { packets.clear(); }
+	void draw(Shader* shader, Model* model, unsigned int lod, const glm::mat4& transform, float viewDepth, float farPlane)
+	{
+		packets.push_back(RenderQueue::makePacket(shader, model, transform, viewDepth, farPlane, lod));
+	}
+
+	size_t size() const { return packets.size(); }
+	const std::vector<DrawPacket>& getPackets() const { return packets; }
+
+private:
+	std::vector<DrawPacket> packets;
+};
+
+struct RecordingStats
+{
+	unsigned int slices = 0;
+	unsigned int commands = 0;
+	double recordMilliseconds = 0.0;
+	double mergeMilliseconds = 0.0;
+	double sortMilliseconds = 0.0;
+};
+
+// Records draws for a set of entities in parallel: the visible list is cut into slices, each
+// slice is recorded into its own CommandList on the pool, and the lists are then merged
+// into a RenderQueue and sorted. The caller replays the queue with Renderer::submit on the GL thread.
+class CommandRecorder
+{
+public:
+	RecordingStats stats;
+
+	explicit CommandRecorder(ThreadPool& threadPool);
+
+	// Clears queue and fills it with one sorted packet per visible entity.
+	// sliceCount 0 picks a few slices per thread so uneven slices even out.
+	void record(const std::vector<Entity>& entities, const std::vector<uint32_t>& visible, Shader& shader, const Camera& camera,
+		RenderQueue& queue, size_t sliceCount = 0);
+
+private:
+	// Below this many entities per slice the job overhead isn't worth it
+	static const size_t MIN_SLICE_SIZE = 256;
+
+	ThreadPool& threadPool;
+	// One list per slice, kept between frames so recording doesn't allocate once warmed up
+	std::vector<CommandList> lists;
+};
@@ -0,0 +1,70 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "aabb.h"
+
+class Model;
+
+// The components the scene's entities are made of, see World for the rules they follow.
+// Kept small and split by who reads them, so each system only streams what it uses.
+
+struct Position
+{
+	glm::vec3 value;
+};
+
+struct Rotation
+{
+	glm::quat value;
+};
+
+// Uniform
+struct Scale
+{
+	float value;
+};
+
+// Turns the entity about the world z axis, by time * degreesPerSecond on top of base.
+// The same as animating the z of Euler angles, which glm applies last.
+struct Spin
+{
+	glm::quat base;
+	float degreesPerSecond;
+};
+
+// Model space to world space, written by TransformSystem
+struct LocalToWorld
+{
+	glm::mat4 value;
+};
+
+// The model's bounds, copied in when the entity is created so TransformSystem doesn't
+// have to follow the Model pointer for every entity
+struct LocalBounds
+{
+	AABB value;
+};
+
+// LocalBounds after LocalToWorld, written by TransformSystem
+struct WorldBounds
+{
+	AABB value;
+};
+
+struct Renderable
+{
+	Model* model;
+};
+
+// Level of detail picked by LodSelector, kept between frames so the hysteresis works
+struct LodLevel
+{
+	unsigned int level;
+};
+
+// Tag: rasterized into the occlusion buffer as well as drawn. Occluders should be large
+// and low poly.
+struct Occluder
+{
+};
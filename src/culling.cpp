@@ -0,0 +1,185 @@
+#include "culling.h"
+
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#if defined(__AVX2__)
+#define CULLING_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CULLING_SSE 1
+#endif
+
+#if CULLING_AVX2
+#include <immintrin.h>
+#elif CULLING_SSE
+#include <emmintrin.h>
+#endif
+
+void FrustumCuller::gather(const std::vector<Entity>& entities)
+{
+	entityCount = entities.size();
+	size_t padded = (entityCount + BLOCK - 1) / BLOCK * BLOCK;
+	centerX.resize(padded);
+	centerY.resize(padded);
+	centerZ.resize(padded);
+	radius.resize(padded);
+
+	for (size_t i = 0; i < entityCount; i++)
+	{
+		const Entity& entity = entities[i];
+		glm::vec4 center = entity.transform * glm::vec4(entity.model->boundingCenter, 1.0f);
+		centerX[i] = center.x;
+		centerY[i] = center.y;
+		centerZ[i] = center.z;
+		radius[i] = entity.model->boundingRadius * entity.scale;
+	}
+
+	// A sphere with a radius of -infinity fails every plane test
+	for (size_t i = entityCount; i < padded; i++)
+	{
+		centerX[i] = centerY[i] = centerZ[i] = 0.0f;
+		radius[i] = -std::numeric_limits<float>::infinity();
+	}
+}
+
+void FrustumCuller::cull(const Frustum& frustum, std::vector<uint32_t>& visible)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	size_t count = radius.size();
+	visible.resize(count);
+
+#if CULLING_AVX2
+	size_t visibleCount = cullAVX2(centerX.data(), centerY.data(), centerZ.data(), radius.data(), count, frustum, visible.data());
+#elif CULLING_SSE
+	size_t visibleCount = cullSSE(centerX.data(), centerY.data(), centerZ.data(), radius.data(), count, frustum, visible.data());
+#else
+	size_t visibleCount = cullScalar(centerX.data(), centerY.data(), centerZ.data(), radius.data(), count, frustum, visible.data());
+#endif
+	visible.resize(visibleCount);
+
+	auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	stats.tested = (unsigned int)entityCount;
+	stats.visible = (unsigned int)visibleCount;
+	stats.nanosecondsPerEntity = entityCount ? elapsed / entityCount : 0.0;
+}
+
+size_t FrustumCuller::cullScalar(const float* x, const float* y, const float* z, const float* r, size_t count, const Frustum& frustum, uint32_t* out)
+{
+	size_t written = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		bool inside = true;
+		for (const Plane& plane : frustum.planes)
+		{
+			float distance = plane.normal.x * x[i] + plane.normal.y * y[i] + plane.normal.z * z[i] + plane.distance;
+			inside &= distance > -r[i];
+		}
+		// Always write, only advance when visible, so there's no branch on the result
+		out[written] = (uint32_t)i;
+		written += inside;
+	}
+	return written;
+}
+
+size_t FrustumCuller::cullSSE(const float* x, const float* y, const float* z, const float* r, size_t count, const Frustum& frustum, uint32_t* out)
+{
+#if CULLING_SSE
+	__m128 planeX[Frustum::PLANE_COUNT], planeY[Frustum::PLANE_COUNT], planeZ[Frustum::PLANE_COUNT], planeD[Frustum::PLANE_COUNT];
+	for (int p = 0; p < Frustum::PLANE_COUNT; p++)
+	{
+		planeX[p] = _mm_set1_ps(frustum.planes[p].normal.x);
+		planeY[p] = _mm_set1_ps(frustum.planes[p].normal.y);
+		planeZ[p] = _mm_set1_ps(frustum.planes[p].normal.z);
+		planeD[p] = _mm_set1_ps(frustum.planes[p].distance);
+	}
+
+	size_t written = 0;
+	for (size_t i = 0; i < count; i += 4)
+	{
+		__m128 cx = _mm_loadu_ps(x + i);
+		__m128 cy = _mm_loadu_ps(y + i);
+		__m128 cz = _mm_loadu_ps(z + i);
+		__m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(r + i));
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < Frustum::PLANE_COUNT; p++)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy)),
+				_mm_add_ps(_mm_mul_ps(planeZ[p], cz), planeD[p]));
+			inside = _mm_and_ps(inside, _mm_cmpgt_ps(distance, negativeRadius));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		for (int lane = 0; lane < 4; lane++)
+		{
+			out[written] = (uint32_t)(i + lane);
+			written += (mask >> lane) & 1;
+		}
+	}
+	return written;
+#else
+	return cullScalar(x, y, z, r, count, frustum, out);
+#endif
+}
+
+size_t FrustumCuller::cullAVX2(const float* x, const float* y, const float* z, const float* r, size_t count, const Frustum& frustum, uint32_t* out)
+{
+#if CULLING_AVX2
+	__m256 planeX[Frustum::PLANE_COUNT], planeY[Frustum::PLANE_COUNT], planeZ[Frustum::PLANE_COUNT], planeD[Frustum::PLANE_COUNT];
+	for (int p = 0; p < Frustum::PLANE_COUNT; p++)
+	{
+		planeX[p] = _mm256_set1_ps(frustum.planes[p].normal.x);
+		planeY[p] = _mm256_set1_ps(frustum.planes[p].normal.y);
+		planeZ[p] = _mm256_set1_ps(frustum.planes[p].normal.z);
+		planeD[p] = _mm256_set1_ps(frustum.planes[p].distance);
+	}
+
+	size_t written = 0;
+	for (size_t i = 0; i < count; i += 8)
+	{
+		__m256 cx = _mm256_loadu_ps(x + i);
+		__m256 cy = _mm256_loadu_ps(y + i);
+		__m256 cz = _mm256_loadu_ps(z + i);
+		__m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(r + i));
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < Frustum::PLANE_COUNT; p++)
+		{
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], cx), _mm256_mul_ps(planeY[p], cy)),
+				_mm256_add_ps(_mm256_mul_ps(planeZ[p], cz), planeD[p]));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GT_OQ));
+		}
+
+		int mask = _mm256_movemask_ps(inside);
+		for (int lane = 0; lane < 8; lane++)
+		{
+			out[written] = (uint32_t)(i + lane);
+			written += (mask >> lane) & 1;
+		}
+	}
+	return written;
+#else
+	return cullSSE(x, y, z, r, count, frustum, out);
+#endif
+}
+
+bool FrustumCuller::hasSSE()
+{
+#if CULLING_SSE
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool FrustumCuller::hasAVX2()
+{
+#if CULLING_AVX2
+	return true;
+#else
+	return false;
+#endif
+}
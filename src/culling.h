@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "entity.h"
+#include "frustum.h"
+
+struct CullingStats
+{
+	unsigned int tested = 0;
+	unsigned int visible = 0;
+	double nanosecondsPerEntity = 0.0;
+};
+
+// Frustum culls entity bounding spheres stored as structure of arrays,
+// so the kernels can test 4 (SSE) or 8 (AVX2) spheres per plane per instruction.
+// The widest instruction set enabled at compile time is used, AVX2 needs ENABLE_AVX2 in CMake.
+class FrustumCuller
+{
+public:
+	// Kernels work on whole SIMD blocks, the arrays are padded to a multiple of this
+	static const size_t BLOCK = 8;
+
+	CullingStats stats;
+
+	// World space bounding spheres, padded with spheres that are never visible
+	std::vector<float> centerX;
+	std::vector<float> centerY;
+	std::vector<float> centerZ;
+	std::vector<float> radius;
+
+	// Rebuilds the sphere arrays from the entities' models and transforms
+	void gather(const std::vector<Entity>& entities);
+	// Fills visible with the indices of the entities intersecting the frustum, in order
+	void cull(const Frustum& frustum, std::vector<uint32_t>& visible);
+
+	// The kernels, public so they can be benchmarked against each other.
+	// count must be a multiple of BLOCK, out must have room for count indices.
+	// Return the number of indices written.
+	static size_t cullScalar(const float* x, const float* y, const float* z, const float* r, size_t count, const Frustum& frustum, uint32_t* out);
+	static size_t cullSSE(const float* x, const float* y, const float* z, const float* r, size_t count, const Frustum& frustum, uint32_t* out);
+	static size_t cullAVX2(const float* x, const float* y, const float* z, const float* r, size_t count, const Frustum& frustum, uint32_t* out);
+
+	static bool hasSSE();
+	static bool hasAVX2();
+
+private:
+	size_t entityCount = 0;
+};
@@ -5,11 +5,16 @@
 
 Entity::Entity(Model* pModel, glm::vec3 pPosition, float pRotationX, float pRotationY, float pRotationZ, float pScale)
 {
-    rotation = { pRotationX, pRotationY, pRotationZ };
     model = pModel;
     position = pPosition;
-    rotationX = pRotationX;
-    rotationY = pRotationY;
-    rotationZ = pRotationZ;
     scale = pScale;
+    transform = composeTransform(pPosition, glm::quat(glm::radians(glm::vec3(pRotationX, pRotationY, pRotationZ))), pScale);
+}
+
+glm::mat4 composeTransform(const glm::vec3& position, const glm::quat& rotation, float scale)
+{
+	// Same as translate * toMat4(rotation) * scale, without the two full matrix products
+	glm::mat4 transform(glm::mat3_cast(rotation) * scale);
+	transform[3] = glm::vec4(position, 1.0f);
+	return transform;
 }
@@ -1,24 +1,29 @@
 #pragma once
 #include <glm/glm.hpp>
-#include <vector>
+#include <glm/gtc/quaternion.hpp>
 
 #include "model.h"
 
+// One renderable instance the way culling, LOD selection and the renderers see it. Entities
+// live in the World as components, RenderExtractionSystem copies them out into these every frame.
 class Entity
 {
 public:
 	Model* model;
 
-	glm::vec3 rotation;
+	// Model space to world space, without the model's positionDecode
+	glm::mat4 transform;
 
 	glm::vec3 position;
-	float rotationX, rotationY, rotationZ;
 	float scale;
 
+	// Level of detail picked by LodSelector, index into model->lods
+	unsigned int lod = 0;
+
+	Entity() = default;
+	// For one-off draws outside the World, e.g. the benchmarks
 	Entity(Model* pModel, glm::vec3 pPosition, float pRotationX, float pRotationY, float pRotationZ, float pScale);
+};
 
-private:
-	std::vector<float> vertex_positions;
-	std::vector<float> vertex_texture_uvs;
-	std::vector<unsigned int> vertex_indices;
-};
\ No newline at end of file
+// Translation * rotation * uniform scale
+glm::mat4 composeTransform(const glm::vec3& position, const glm::quat& rotation, float scale);
@@ -0,0 +1,100 @@
+#include "free_list_allocator.h"
+
+#include <algorithm>
+
+FreeListAllocator::FreeListAllocator(size_t pCapacity)
+	: capacity(pCapacity)
+{
+	if (capacity > 0)
+		freeBlocks[0] = capacity;
+}
+
+size_t FreeListAllocator::allocate(size_t size)
+{
+	if (size == 0)
+		return 0;
+
+	auto best = freeBlocks.end();
+	for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it)
+	{
+		if (it->second >= size && (best == freeBlocks.end() || it->second < best->second))
+		{
+			best = it;
+			if (best->second == size)
+				break;
+		}
+	}
+	if (best == freeBlocks.end())
+		return INVALID;
+
+	size_t offset = best->first;
+	size_t remaining = best->second - size;
+	freeBlocks.erase(best);
+	if (remaining > 0)
+		freeBlocks[offset + size] = remaining;
+	used += size;
+	return offset;
+}
+
+void FreeListAllocator::free(size_t offset, size_t size)
+{
+	if (size == 0)
+		return;
+	used -= size;
+
+	auto next = freeBlocks.lower_bound(offset);
+	// Merge with the block right after
+	if (next != freeBlocks.end() && offset + size == next->first)
+	{
+		size += next->second;
+		next = freeBlocks.erase(next);
+	}
+	// And with the block right before
+	if (next != freeBlocks.begin())
+	{
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset)
+		{
+			previous->second += size;
+			return;
+		}
+	}
+	freeBlocks[offset] = size;
+}
+
+void FreeListAllocator::grow(size_t newCapacity)
+{
+	if (newCapacity <= capacity)
+		return;
+	size_t added = newCapacity - capacity;
+	size_t oldCapacity = capacity;
+	capacity = newCapacity;
+	// Goes through free() so it merges with a free block at the old end
+	used += added;
+	free(oldCapacity, added);
+}
+
+void FreeListAllocator::reset(size_t pCapacity, size_t pUsed)
+{
+	capacity = pCapacity;
+	used = pUsed;
+	freeBlocks.clear();
+	if (capacity > used)
+		freeBlocks[used] = capacity - used;
+}
+
+size_t FreeListAllocator::largestFreeBlock() const
+{
+	size_t largest = 0;
+	for (const auto& block : freeBlocks)
+		largest = std::max(largest, block.second);
+	return largest;
+}
+
+float FreeListAllocator::fragmentation() const
+{
+	size_t freeSpace = capacity - used;
+	if (freeSpace == 0)
+		return 0.0f;
+	return 1.0f - (float)largestFreeBlock() / freeSpace;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+
+// Hands out ranges of [0, capacity) in arbitrary units (vertices, indices...).
+// Free space is kept as a list of blocks sorted by offset, so freeing merges with the
+// neighbours on both sides and the space never splinters more than the live ranges force it to.
+class FreeListAllocator
+{
+public:
+	static const size_t INVALID = SIZE_MAX;
+
+	explicit FreeListAllocator(size_t capacity = 0);
+
+	// Best fit, returns INVALID when no block is big enough
+	size_t allocate(size_t size);
+	void free(size_t offset, size_t size);
+	// Adds room at the end, e.g. after the backing buffer grew
+	void grow(size_t newCapacity);
+	// Forget everything, then everything in [0, used) counts as allocated (after compacting)
+	void reset(size_t capacity, size_t used);
+
+	size_t getCapacity() const { return capacity; }
+	size_t getUsed() const { return used; }
+	size_t largestFreeBlock() const;
+	// 0 when all free space is one block, approaching 1 as it's scattered into small pieces
+	float fragmentation() const;
+
+private:
+	size_t capacity;
+	size_t used = 0;
+	// Offset -> size
+	std::map<size_t, size_t> freeBlocks;
+};
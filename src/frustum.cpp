@@ -0,0 +1,55 @@
+#include "frustum.h"
+
+Frustum Frustum::fromMatrix(const glm::mat4& m)
+{
+	// glm is column major, so row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i])
+	glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+	glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+	glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+	glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+	// A clip space point is inside when -w <= x,y,z <= w,
+	// each inequality gives one plane
+	glm::vec4 rawPlanes[PLANE_COUNT] = {
+		row3 + row0, // left
+		row3 - row0, // right
+		row3 + row1, // bottom
+		row3 - row1, // top
+		row3 + row2, // near
+		row3 - row2  // far
+	};
+
+	Frustum frustum;
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		float length = glm::length(glm::vec3(rawPlanes[i]));
+		frustum.planes[i].normal = glm::vec3(rawPlanes[i]) / length;
+		frustum.planes[i].distance = rawPlanes[i].w / length;
+	}
+	return frustum;
+}
+
+bool Frustum::intersectsSphere(const glm::vec3& center, float radius) const
+{
+	for (const Plane& plane : planes)
+	{
+		if (glm::dot(plane.normal, center) + plane.distance < -radius)
+			return false;
+	}
+	return true;
+}
+
+bool Frustum::intersectsAABB(const glm::vec3& min, const glm::vec3& max) const
+{
+	for (const Plane& plane : planes)
+	{
+		// The corner furthest along the plane normal, if that's outside everything is
+		glm::vec3 positive(
+			plane.normal.x >= 0.0f ? max.x : min.x,
+			plane.normal.y >= 0.0f ? max.y : min.y,
+			plane.normal.z >= 0.0f ? max.z : min.z);
+		if (glm::dot(plane.normal, positive) + plane.distance < 0.0f)
+			return false;
+	}
+	return true;
+}
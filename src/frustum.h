@@ -0,0 +1,28 @@
+#pragma once
+#include <glm/glm.hpp>
+
+// Plane as normal . p + distance = 0, normal pointing into the frustum
+struct Plane
+{
+	glm::vec3 normal;
+	float distance;
+};
+
+class Frustum
+{
+public:
+	enum PlaneIndex
+	{
+		PLANE_LEFT = 0, PLANE_RIGHT, PLANE_BOTTOM, PLANE_TOP, PLANE_NEAR, PLANE_FAR, PLANE_COUNT
+	};
+
+	Plane planes[PLANE_COUNT];
+
+	// Extracts the planes from a projection * view matrix (Gribb/Hartmann).
+	// The planes are in world space and normalized, so plane distances are real distances.
+	static Frustum fromMatrix(const glm::mat4& projectionView);
+
+	// Conservative: may report true for volumes just outside a corner of the frustum
+	bool intersectsSphere(const glm::vec3& center, float radius) const;
+	bool intersectsAABB(const glm::vec3& min, const glm::vec3& max) const;
+};
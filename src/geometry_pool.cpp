@@ -0,0 +1,223 @@
+#include "geometry_pool.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+
+#include "gl_state.h"
+
+GeometryPool& GeometryPool::shared()
+{
+	static GeometryPool pool;
+	return pool;
+}
+
+GeometryPool::GeometryPool(size_t pInitialVertexCapacity, size_t pInitialIndexCapacity)
+	: initialVertexCapacity(pInitialVertexCapacity), initialIndexCapacity(pInitialIndexCapacity)
+{
+}
+
+GeometryHandle GeometryPool::allocate(VertexFormat format, const void* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount)
+{
+	reserve(format, vertexCount, indexCount);
+	Arena& arena = arenas[format];
+	unsigned int stride = vertexStride(format);
+
+	GeometryRange range;
+	range.format = format;
+	range.baseVertex = (unsigned int)arena.vertices.allocate(vertexCount);
+	range.vertexCount = (unsigned int)vertexCount;
+	range.firstIndex = (unsigned int)arena.indices.allocate(indexCount);
+	range.indexCount = (unsigned int)indexCount;
+	range.live = true;
+
+	// The copy targets aren't part of any VAO, so uploading through them can't disturb one
+	GLState::bindBuffer(GL_COPY_WRITE_BUFFER, arena.vertexBuffer.get());
+	glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)range.baseVertex * stride, vertexCount * stride, vertices);
+	GLState::bindBuffer(GL_COPY_WRITE_BUFFER, arena.indexBuffer.get());
+	glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)range.firstIndex * sizeof(unsigned int), indexCount * sizeof(unsigned int), indices);
+
+	GeometryHandle handle;
+	if (!freeHandles.empty())
+	{
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+		ranges[handle] = range;
+	}
+	else
+	{
+		handle = (GeometryHandle)ranges.size();
+		ranges.push_back(range);
+	}
+	return handle;
+}
+
+void GeometryPool::free(GeometryHandle handle)
+{
+	if (handle >= ranges.size() || !ranges[handle].live)
+		return;
+
+	GeometryRange& range = ranges[handle];
+	Arena& arena = arenas[range.format];
+	arena.vertices.free(range.baseVertex, range.vertexCount);
+	arena.indices.free(range.firstIndex, range.indexCount);
+	range.live = false;
+	freeHandles.push_back(handle);
+}
+
+unsigned int GeometryPool::getVAO(VertexFormat format)
+{
+	return getArena(format).vertexArray.get();
+}
+
+GeometryPool::Arena& GeometryPool::getArena(VertexFormat format)
+{
+	Arena& arena = arenas[format];
+	if (!arena.vertexArray)
+	{
+		arena.vertexArray = VertexArrayHandle::create("GeometryPool");
+		rebuild(format, initialVertexCapacity, initialIndexCapacity);
+	}
+	return arena;
+}
+
+void GeometryPool::reserve(VertexFormat format, size_t vertexCount, size_t indexCount)
+{
+	Arena& arena = getArena(format);
+	if (arena.vertices.largestFreeBlock() >= vertexCount && arena.indices.largestFreeBlock() >= indexCount)
+		return;
+
+	size_t vertexCapacity = arena.vertices.getCapacity();
+	size_t indexCapacity = arena.indices.getCapacity();
+	bool grow = false;
+	while (vertexCapacity - arena.vertices.getUsed() < vertexCount)
+	{
+		vertexCapacity = std::max<size_t>(vertexCapacity * 2, 1);
+		grow = true;
+	}
+	while (indexCapacity - arena.indices.getUsed() < indexCount)
+	{
+		indexCapacity = std::max<size_t>(indexCapacity * 2, 1);
+		grow = true;
+	}
+
+	// Either there's enough space, just not in one piece, or the buffers have to get bigger.
+	// Both mean copying into new buffers, which packs the ranges together on the way.
+	rebuild(format, vertexCapacity, indexCapacity);
+	if (grow)
+		grows++;
+	else
+		compactions++;
+}
+
+bool GeometryPool::compactIfFragmented()
+{
+	bool compacted = false;
+	for (int format = 0; format < VERTEX_FORMAT_COUNT; format++)
+	{
+		Arena& arena = arenas[format];
+		if (!arena.vertexArray)
+			continue;
+		if (arena.vertices.fragmentation() > COMPACT_THRESHOLD || arena.indices.fragmentation() > COMPACT_THRESHOLD)
+		{
+			compact((VertexFormat)format);
+			compacted = true;
+		}
+	}
+	return compacted;
+}
+
+void GeometryPool::compact(VertexFormat format)
+{
+	Arena& arena = getArena(format);
+	rebuild(format, arena.vertices.getCapacity(), arena.indices.getCapacity());
+	compactions++;
+}
+
+void GeometryPool::rebuild(VertexFormat format, size_t vertexCapacity, size_t indexCapacity)
+{
+	Arena& arena = arenas[format];
+	unsigned int stride = vertexStride(format);
+
+	// Copying between two buffers rather than within one, overlapping source and destination ranges aren't allowed
+	BufferHandle vertexBuffer = BufferHandle::create("GeometryPool");
+	BufferHandle indexBuffer = BufferHandle::create("GeometryPool");
+	GLState::bindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer.get());
+	glBufferStorage(GL_COPY_WRITE_BUFFER, vertexCapacity * stride, nullptr, GL_DYNAMIC_STORAGE_BIT);
+	vertexBuffer.setMemory(vertexCapacity * stride);
+	GLState::bindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer.get());
+	glBufferStorage(GL_COPY_WRITE_BUFFER, indexCapacity * sizeof(unsigned int), nullptr, GL_DYNAMIC_STORAGE_BIT);
+	indexBuffer.setMemory(indexCapacity * sizeof(unsigned int));
+
+	// Pack every live range to the front, in handle order. The copies stay on the GPU.
+	size_t vertexEnd = 0;
+	size_t indexEnd = 0;
+	if (arena.vertexBuffer)
+	{
+		GLState::bindBuffer(GL_COPY_READ_BUFFER, arena.vertexBuffer.get());
+		GLState::bindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer.get());
+		for (GeometryRange& range : ranges)
+		{
+			if (!range.live || range.format != format)
+				continue;
+			if (range.vertexCount > 0)
+				glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr)range.baseVertex * stride, vertexEnd * stride, (GLsizeiptr)range.vertexCount * stride);
+			range.baseVertex = (unsigned int)vertexEnd;
+			vertexEnd += range.vertexCount;
+		}
+
+		GLState::bindBuffer(GL_COPY_READ_BUFFER, arena.indexBuffer.get());
+		GLState::bindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer.get());
+		for (GeometryRange& range : ranges)
+		{
+			if (!range.live || range.format != format)
+				continue;
+			if (range.indexCount > 0)
+				glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr)range.firstIndex * sizeof(unsigned int), indexEnd * sizeof(unsigned int), (GLsizeiptr)range.indexCount * sizeof(unsigned int));
+			range.firstIndex = (unsigned int)indexEnd;
+			indexEnd += range.indexCount;
+		}
+	}
+
+	// The old buffers are deleted once the frames that may still draw from them are done
+	arena.vertexBuffer = std::move(vertexBuffer);
+	arena.indexBuffer = std::move(indexBuffer);
+	arena.vertices.reset(vertexCapacity, vertexEnd);
+	arena.indices.reset(indexCapacity, indexEnd);
+	bindAttributes(format);
+}
+
+void GeometryPool::bindAttributes(VertexFormat format)
+{
+	Arena& arena = arenas[format];
+
+	// The VAO itself is kept, so anything else attached to it (like the renderer's
+	// instance attributes) survives the buffers being replaced
+	GLState::bindVertexArray(arena.vertexArray.get());
+	GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena.indexBuffer.get());
+	GLState::bindBuffer(GL_ARRAY_BUFFER, arena.vertexBuffer.get());
+
+	setupVertexAttributes(format);
+
+	GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState::bindVertexArray(0);
+}
+
+GeometryPool::Stats GeometryPool::getStats() const
+{
+	Stats stats;
+	for (int format = 0; format < VERTEX_FORMAT_COUNT; format++)
+	{
+		const Arena& arena = arenas[format];
+		unsigned int stride = vertexStride((VertexFormat)format);
+		stats.vertexBytesUsed += arena.vertices.getUsed() * stride;
+		stats.vertexBytesCapacity += arena.vertices.getCapacity() * stride;
+		stats.indexBytesUsed += arena.indices.getUsed() * sizeof(unsigned int);
+		stats.indexBytesCapacity += arena.indices.getCapacity() * sizeof(unsigned int);
+		stats.fragmentation = std::max(stats.fragmentation, std::max(arena.vertices.fragmentation(), arena.indices.fragmentation()));
+	}
+	stats.meshes = (unsigned int)(ranges.size() - freeHandles.size());
+	stats.grows = grows;
+	stats.compactions = compactions;
+	return stats;
+}
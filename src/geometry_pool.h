@@ -0,0 +1,107 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "free_list_allocator.h"
+#include "gpu_resources.h"
+#include "vertex_format.h"
+
+typedef uint32_t GeometryHandle;
+static const GeometryHandle INVALID_GEOMETRY = 0xFFFFFFFF;
+
+// Where a mesh lives in its format's buffers. Indices are stored relative to the mesh,
+// so draws pass baseVertex along with the byte offset of firstIndex.
+// Compaction moves meshes around, so look the range up again rather than keeping a copy.
+struct GeometryRange
+{
+	VertexFormat format;
+	unsigned int baseVertex;
+	unsigned int vertexCount;
+	unsigned int firstIndex;
+	unsigned int indexCount;
+	bool live;
+
+	// firstIndex as the byte offset glDrawElements* take in place of a pointer
+	const void* indexOffset() const { return (const void*)((size_t)firstIndex * sizeof(unsigned int)); }
+};
+
+// Sub-allocates meshes from a few large vertex/index buffers instead of giving each one
+// its own. Every vertex format gets its own buffers and VAO. Fewer, bigger buffers keep GPU memory in one piece, and since every mesh of a format
+// sits behind the same VAO, drawing different models doesn't need a VAO switch.
+// Freed space is reused best fit; once it's scattered into holes too small to be useful,
+// compactIfFragmented() packs the live meshes back together with GPU side copies.
+class GeometryPool
+{
+public:
+	// Compact once this much of a buffer's free space is outside its largest free block
+	static constexpr float COMPACT_THRESHOLD = 0.5f;
+
+	struct Stats
+	{
+		size_t vertexBytesUsed = 0;
+		size_t vertexBytesCapacity = 0;
+		size_t indexBytesUsed = 0;
+		size_t indexBytesCapacity = 0;
+		// Worst of all the buffers, see FreeListAllocator::fragmentation
+		float fragmentation = 0.0f;
+		unsigned int meshes = 0;
+		unsigned int grows = 0;
+		unsigned int compactions = 0;
+	};
+
+	// The pool Model allocates from. Created on first use, so only call this with a GL context current.
+	static GeometryPool& shared();
+
+	// Starting capacities per format, in vertices and indices. Buffers double when they run out.
+	GeometryPool(size_t initialVertexCapacity = 64 * 1024, size_t initialIndexCapacity = 256 * 1024);
+
+	GeometryPool(const GeometryPool&) = delete;
+	GeometryPool& operator=(const GeometryPool&) = delete;
+
+	// vertices holds vertexCount vertices laid out as format, see encodeVertices()
+	GeometryHandle allocate(VertexFormat format, const void* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount);
+	// Only bookkeeping, so it's safe from destructors running after the context is gone
+	void free(GeometryHandle handle);
+
+	const GeometryRange& getRange(GeometryHandle handle) const { return ranges[handle]; }
+	// Created on first use. Stays the same through grows and compactions.
+	unsigned int getVAO(VertexFormat format);
+
+	// Packs the live meshes of every format whose buffers are fragmented past COMPACT_THRESHOLD.
+	// Moves ranges, so call it between frames. Returns whether anything moved.
+	bool compactIfFragmented();
+	void compact(VertexFormat format);
+
+	Stats getStats() const;
+
+private:
+	// One format's buffers
+	struct Arena
+	{
+		VertexArrayHandle vertexArray;
+		BufferHandle vertexBuffer;
+		BufferHandle indexBuffer;
+		FreeListAllocator vertices;
+		FreeListAllocator indices;
+	};
+
+	size_t initialVertexCapacity;
+	size_t initialIndexCapacity;
+	Arena arenas[VERTEX_FORMAT_COUNT];
+
+	std::vector<GeometryRange> ranges;
+	// Handles of freed ranges, reused before ranges grows
+	std::vector<GeometryHandle> freeHandles;
+
+	unsigned int grows = 0;
+	unsigned int compactions = 0;
+
+	Arena& getArena(VertexFormat format);
+	// Makes room for the sizes in the arena, compacting or growing as needed
+	void reserve(VertexFormat format, size_t vertexCount, size_t indexCount);
+	// Moves the arena into new buffers of the given capacities, packing the live ranges to the front
+	void rebuild(VertexFormat format, size_t vertexCapacity, size_t indexCapacity);
+	// Points the VAO at the arena's current buffers
+	void bindAttributes(VertexFormat format);
+};
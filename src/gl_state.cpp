@@ -0,0 +1,200 @@
+#include "gl_state.h"
+
+GLState::Stats GLState::stats;
+
+unsigned int GLState::program = GLState::UNKNOWN;
+unsigned int GLState::vertexArray = GLState::UNKNOWN;
+unsigned int GLState::activeTextureUnit = GLState::UNKNOWN;
+float GLState::clearColorValue[4] = {};
+bool GLState::clearColorKnown = false;
+
+std::unordered_map<GLenum, unsigned int> GLState::buffers;
+std::unordered_map<uint64_t, unsigned int> GLState::indexedBuffers;
+std::unordered_map<uint64_t, unsigned int> GLState::textures;
+std::unordered_map<GLenum, bool> GLState::capabilities;
+
+void GLState::resetStats()
+{
+	stats = Stats();
+}
+
+void GLState::invalidate()
+{
+	program = UNKNOWN;
+	vertexArray = UNKNOWN;
+	activeTextureUnit = UNKNOWN;
+	clearColorKnown = false;
+	buffers.clear();
+	indexedBuffers.clear();
+	textures.clear();
+	capabilities.clear();
+}
+
+bool GLState::changed(unsigned int& current, unsigned int value)
+{
+	if (current == value)
+	{
+		stats.filtered++;
+		return false;
+	}
+
+	current = value;
+	stats.issued++;
+	return true;
+}
+
+void GLState::useProgram(unsigned int pProgram)
+{
+	if (changed(program, pProgram))
+		glUseProgram(pProgram);
+}
+
+void GLState::bindVertexArray(unsigned int pVertexArray)
+{
+	if (changed(vertexArray, pVertexArray))
+	{
+		glBindVertexArray(pVertexArray);
+		// The element buffer binding is part of the VAO, so switching VAOs changes it
+		buffers.erase(GL_ELEMENT_ARRAY_BUFFER);
+	}
+}
+
+void GLState::bindBuffer(GLenum target, unsigned int buffer)
+{
+	auto it = buffers.try_emplace(target, UNKNOWN).first;
+	if (changed(it->second, buffer))
+		glBindBuffer(target, buffer);
+}
+
+void GLState::bindBufferBase(GLenum target, unsigned int index, unsigned int buffer)
+{
+	uint64_t key = ((uint64_t)target << 32) | index;
+	auto it = indexedBuffers.try_emplace(key, UNKNOWN).first;
+	if (changed(it->second, buffer))
+	{
+		glBindBufferBase(target, index, buffer);
+		// Binding to an indexed point also binds to the generic target
+		buffers[target] = buffer;
+	}
+}
+
+void GLState::bindBufferRange(GLenum target, unsigned int index, unsigned int buffer, GLintptr offset, GLsizeiptr size)
+{
+	glBindBufferRange(target, index, buffer, offset, size);
+	stats.issued++;
+	buffers[target] = buffer;
+	// Only part of the buffer is bound, a later bindBufferBase of the same buffer must go through
+	indexedBuffers[((uint64_t)target << 32) | index] = UNKNOWN;
+}
+
+void GLState::bindTexture(unsigned int unit, GLenum target, unsigned int texture)
+{
+	uint64_t key = ((uint64_t)unit << 32) | target;
+	auto it = textures.try_emplace(key, UNKNOWN).first;
+	if (it->second == texture)
+	{
+		stats.filtered++;
+		return;
+	}
+
+	// Counted by hand rather than through changed(): one issued per GL call made, and an
+	// already active unit isn't a filtered call when the bind still goes through
+	if (activeTextureUnit != unit)
+	{
+		activeTextureUnit = unit;
+		glActiveTexture(GL_TEXTURE0 + unit);
+		stats.issued++;
+	}
+	it->second = texture;
+	glBindTexture(target, texture);
+	stats.issued++;
+}
+
+void GLState::enable(GLenum capability)
+{
+	auto it = capabilities.find(capability);
+	if (it != capabilities.end() && it->second)
+	{
+		stats.filtered++;
+		return;
+	}
+
+	capabilities[capability] = true;
+	stats.issued++;
+	glEnable(capability);
+}
+
+void GLState::disable(GLenum capability)
+{
+	auto it = capabilities.find(capability);
+	if (it != capabilities.end() && !it->second)
+	{
+		stats.filtered++;
+		return;
+	}
+
+	capabilities[capability] = false;
+	stats.issued++;
+	glDisable(capability);
+}
+
+void GLState::clearColor(float r, float g, float b, float a)
+{
+	if (clearColorKnown && clearColorValue[0] == r && clearColorValue[1] == g && clearColorValue[2] == b && clearColorValue[3] == a)
+	{
+		stats.filtered++;
+		return;
+	}
+
+	clearColorValue[0] = r;
+	clearColorValue[1] = g;
+	clearColorValue[2] = b;
+	clearColorValue[3] = a;
+	clearColorKnown = true;
+	stats.issued++;
+	glClearColor(r, g, b, a);
+}
+
+void GLState::deleteProgram(unsigned int pProgram)
+{
+	glDeleteProgram(pProgram);
+	// A program stays in use until something else is made current, so
+	// only forget it instead of assuming 0
+	if (program == pProgram)
+		program = UNKNOWN;
+}
+
+void GLState::deleteVertexArray(unsigned int pVertexArray)
+{
+	glDeleteVertexArrays(1, &pVertexArray);
+	if (vertexArray == pVertexArray)
+	{
+		vertexArray = 0;
+		buffers.erase(GL_ELEMENT_ARRAY_BUFFER);
+	}
+}
+
+void GLState::deleteBuffer(unsigned int buffer)
+{
+	glDeleteBuffers(1, &buffer);
+	for (auto& binding : buffers)
+	{
+		if (binding.second == buffer)
+			binding.second = 0;
+	}
+	for (auto& binding : indexedBuffers)
+	{
+		if (binding.second == buffer)
+			binding.second = 0;
+	}
+}
+
+void GLState::deleteTexture(unsigned int texture)
+{
+	glDeleteTextures(1, &texture);
+	for (auto& binding : textures)
+	{
+		if (binding.second == texture)
+			binding.second = 0;
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <unordered_map>
+
+// Shadows the bits of OpenGL state we touch every frame and drops calls
+// that would set something to the value it already has.
+// Everything goes through the one context we create, so the cache is static.
+// Anything calling GL directly behind its back (e.g. a UI library) should
+// be followed by invalidate().
+class GLState
+{
+public:
+	struct Stats
+	{
+		// Calls forwarded to the driver
+		unsigned int issued = 0;
+		// Calls dropped because the state was already current
+		unsigned int filtered = 0;
+	};
+
+	// Reset every frame by Renderer::prepare
+	static Stats stats;
+	static void resetStats();
+
+	// Forget everything we know, the next call of each kind will always be issued
+	static void invalidate();
+
+	static void useProgram(unsigned int program);
+	static void bindVertexArray(unsigned int vertexArray);
+	static void bindBuffer(GLenum target, unsigned int buffer);
+	static void bindBufferBase(GLenum target, unsigned int index, unsigned int buffer);
+	// Ranges usually move every frame (e.g. into a stream buffer), so these are always issued
+	static void bindBufferRange(GLenum target, unsigned int index, unsigned int buffer, GLintptr offset, GLsizeiptr size);
+	// Selects the texture unit as needed before binding
+	static void bindTexture(unsigned int unit, GLenum target, unsigned int texture);
+
+	static void enable(GLenum capability);
+	static void disable(GLenum capability);
+	static void clearColor(float r, float g, float b, float a);
+
+	// Deleting a bound object resets its binding to 0, these keep the cache in sync
+	static void deleteProgram(unsigned int program);
+	static void deleteVertexArray(unsigned int vertexArray);
+	static void deleteBuffer(unsigned int buffer);
+	static void deleteTexture(unsigned int texture);
+
+private:
+	// Never a valid object name, so the first bind after invalidate() always goes through
+	static const unsigned int UNKNOWN = 0xFFFFFFFF;
+
+	static unsigned int program;
+	static unsigned int vertexArray;
+	static unsigned int activeTextureUnit;
+	static float clearColorValue[4];
+	static bool clearColorKnown;
+
+	static std::unordered_map<GLenum, unsigned int> buffers;
+	// Keyed by (target << 32 | index)
+	static std::unordered_map<uint64_t, unsigned int> indexedBuffers;
+	// Keyed by (unit << 32 | target)
+	static std::unordered_map<uint64_t, unsigned int> textures;
+	static std::unordered_map<GLenum, bool> capabilities;
+
+	static bool changed(unsigned int& current, unsigned int value);
+};
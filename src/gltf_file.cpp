@@ -0,0 +1,606 @@
+#include "gltf_file.h"
+
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "json.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+
+static const uint32_t GLB_MAGIC = 0x46546C67; // "glTF"
+static const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+static const uint32_t GLB_CHUNK_BIN = 0x004E4942;
+
+static const int GLTF_BYTE = 5120;
+static const int GLTF_UNSIGNED_BYTE = 5121;
+static const int GLTF_SHORT = 5122;
+static const int GLTF_UNSIGNED_SHORT = 5123;
+static const int GLTF_UNSIGNED_INT = 5125;
+static const int GLTF_FLOAT = 5126;
+static const int GLTF_TRIANGLES = 4;
+
+struct GltfBuffer
+{
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+};
+
+// Everything a primitive needs to decode itself, read only once loading starts
+struct GltfDocument
+{
+	JsonValue json;
+	std::vector<GltfBuffer> buffers;
+	// Storage behind the buffers
+	std::vector<MappedFile> files;
+	std::vector<std::vector<unsigned char>> decoded;
+};
+
+struct GltfPrimitive
+{
+	const JsonValue* json;
+	glm::mat4 transform;
+	MeshData mesh;
+	std::string error;
+};
+
+static int base64Value(unsigned char c)
+{
+	if (c >= 'A' && c <= 'Z') return c - 'A';
+	if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+	if (c >= '0' && c <= '9') return c - '0' + 52;
+	if (c == '+' || c == '-') return 62;
+	if (c == '/' || c == '_') return 63;
+	return -1;
+}
+
+static bool decodeBase64(const char* text, size_t length, std::vector<unsigned char>& out)
+{
+	out.clear();
+	out.reserve(length / 4 * 3);
+	uint32_t bits = 0;
+	int bitCount = 0;
+	for (size_t i = 0; i < length; i++)
+	{
+		if (text[i] == '=')
+			break;
+		int value = base64Value((unsigned char)text[i]);
+		if (value < 0)
+			return false;
+		bits = (bits << 6) | (uint32_t)value;
+		bitCount += 6;
+		if (bitCount >= 8)
+		{
+			bitCount -= 8;
+			out.push_back((unsigned char)(bits >> bitCount));
+		}
+	}
+	return true;
+}
+
+// Sizes, offsets and counts as size_t, fallback when missing. Fails for anything but a whole number
+// from 0 to 2^53 (far past any real file): casting a negative, fractional or huge double is undefined.
+static bool readSize(const JsonValue& value, size_t fallback, size_t& out)
+{
+	if (value.isNull())
+	{
+		out = fallback;
+		return true;
+	}
+	double number = value.asNumber(-1.0);
+	if (!(number >= 0.0 && number <= 9007199254740992.0) || number != std::floor(number))
+		return false;
+	out = (size_t)number;
+	return true;
+}
+
+// Indices into the document's arrays (accessors, bufferViews, meshes, nodes...). Fails when missing
+// or anything but a whole number from 0 to INT_MAX, so a bad one can't wrap into a valid looking index.
+static bool readIndex(const JsonValue& value, int& out)
+{
+	double number = value.asNumber(-1.0);
+	if (!(number >= 0.0 && number <= INT_MAX) || number != std::floor(number))
+		return false;
+	out = (int)number;
+	return true;
+}
+
+static bool loadBuffers(const std::string& path, const GltfBuffer& glbBinary, GltfDocument& document)
+{
+	const JsonValue& buffers = document.json["buffers"];
+	std::filesystem::path directory = std::filesystem::path(path).parent_path();
+	document.buffers.resize(buffers.size());
+	// Reserved up front, buffers point into these
+	document.files.reserve(buffers.size());
+	document.decoded.reserve(buffers.size());
+
+	for (size_t i = 0; i < buffers.size(); i++)
+	{
+		const JsonValue& buffer = buffers.at(i);
+		size_t byteLength;
+		if (!readSize(buffer["byteLength"], 0, byteLength))
+		{
+			std::cout << "ERROR::GLTF::INVALID_BUFFER_LENGTH " << path << ": buffer " << i << std::endl;
+			return false;
+		}
+		GltfBuffer& target = document.buffers[i];
+
+		if (!buffer.has("uri"))
+		{
+			// The first buffer of a .glb without a uri is its binary chunk
+			if (i != 0 || !glbBinary.data)
+			{
+				std::cout << "ERROR::GLTF::BUFFER_WITHOUT_URI " << path << ": buffer " << i << std::endl;
+				return false;
+			}
+			target = glbBinary;
+		}
+		else
+		{
+			const std::string& uri = buffer["uri"].asString();
+			if (uri.compare(0, 5, "data:") == 0)
+			{
+				size_t comma = uri.find(',');
+				document.decoded.emplace_back();
+				if (comma == std::string::npos || uri.rfind(";base64", comma) == std::string::npos
+					|| !decodeBase64(uri.data() + comma + 1, uri.size() - comma - 1, document.decoded.back()))
+				{
+					std::cout << "ERROR::GLTF::INVALID_DATA_URI " << path << ": buffer " << i << std::endl;
+					return false;
+				}
+				target.data = document.decoded.back().data();
+				target.size = document.decoded.back().size();
+			}
+			else
+			{
+				// Relative to the .gltf. Percent encoded uris aren't decoded, exporters rarely write them.
+				std::string bufferPath = (directory / uri).string();
+				document.files.emplace_back(bufferPath);
+				if (!document.files.back().isOpen())
+				{
+					std::cout << "ERROR::GLTF::BUFFER_NOT_FOUND " << bufferPath << std::endl;
+					return false;
+				}
+				target.data = (const unsigned char*)document.files.back().data();
+				target.size = document.files.back().size();
+			}
+		}
+
+		if (target.size < byteLength)
+		{
+			std::cout << "ERROR::GLTF::BUFFER_TOO_SHORT " << path << ": buffer " << i << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+static size_t componentSize(int componentType)
+{
+	switch (componentType)
+	{
+	case GLTF_BYTE:
+	case GLTF_UNSIGNED_BYTE:
+		return 1;
+	case GLTF_SHORT:
+	case GLTF_UNSIGNED_SHORT:
+		return 2;
+	case GLTF_UNSIGNED_INT:
+	case GLTF_FLOAT:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+static int componentCount(const std::string& type)
+{
+	if (type == "SCALAR") return 1;
+	if (type == "VEC2") return 2;
+	if (type == "VEC3") return 3;
+	if (type == "VEC4") return 4;
+	return 0;
+}
+
+// Where an accessor's elements are, after checking they all lie inside its buffer view and buffer
+struct AccessorView
+{
+	const unsigned char* data = nullptr;
+	size_t count = 0;
+	size_t stride = 0;
+	int componentType = 0;
+	int components = 0;
+	bool normalized = false;
+};
+
+static bool viewAccessor(const GltfDocument& document, int index, AccessorView& view, std::string& error)
+{
+	const JsonValue& accessor = document.json["accessors"].at(index);
+	if (!accessor.isObject())
+	{
+		error = "missing accessor " + std::to_string(index);
+		return false;
+	}
+	if (accessor.has("sparse") || !accessor.has("bufferView"))
+	{
+		error = "sparse or empty accessor " + std::to_string(index);
+		return false;
+	}
+
+	view.componentType = accessor["componentType"].asInt();
+	view.components = componentCount(accessor["type"].asString());
+	view.normalized = accessor["normalized"].asBool();
+	size_t elementSize = componentSize(view.componentType) * view.components;
+
+	int bufferViewIndex = 0, bufferIndex = 0;
+	bool indicesValid = readIndex(accessor["bufferView"], bufferViewIndex);
+	const JsonValue& bufferView = document.json["bufferViews"].at(bufferViewIndex);
+	indicesValid = indicesValid && readIndex(bufferView["buffer"], bufferIndex);
+	if (elementSize == 0 || !indicesValid || !bufferView.isObject() || (size_t)bufferIndex >= document.buffers.size())
+	{
+		error = "invalid accessor " + std::to_string(index);
+		return false;
+	}
+	const GltfBuffer& buffer = document.buffers[bufferIndex];
+	size_t viewOffset, viewLength, accessorOffset;
+	if (!readSize(accessor["count"], 0, view.count) || !readSize(bufferView["byteOffset"], 0, viewOffset)
+		|| !readSize(bufferView["byteLength"], 0, viewLength) || !readSize(accessor["byteOffset"], 0, accessorOffset)
+		|| !readSize(bufferView["byteStride"], elementSize, view.stride) || view.stride < elementSize)
+	{
+		error = "invalid accessor " + std::to_string(index);
+		return false;
+	}
+
+	// Divided rather than multiplied out, a huge count must not wrap around and pass
+	if (viewOffset > buffer.size || viewLength > buffer.size - viewOffset || accessorOffset > viewLength
+		|| (view.count > 0 && (viewLength - accessorOffset < elementSize
+			|| view.count - 1 > (viewLength - accessorOffset - elementSize) / view.stride)))
+	{
+		error = "accessor " + std::to_string(index) + " reads past its buffer";
+		return false;
+	}
+	view.data = buffer.data + viewOffset + accessorOffset;
+	return true;
+}
+
+// Reads the first components of every element as floats, converting normalized integers
+static bool readFloats(const GltfDocument& document, int index, int components, std::vector<float>& out, std::string& error)
+{
+	AccessorView view;
+	if (!viewAccessor(document, index, view, error))
+		return false;
+	if (view.components < components || (view.componentType != GLTF_FLOAT && !view.normalized))
+	{
+		error = "accessor " + std::to_string(index) + " has an unsupported type";
+		return false;
+	}
+
+	out.resize(view.count * components);
+	for (size_t i = 0; i < view.count; i++)
+	{
+		const unsigned char* element = view.data + i * view.stride;
+		for (int c = 0; c < components; c++)
+		{
+			float value = 0.0f;
+			switch (view.componentType)
+			{
+			case GLTF_FLOAT:
+				std::memcpy(&value, element + c * 4, 4);
+				break;
+			case GLTF_UNSIGNED_BYTE:
+				value = element[c] / 255.0f;
+				break;
+			case GLTF_UNSIGNED_SHORT:
+			{
+				uint16_t component;
+				std::memcpy(&component, element + c * 2, 2);
+				value = component / 65535.0f;
+				break;
+			}
+			default:
+				error = "accessor " + std::to_string(index) + " has an unsupported component type";
+				return false;
+			}
+			out[i * components + c] = value;
+		}
+	}
+	return true;
+}
+
+static bool readIndices(const GltfDocument& document, int index, std::vector<unsigned int>& out, std::string& error)
+{
+	AccessorView view;
+	if (!viewAccessor(document, index, view, error))
+		return false;
+
+	out.resize(view.count);
+	for (size_t i = 0; i < view.count; i++)
+	{
+		const unsigned char* element = view.data + i * view.stride;
+		switch (view.componentType)
+		{
+		case GLTF_UNSIGNED_BYTE:
+			out[i] = element[0];
+			break;
+		case GLTF_UNSIGNED_SHORT:
+		{
+			uint16_t value;
+			std::memcpy(&value, element, 2);
+			out[i] = value;
+			break;
+		}
+		case GLTF_UNSIGNED_INT:
+			std::memcpy(&out[i], element, 4);
+			break;
+		default:
+			error = "index accessor " + std::to_string(index) + " has an unsupported component type";
+			return false;
+		}
+	}
+	return true;
+}
+
+static void decodePrimitive(const GltfDocument& document, GltfPrimitive& primitive)
+{
+	const JsonValue& json = *primitive.json;
+	const JsonValue& attributes = json["attributes"];
+	MeshData& mesh = primitive.mesh;
+
+	int positions = 0, uvs = 0, indices = 0;
+	if (!readIndex(attributes["POSITION"], positions) || (attributes.has("TEXCOORD_0") && !readIndex(attributes["TEXCOORD_0"], uvs))
+		|| (json.has("indices") && !readIndex(json["indices"], indices)))
+	{
+		primitive.error = "missing or invalid accessor index";
+		return;
+	}
+
+	if (!readFloats(document, positions, 3, mesh.positions, primitive.error))
+		return;
+	if (attributes.has("TEXCOORD_0"))
+	{
+		if (!readFloats(document, uvs, 2, mesh.uvs, primitive.error))
+			return;
+	}
+	mesh.uvs.resize(mesh.vertexCount() * 2, 0.0f);
+
+	if (json.has("indices"))
+	{
+		if (!readIndices(document, indices, mesh.indices, primitive.error))
+			return;
+	}
+	else
+	{
+		mesh.indices.resize(mesh.vertexCount());
+		for (size_t i = 0; i < mesh.indices.size(); i++)
+			mesh.indices[i] = (unsigned int)i;
+	}
+	mesh.indices.resize(mesh.indices.size() / 3 * 3);
+	for (unsigned int index : mesh.indices)
+	{
+		if (index >= mesh.vertexCount())
+		{
+			primitive.error = "index out of range";
+			return;
+		}
+	}
+
+	// Mirroring transforms flip the winding, swap two corners to keep triangles counterclockwise
+	if (primitive.transform != glm::mat4(1.0f))
+	{
+		for (size_t i = 0; i < mesh.positions.size(); i += 3)
+		{
+			glm::vec3 position = glm::vec3(primitive.transform * glm::vec4(mesh.positions[i], mesh.positions[i + 1], mesh.positions[i + 2], 1.0f));
+			std::memcpy(&mesh.positions[i], &position, sizeof(float) * 3);
+		}
+		if (glm::determinant(glm::mat3(primitive.transform)) < 0.0f)
+		{
+			for (size_t i = 0; i < mesh.indices.size(); i += 3)
+				std::swap(mesh.indices[i + 1], mesh.indices[i + 2]);
+		}
+	}
+}
+
+static glm::mat4 nodeTransform(const JsonValue& node)
+{
+	const JsonValue& matrix = node["matrix"];
+	if (matrix.size() == 16)
+	{
+		// Column major, like glm
+		glm::mat4 result;
+		for (int i = 0; i < 16; i++)
+			glm::value_ptr(result)[i] = (float)matrix.at(i).asNumber();
+		return result;
+	}
+
+	const JsonValue& t = node["translation"];
+	const JsonValue& r = node["rotation"];
+	const JsonValue& s = node["scale"];
+	glm::vec3 translation(t.at(0).asNumber(), t.at(1).asNumber(), t.at(2).asNumber());
+	// Stored x, y, z, w, glm's constructor takes w first
+	glm::quat rotation = r.size() == 4 ? glm::quat((float)r.at(3).asNumber(), (float)r.at(0).asNumber(), (float)r.at(1).asNumber(), (float)r.at(2).asNumber())
+		: glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	glm::vec3 scale = s.size() == 3 ? glm::vec3(s.at(0).asNumber(), s.at(1).asNumber(), s.at(2).asNumber()) : glm::vec3(1.0f);
+	return glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+}
+
+static void addMesh(const GltfDocument& document, int meshIndex, const glm::mat4& transform, std::vector<GltfPrimitive>& primitives)
+{
+	const JsonValue& meshPrimitives = document.json["meshes"].at(meshIndex)["primitives"];
+	for (size_t i = 0; i < meshPrimitives.size(); i++)
+	{
+		const JsonValue& primitive = meshPrimitives.at(i);
+		if (primitive["mode"].asInt(GLTF_TRIANGLES) != GLTF_TRIANGLES)
+			continue;
+		primitives.push_back({ &primitive, transform, MeshData(), std::string() });
+	}
+}
+
+// Nodes must form trees, so each is reached at most once. Without visited, a file sharing children
+// between parents would expand into exponentially many primitives, and a cycle would never end.
+// The depth limit keeps a long chain from running out of stack.
+static bool addNode(const GltfDocument& document, const JsonValue& index, const glm::mat4& parent, int depth, std::vector<bool>& visited,
+	std::vector<GltfPrimitive>& primitives, std::string& error)
+{
+	int nodeIndex = 0;
+	if (!readIndex(index, nodeIndex) || !document.json["nodes"].at(nodeIndex).isObject())
+	{
+		error = "missing or invalid node index";
+		return false;
+	}
+	const JsonValue& node = document.json["nodes"].at(nodeIndex);
+	if (visited[nodeIndex])
+	{
+		error = "node " + std::to_string(nodeIndex) + " has more than one parent";
+		return false;
+	}
+	if (depth > 64)
+	{
+		error = "node " + std::to_string(nodeIndex) + " is nested too deep";
+		return false;
+	}
+	visited[nodeIndex] = true;
+
+	glm::mat4 transform = parent * nodeTransform(node);
+	if (node.has("mesh"))
+	{
+		int meshIndex = 0;
+		if (!readIndex(node["mesh"], meshIndex) || !document.json["meshes"].at(meshIndex).isObject())
+		{
+			error = "node " + std::to_string(nodeIndex) + " has an invalid mesh";
+			return false;
+		}
+		addMesh(document, meshIndex, transform, primitives);
+	}
+	const JsonValue& children = node["children"];
+	for (size_t i = 0; i < children.size(); i++)
+	{
+		if (!addNode(document, children.at(i), transform, depth + 1, visited, primitives, error))
+			return false;
+	}
+	return true;
+}
+
+bool loadGltf(const std::string& path, MeshData& mesh, ThreadPool* threadPool)
+{
+	MappedFile file(path);
+	if (!file.isOpen())
+	{
+		std::cout << "ERROR::GLTF::FILE_NOT_FOUND " << path << std::endl;
+		return false;
+	}
+	mesh = MeshData();
+
+	// .glb: 12 byte header, then a JSON chunk and optionally a binary chunk, each with an 8 byte header
+	const char* json = file.data();
+	size_t jsonLength = file.size();
+	GltfBuffer glbBinary;
+	uint32_t magic = 0;
+	if (file.size() >= 12)
+		std::memcpy(&magic, file.data(), 4);
+	if (magic == GLB_MAGIC)
+	{
+		const unsigned char* data = (const unsigned char*)file.data();
+		size_t offset = 12;
+		jsonLength = 0;
+		while (offset + 8 <= file.size())
+		{
+			uint32_t chunkLength, chunkType;
+			std::memcpy(&chunkLength, data + offset, 4);
+			std::memcpy(&chunkType, data + offset + 4, 4);
+			offset += 8;
+			if (chunkLength > file.size() - offset)
+				break;
+			if (chunkType == GLB_CHUNK_JSON && jsonLength == 0)
+			{
+				json = (const char*)data + offset;
+				jsonLength = chunkLength;
+			}
+			else if (chunkType == GLB_CHUNK_BIN && !glbBinary.data)
+			{
+				glbBinary.data = data + offset;
+				glbBinary.size = chunkLength;
+			}
+			offset += chunkLength;
+		}
+		if (jsonLength == 0)
+		{
+			std::cout << "ERROR::GLTF::NO_JSON_CHUNK " << path << std::endl;
+			return false;
+		}
+	}
+
+	GltfDocument document;
+	if (!JsonValue::parse(json, jsonLength, document.json))
+	{
+		std::cout << "ERROR::GLTF::INVALID_JSON " << path << std::endl;
+		return false;
+	}
+	if (!loadBuffers(path, glbBinary, document))
+		return false;
+
+	// The default scene, or the first one. Files without scenes just list meshes.
+	std::vector<GltfPrimitive> primitives;
+	const JsonValue& scenes = document.json["scenes"];
+	if (scenes.size() > 0)
+	{
+		int sceneIndex = 0;
+		if ((document.json.has("scene") && !readIndex(document.json["scene"], sceneIndex)) || !scenes.at(sceneIndex).isObject())
+		{
+			std::cout << "ERROR::GLTF::INVALID_SCENE " << path << ": missing or invalid scene index" << std::endl;
+			return false;
+		}
+		const JsonValue& nodes = scenes.at(sceneIndex)["nodes"];
+		std::vector<bool> visited(document.json["nodes"].size(), false);
+		std::string error;
+		for (size_t i = 0; i < nodes.size(); i++)
+		{
+			if (!addNode(document, nodes.at(i), glm::mat4(1.0f), 0, visited, primitives, error))
+			{
+				std::cout << "ERROR::GLTF::INVALID_SCENE " << path << ": " << error << std::endl;
+				return false;
+			}
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < document.json["meshes"].size(); i++)
+			addMesh(document, (int)i, glm::mat4(1.0f), primitives);
+	}
+
+	if (threadPool)
+	{
+		threadPool->parallelFor(primitives.size(), 1, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				decodePrimitive(document, primitives[i]);
+		});
+	}
+	else
+	{
+		for (GltfPrimitive& primitive : primitives)
+			decodePrimitive(document, primitive);
+	}
+
+	for (const GltfPrimitive& primitive : primitives)
+	{
+		if (!primitive.error.empty())
+		{
+			std::cout << "ERROR::GLTF::INVALID_PRIMITIVE " << path << ": " << primitive.error << std::endl;
+			return false;
+		}
+		unsigned int base = (unsigned int)mesh.vertexCount();
+		mesh.positions.insert(mesh.positions.end(), primitive.mesh.positions.begin(), primitive.mesh.positions.end());
+		mesh.uvs.insert(mesh.uvs.end(), primitive.mesh.uvs.begin(), primitive.mesh.uvs.end());
+		for (unsigned int index : primitive.mesh.indices)
+			mesh.indices.push_back(base + index);
+	}
+	return true;
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <string>
+
+#include "mesh_data.h"
+
+class ThreadPool;
+
+// glTF 2.0 support: .gltf files with embedded (base64 data: URI) or external buffers, and .glb.
+// Every triangle primitive of the meshes in the default scene is merged into one mesh with the
+// node transforms applied, reading POSITION, TEXCOORD_0 and the indices. Everything else
+// (materials, normals, skins, morph targets, sparse accessors, other primitive modes) is skipped.
+// glTF puts v = 0 at the top of the image, which is how Texture uploads stb's rows, so uvs pass through.
+// Given a thread pool the primitives are decoded in parallel.
+bool loadGltf(const std::string& path, MeshData& mesh, ThreadPool* threadPool = nullptr);
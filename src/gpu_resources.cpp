@@ -0,0 +1,144 @@
+#include "gpu_resources.h"
+
+#include <glad/glad.h>
+
+#include <iostream>
+#include <map>
+
+#include "gl_state.h"
+
+std::unordered_map<uint64_t, GpuResources::Entry> GpuResources::ledger;
+std::vector<GpuResources::PendingDelete> GpuResources::pending;
+uint64_t GpuResources::frame = 0;
+bool GpuResources::shutDown = false;
+
+static const char* typeName(GpuResourceType type)
+{
+	switch (type)
+	{
+	case GPU_RESOURCE_BUFFER: return "buffers";
+	case GPU_RESOURCE_TEXTURE: return "textures";
+	case GPU_RESOURCE_VERTEX_ARRAY: return "vertex arrays";
+	case GPU_RESOURCE_PROGRAM: return "programs";
+	default: return "unknown";
+	}
+}
+
+unsigned int GpuResources::create(GpuResourceType type, const char* owner)
+{
+	unsigned int id = 0;
+	switch (type)
+	{
+	case GPU_RESOURCE_BUFFER:
+		glGenBuffers(1, &id);
+		break;
+	case GPU_RESOURCE_TEXTURE:
+		glGenTextures(1, &id);
+		break;
+	case GPU_RESOURCE_VERTEX_ARRAY:
+		glGenVertexArrays(1, &id);
+		break;
+	case GPU_RESOURCE_PROGRAM:
+		id = glCreateProgram();
+		break;
+	default:
+		break;
+	}
+
+	if (id == 0)
+		std::cout << "ERROR::GPU_RESOURCES::CREATE_FAILED " << typeName(type) << " for " << owner << std::endl;
+	else
+		ledger[key(type, id)] = { owner, 0 };
+	return id;
+}
+
+void GpuResources::destroy(GpuResourceType type, unsigned int id)
+{
+	if (shutDown || id == 0)
+		return;
+	ledger.erase(key(type, id));
+	pending.push_back({ type, id, frame });
+}
+
+void GpuResources::setMemory(GpuResourceType type, unsigned int id, size_t bytes)
+{
+	auto it = ledger.find(key(type, id));
+	if (it != ledger.end())
+		it->second.bytes = bytes;
+}
+
+void GpuResources::endFrame()
+{
+	frame++;
+	// Queued in frame order, so everything old enough is at the front
+	size_t retired = 0;
+	while (retired < pending.size() && pending[retired].frame + FRAMES_IN_FLIGHT <= frame)
+	{
+		deleteNow(pending[retired].type, pending[retired].id);
+		retired++;
+	}
+	pending.erase(pending.begin(), pending.begin() + retired);
+}
+
+void GpuResources::shutdown()
+{
+	for (const PendingDelete& object : pending)
+		deleteNow(object.type, object.id);
+	pending.clear();
+	if (!ledger.empty())
+		std::cout << ledger.size() << " GPU objects still alive at shutdown, the context frees them" << std::endl;
+	ledger.clear();
+	shutDown = true;
+}
+
+void GpuResources::deleteNow(GpuResourceType type, unsigned int id)
+{
+	switch (type)
+	{
+	case GPU_RESOURCE_BUFFER:
+		GLState::deleteBuffer(id);
+		break;
+	case GPU_RESOURCE_TEXTURE:
+		GLState::deleteTexture(id);
+		break;
+	case GPU_RESOURCE_VERTEX_ARRAY:
+		GLState::deleteVertexArray(id);
+		break;
+	case GPU_RESOURCE_PROGRAM:
+		GLState::deleteProgram(id);
+		break;
+	default:
+		break;
+	}
+}
+
+GpuResources::Totals GpuResources::getTotals()
+{
+	Totals totals;
+	totals.objects = (unsigned int)ledger.size();
+	for (const auto& entry : ledger)
+		totals.bytes += entry.second.bytes;
+	totals.pendingDeletes = (unsigned int)pending.size();
+	return totals;
+}
+
+void GpuResources::printReport()
+{
+	// Sorted so the report reads the same every time
+	std::map<std::pair<int, std::string>, std::pair<unsigned int, size_t>> groups;
+	for (const auto& entry : ledger)
+	{
+		auto& group = groups[{ (int)(entry.first >> 32), entry.second.owner }];
+		group.first++;
+		group.second += entry.second.bytes;
+	}
+
+	Totals totals = getTotals();
+	std::cout << "GPU memory: " << totals.objects << " objects, " << totals.bytes / 1024 << " KB, "
+		<< totals.pendingDeletes << " waiting to be deleted" << std::endl;
+	for (const auto& group : groups)
+	{
+		std::cout << "  " << typeName((GpuResourceType)group.first.first) << " of " << group.first.second << ": "
+			<< group.second.first << ", " << group.second.second / 1024 << " KB" << std::endl;
+	}
+}
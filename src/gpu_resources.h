@@ -0,0 +1,129 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+enum GpuResourceType
+{
+	GPU_RESOURCE_BUFFER,
+	GPU_RESOURCE_TEXTURE,
+	GPU_RESOURCE_VERTEX_ARRAY,
+	GPU_RESOURCE_PROGRAM,
+	GPU_RESOURCE_TYPE_COUNT
+};
+
+// Creates and frees every GL object we own, and keeps a ledger of what's alive.
+// Objects aren't deleted the moment their owner lets go: frames already submitted may still
+// read them, so deletion waits until FRAMES_IN_FLIGHT more frames have ended. Like GLState,
+// everything goes through the one context, so it's all static.
+// Owners are short labels ("Texture", "GeometryPool"...) and must be string literals.
+class GpuResources
+{
+public:
+	// Matches StreamBuffer::REGION_COUNT, the most frames the CPU gets ahead of the GPU
+	static const unsigned int FRAMES_IN_FLIGHT = 3;
+
+	struct Totals
+	{
+		unsigned int objects = 0;
+		size_t bytes = 0;
+		// Waiting for their frame to retire
+		unsigned int pendingDeletes = 0;
+	};
+
+	static unsigned int create(GpuResourceType type, const char* owner);
+	// Queues the object for deletion. Ignored after shutdown(), the context took it with it.
+	static void destroy(GpuResourceType type, unsigned int id);
+	// Records roughly how much GPU memory an object holds, replacing what was recorded before
+	static void setMemory(GpuResourceType type, unsigned int id, size_t bytes);
+
+	// Call once per frame after its last draw. Deletes whatever was released FRAMES_IN_FLIGHT frames ago.
+	static void endFrame();
+	// Deletes everything queued right away. Call before destroying the context:
+	// owners that outlive it (statics, objects on main's stack) then release without touching GL.
+	static void shutdown();
+	static bool isShutDown() { return shutDown; }
+
+	static Totals getTotals();
+	// Live objects and memory, per type and owner
+	static void printReport();
+
+private:
+	struct Entry
+	{
+		const char* owner;
+		size_t bytes;
+	};
+	struct PendingDelete
+	{
+		GpuResourceType type;
+		unsigned int id;
+		uint64_t frame;
+	};
+
+	// Keyed by (type << 32 | id)
+	static std::unordered_map<uint64_t, Entry> ledger;
+	static std::vector<PendingDelete> pending;
+	static uint64_t frame;
+	static bool shutDown;
+
+	static void deleteNow(GpuResourceType type, unsigned int id);
+	static uint64_t key(GpuResourceType type, unsigned int id) { return ((uint64_t)type << 32) | id; }
+};
+
+// Owns one GL object and releases it through GpuResources when it goes away.
+// Move-only, so there's always exactly one owner; give it to a shared_ptr'd owner to share.
+template<GpuResourceType Type>
+class GLHandle
+{
+public:
+	GLHandle() = default;
+	~GLHandle() { reset(); }
+
+	GLHandle(GLHandle&& other) noexcept : id(other.id) { other.id = 0; }
+	GLHandle& operator=(GLHandle&& other) noexcept
+	{
+		if (this != &other)
+		{
+			reset();
+			id = other.id;
+			other.id = 0;
+		}
+		return *this;
+	}
+	GLHandle(const GLHandle&) = delete;
+	GLHandle& operator=(const GLHandle&) = delete;
+
+	static GLHandle create(const char* owner)
+	{
+		GLHandle handle;
+		handle.id = GpuResources::create(Type, owner);
+		return handle;
+	}
+
+	unsigned int get() const { return id; }
+	explicit operator bool() const { return id != 0; }
+
+	void setMemory(size_t bytes) const
+	{
+		if (id != 0)
+			GpuResources::setMemory(Type, id, bytes);
+	}
+	void reset()
+	{
+		if (id != 0)
+			GpuResources::destroy(Type, id);
+		id = 0;
+	}
+
+private:
+	unsigned int id = 0;
+};
+
+typedef GLHandle<GPU_RESOURCE_BUFFER> BufferHandle;
+typedef GLHandle<GPU_RESOURCE_TEXTURE> TextureHandle;
+typedef GLHandle<GPU_RESOURCE_VERTEX_ARRAY> VertexArrayHandle;
+typedef GLHandle<GPU_RESOURCE_PROGRAM> ProgramHandle;
@@ -0,0 +1,113 @@
+#include "indirect_renderer.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "geometry_pool.h"
+#include "gl_state.h"
+#include "renderer.h"
+
+// Starting sizes of the per-frame regions, they grow as needed
+static const size_t COMMAND_REGION_SIZE = 64 * 1024;
+static const size_t DATA_REGION_SIZE = 4 * 1024 * 1024;
+
+IndirectRenderer::IndirectRenderer()
+	: commandStream(GL_DRAW_INDIRECT_BUFFER, COMMAND_REGION_SIZE), dataStream(GL_SHADER_STORAGE_BUFFER, DATA_REGION_SIZE)
+{
+	GLint alignment = 0;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	storageAlignment = std::max<size_t>(alignment, sizeof(glm::mat4));
+}
+
+void IndirectRenderer::render(const std::vector<Entity>& entities, const std::vector<uint32_t>& visible, Shader& shader)
+{
+	stats = IndirectStats();
+
+	// Group by mesh, then the meshes by VAO and texture. Each group becomes one multi-draw.
+	for (auto& entry : transforms)
+		entry.second.clear();
+	for (auto& bucket : buckets)
+		bucket.second.clear();
+
+	for (uint32_t index : visible)
+	{
+		const Entity& entity = entities[index];
+		const ModelLod& lod = entity.model->getLod(entity.lod);
+		std::vector<glm::mat4>& meshTransforms = transforms[lod.geometry];
+		if (meshTransforms.empty())
+			buckets[((uint64_t)lod.VAO_ID << 32) | entity.model->texture->textureID].push_back(lod.geometry);
+		meshTransforms.push_back(entity.transform * entity.model->positionDecode);
+		stats.instances++;
+	}
+	for (auto& bucket : buckets)
+		stats.drawCommands += (unsigned int)bucket.second.size();
+	if (stats.drawCommands == 0)
+		return;
+
+	commandStream.beginFrame();
+	dataStream.beginFrame();
+
+	size_t commandOffset;
+	DrawElementsIndirectCommand* commands = (DrawElementsIndirectCommand*)commandStream.allocate(
+		stats.drawCommands * sizeof(DrawElementsIndirectCommand), sizeof(DrawElementsIndirectCommand), commandOffset);
+
+	// Draw data and transforms share one allocation, so a grow can't separate them
+	size_t drawDataSize = (stats.drawCommands * sizeof(DrawData) + storageAlignment - 1) / storageAlignment * storageAlignment;
+	size_t transformSize = stats.instances * sizeof(glm::mat4);
+	size_t dataOffset;
+	unsigned char* data = (unsigned char*)dataStream.allocate(drawDataSize + transformSize, storageAlignment, dataOffset);
+	DrawData* drawData = (DrawData*)data;
+	glm::mat4* transformData = (glm::mat4*)(data + drawDataSize);
+
+	unsigned int draw = 0;
+	unsigned int firstTransform = 0;
+	for (auto& bucket : buckets)
+	{
+		for (GeometryHandle geometry : bucket.second)
+		{
+			// Indices are relative to the mesh, baseVertex moves them to its vertices in the pool
+			const GeometryRange& range = GeometryPool::shared().getRange(geometry);
+			const std::vector<glm::mat4>& meshTransforms = transforms[geometry];
+
+			commands[draw] = { range.indexCount, (unsigned int)meshTransforms.size(), range.firstIndex, (int)range.baseVertex, 0 };
+			drawData[draw].firstTransform = firstTransform;
+			std::memcpy(transformData + firstTransform, meshTransforms.data(), meshTransforms.size() * sizeof(glm::mat4));
+
+			firstTransform += (unsigned int)meshTransforms.size();
+			draw++;
+		}
+	}
+
+	shader.activate();
+	if (drawOffsetShaderID != shader.ID)
+	{
+		drawOffsetShaderID = shader.ID;
+		drawOffsetLocation = shader.getUniformLocation("drawOffset");
+	}
+
+	GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandStream.getBufferID());
+	GLState::bindBufferRange(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, dataStream.getBufferID(), dataOffset, drawDataSize);
+	GLState::bindBufferRange(GL_SHADER_STORAGE_BUFFER, TRANSFORM_BINDING, dataStream.getBufferID(), dataOffset + drawDataSize, std::max<size_t>(transformSize, sizeof(glm::mat4)));
+
+	unsigned int firstDraw = 0;
+	for (auto& bucket : buckets)
+	{
+		GLsizei drawCount = (GLsizei)bucket.second.size();
+		if (drawCount == 0)
+			continue;
+
+		GLState::bindVertexArray((unsigned int)(bucket.first >> 32));
+		GLState::bindTexture(0, GL_TEXTURE_2D, (unsigned int)bucket.first);
+		// gl_DrawID restarts at 0 for every multi-draw
+		shader.setInt(drawOffsetLocation, (int)firstDraw);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(commandOffset + firstDraw * sizeof(DrawElementsIndirectCommand)), drawCount, 0);
+		stats.multiDrawCalls++;
+		firstDraw += drawCount;
+	}
+
+	commandStream.endFrame();
+	dataStream.endFrame();
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "entity.h"
+#include "shader_s.h"
+#include "stream_buffer.h"
+
+// Layout of one glMultiDrawElementsIndirect command, fixed by the GL spec
+struct DrawElementsIndirectCommand
+{
+	unsigned int count;
+	unsigned int instanceCount;
+	unsigned int firstIndex;
+	int baseVertex;
+	unsigned int baseInstance;
+};
+
+struct IndirectStats
+{
+	unsigned int multiDrawCalls = 0;
+	// Commands across all multi-draws, one per model drawn
+	unsigned int drawCommands = 0;
+	unsigned int instances = 0;
+};
+
+// Draws entities with one glMultiDrawElementsIndirect per texture instead of one draw per model.
+// Model geometry already lives in GeometryPool's shared buffers, so a single VAO per vertex
+// format serves every model. Each frame the commands are built on the CPU, one per model LOD
+// with an instance per entity, and streamed with the transforms. The shader finds its
+// transforms through gl_DrawID, see entity_indirect.shader. Needs GL 4.6 (or ARB_shader_draw_parameters).
+class IndirectRenderer
+{
+public:
+	// Shader storage bindings used by entity_indirect.shader
+	static const unsigned int TRANSFORM_BINDING = 1;
+	static const unsigned int DRAW_DATA_BINDING = 2;
+
+	IndirectStats stats;
+
+	IndirectRenderer();
+
+	IndirectRenderer(const IndirectRenderer&) = delete;
+	IndirectRenderer& operator=(const IndirectRenderer&) = delete;
+
+	// Draws entities[i] for each i in visible, at the LOD picked for each entity
+	void render(const std::vector<Entity>& entities, const std::vector<uint32_t>& visible, Shader& shader);
+
+private:
+	// Per draw data read by the shader at gl_DrawID. std430 doesn't pad structs of scalars,
+	// so this matches the DrawData array in the shader byte for byte.
+	struct DrawData
+	{
+		unsigned int firstTransform;
+	};
+
+	StreamBuffer commandStream;
+	StreamBuffer dataStream;
+	size_t storageAlignment = 256;
+
+	// Reused between frames. Transforms keyed by pool geometry, one command per mesh,
+	// and the meshes grouped into buckets keyed by (VAO << 32 | texture), one multi-draw each.
+	std::unordered_map<GeometryHandle, std::vector<glm::mat4>> transforms;
+	std::unordered_map<uint64_t, std::vector<GeometryHandle>> buckets;
+
+	int drawOffsetLocation = -1;
+	unsigned int drawOffsetShaderID = 0;
+};
@@ -0,0 +1,296 @@
+#include "json.h"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "number_parser.h"
+
+// Recursive descent over the text, one function per JSON production
+class JsonParser
+{
+public:
+	JsonParser(const char* text, size_t length) : begin(text), p(text), end(text + length) {}
+
+	bool parseDocument(JsonValue& value)
+	{
+		skipWhitespace();
+		if (!parseValue(value, 0))
+			return false;
+		skipWhitespace();
+		if (p != end)
+			return fail("trailing characters");
+		return true;
+	}
+
+private:
+	// Deeper than any real file, stops malicious nesting from overflowing the stack
+	static const int MAX_DEPTH = 256;
+
+	const char* begin;
+	const char* p;
+	const char* end;
+
+	bool fail(const char* message)
+	{
+		std::cout << "ERROR::JSON::" << message << " at offset " << (p - begin) << std::endl;
+		return false;
+	}
+
+	void skipWhitespace()
+	{
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+			p++;
+	}
+
+	bool consume(const char* word)
+	{
+		size_t length = std::strlen(word);
+		if ((size_t)(end - p) < length || std::memcmp(p, word, length) != 0)
+			return false;
+		p += length;
+		return true;
+	}
+
+	bool parseValue(JsonValue& value, int depth)
+	{
+		if (depth > MAX_DEPTH)
+			return fail("nested too deep");
+		if (p == end)
+			return fail("unexpected end");
+
+		switch (*p)
+		{
+		case '{':
+			return parseObject(value, depth);
+		case '[':
+			return parseArray(value, depth);
+		case '"':
+			value.type = JsonValue::JSON_STRING;
+			return parseString(value.string);
+		case 't':
+		case 'f':
+			value.type = JsonValue::JSON_BOOL;
+			value.boolean = *p == 't';
+			if (!consume(value.boolean ? "true" : "false"))
+				return fail("invalid literal");
+			return true;
+		case 'n':
+			value.type = JsonValue::JSON_NULL;
+			if (!consume("null"))
+				return fail("invalid literal");
+			return true;
+		default:
+		{
+			const char* numberEnd = parseDouble(p, end, value.number);
+			if (numberEnd == p)
+				return fail("unexpected character");
+			value.type = JsonValue::JSON_NUMBER;
+			p = numberEnd;
+			return true;
+		}
+		}
+	}
+
+	bool parseObject(JsonValue& value, int depth)
+	{
+		value.type = JsonValue::JSON_OBJECT;
+		p++;
+		skipWhitespace();
+		if (p < end && *p == '}')
+		{
+			p++;
+			return true;
+		}
+		while (true)
+		{
+			skipWhitespace();
+			if (p == end || *p != '"')
+				return fail("expected a key");
+			value.members.emplace_back();
+			if (!parseString(value.members.back().first))
+				return false;
+			skipWhitespace();
+			if (p == end || *p != ':')
+				return fail("expected ':'");
+			p++;
+			skipWhitespace();
+			if (!parseValue(value.members.back().second, depth + 1))
+				return false;
+			skipWhitespace();
+			if (p < end && *p == ',')
+			{
+				p++;
+				continue;
+			}
+			if (p < end && *p == '}')
+			{
+				p++;
+				return true;
+			}
+			return fail("expected ',' or '}'");
+		}
+	}
+
+	bool parseArray(JsonValue& value, int depth)
+	{
+		value.type = JsonValue::JSON_ARRAY;
+		p++;
+		skipWhitespace();
+		if (p < end && *p == ']')
+		{
+			p++;
+			return true;
+		}
+		while (true)
+		{
+			skipWhitespace();
+			value.elements.emplace_back();
+			if (!parseValue(value.elements.back(), depth + 1))
+				return false;
+			skipWhitespace();
+			if (p < end && *p == ',')
+			{
+				p++;
+				continue;
+			}
+			if (p < end && *p == ']')
+			{
+				p++;
+				return true;
+			}
+			return fail("expected ',' or ']'");
+		}
+	}
+
+	bool parseHex(uint32_t& codePoint)
+	{
+		if (end - p < 4)
+			return fail("truncated \\u escape");
+		codePoint = 0;
+		for (int i = 0; i < 4; i++, p++)
+		{
+			char c = *p;
+			codePoint <<= 4;
+			if (c >= '0' && c <= '9')
+				codePoint |= c - '0';
+			else if (c >= 'a' && c <= 'f')
+				codePoint |= c - 'a' + 10;
+			else if (c >= 'A' && c <= 'F')
+				codePoint |= c - 'A' + 10;
+			else
+				return fail("invalid \\u escape");
+		}
+		return true;
+	}
+
+	static void appendUtf8(std::string& out, uint32_t codePoint)
+	{
+		if (codePoint < 0x80)
+			out += (char)codePoint;
+		else if (codePoint < 0x800)
+		{
+			out += (char)(0xC0 | (codePoint >> 6));
+			out += (char)(0x80 | (codePoint & 0x3F));
+		}
+		else if (codePoint < 0x10000)
+		{
+			out += (char)(0xE0 | (codePoint >> 12));
+			out += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+			out += (char)(0x80 | (codePoint & 0x3F));
+		}
+		else
+		{
+			out += (char)(0xF0 | (codePoint >> 18));
+			out += (char)(0x80 | ((codePoint >> 12) & 0x3F));
+			out += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+			out += (char)(0x80 | (codePoint & 0x3F));
+		}
+	}
+
+	bool parseString(std::string& out)
+	{
+		p++;
+		out.clear();
+		while (p < end && *p != '"')
+		{
+			// Copy runs without escapes in one go, base64 buffers can be megabytes long
+			const char* run = p;
+			while (p < end && *p != '"' && *p != '\\')
+				p++;
+			out.append(run, p);
+			if (p == end || *p == '"')
+				break;
+
+			p++;
+			if (p == end)
+				break;
+			char escaped = *p++;
+			switch (escaped)
+			{
+			case '"': out += '"'; break;
+			case '\\': out += '\\'; break;
+			case '/': out += '/'; break;
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'n': out += '\n'; break;
+			case 'r': out += '\r'; break;
+			case 't': out += '\t'; break;
+			case 'u':
+			{
+				uint32_t codePoint;
+				if (!parseHex(codePoint))
+					return false;
+				// Characters outside the basic plane come as a surrogate pair
+				if (codePoint >= 0xD800 && codePoint < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u')
+				{
+					p += 2;
+					uint32_t low;
+					if (!parseHex(low))
+						return false;
+					if (low < 0xDC00 || low > 0xDFFF)
+						return fail("invalid surrogate pair");
+					codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+				}
+				appendUtf8(out, codePoint);
+				break;
+			}
+			default:
+				return fail("invalid escape");
+			}
+		}
+		if (p == end)
+			return fail("unterminated string");
+		p++;
+		return true;
+	}
+};
+
+bool JsonValue::parse(const char* text, size_t length, JsonValue& value)
+{
+	value = JsonValue();
+	JsonParser parser(text, length);
+	return parser.parseDocument(value);
+}
+
+static const JsonValue NULL_VALUE;
+
+const JsonValue& JsonValue::at(size_t index) const
+{
+	if (type != JSON_ARRAY || index >= elements.size())
+		return NULL_VALUE;
+	return elements[index];
+}
+
+const JsonValue& JsonValue::operator[](const char* key) const
+{
+	if (type == JSON_OBJECT)
+	{
+		for (const auto& member : members)
+		{
+			if (member.first == key)
+				return member.second;
+		}
+	}
+	return NULL_VALUE;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <climits>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Just enough JSON for glTF: a parsed document is a tree of JsonValues.
+// Objects keep their members in file order and are searched linearly, fine for the handful
+// of keys glTF objects have. Numbers are all doubles.
+class JsonValue
+{
+public:
+	enum Type
+	{
+		JSON_NULL,
+		JSON_BOOL,
+		JSON_NUMBER,
+		JSON_STRING,
+		JSON_ARRAY,
+		JSON_OBJECT
+	};
+
+	// Returns false and prints where it went wrong if text isn't a single valid JSON value
+	static bool parse(const char* text, size_t length, JsonValue& value);
+
+	Type getType() const { return type; }
+	bool isNull() const { return type == JSON_NULL; }
+	bool isNumber() const { return type == JSON_NUMBER; }
+	bool isString() const { return type == JSON_STRING; }
+	bool isArray() const { return type == JSON_ARRAY; }
+	bool isObject() const { return type == JSON_OBJECT; }
+
+	// Fallbacks are returned when the value has a different type
+	bool asBool(bool fallback = false) const { return type == JSON_BOOL ? boolean : fallback; }
+	double asNumber(double fallback = 0.0) const { return type == JSON_NUMBER ? number : fallback; }
+	// Truncates fractions. Numbers outside int's range get the fallback too, casting them is undefined.
+	int asInt(int fallback = 0) const { return type == JSON_NUMBER && number >= INT_MIN && number <= INT_MAX ? (int)number : fallback; }
+	const std::string& asString() const { return string; }
+
+	// Array elements, 0 for anything else
+	size_t size() const { return type == JSON_ARRAY ? elements.size() : 0; }
+	// Missing elements and members are a null value, so lookups can be chained.
+	// Elements by at() rather than [], a literal 0 would be ambiguous with the key overload.
+	const JsonValue& at(size_t index) const;
+	const JsonValue& operator[](const char* key) const;
+	bool has(const char* key) const { return !(*this)[key].isNull(); }
+
+private:
+	Type type = JSON_NULL;
+	bool boolean = false;
+	double number = 0.0;
+	std::string string;
+	std::vector<JsonValue> elements;
+	std::vector<std::pair<std::string, JsonValue>> members;
+
+	friend class JsonParser;
+};
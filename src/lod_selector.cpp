@@ -0,0 +1,58 @@
+#include "lod_selector.h"
+
+#include <algorithm>
+#include <cmath>
+
+float LodSelector::pixelsPerUnit(float fovDegrees, float viewportHeight)
+{
+	// The view plane at distance 1 is 2 * tan(fov / 2) units high and spans the whole viewport
+	return viewportHeight / (2.0f * std::tan(glm::radians(fovDegrees) * 0.5f));
+}
+
+void LodSelector::select(std::vector<Entity>& entities, const std::vector<uint32_t>& visible, const Camera& camera, float viewportHeight)
+{
+	stats = LodStats();
+	float pixelScale = pixelsPerUnit(camera.FOV, viewportHeight);
+	float coarserThreshold = maxPixelError * (1.0f - hysteresis);
+	float finerThreshold = maxPixelError * (1.0f + hysteresis);
+
+	for (uint32_t index : visible)
+	{
+		Entity& entity = entities[index];
+		const std::vector<ModelLod>& lods = entity.model->lods;
+		unsigned int levelCount = (unsigned int)lods.size();
+		unsigned int current = std::min(entity.lod, levelCount - 1);
+
+		if (levelCount > 1)
+		{
+			// Distance to the closest point of the bounding sphere, so big entities don't drop detail
+			// while the camera is right next to them
+			glm::vec3 center = glm::vec3(entity.transform * glm::vec4(entity.model->boundingCenter, 1.0f));
+			float distance = glm::length(center - camera.cameraPos) - entity.model->boundingRadius * entity.scale;
+			distance = std::max(distance, camera.NEAR_PLANE);
+			float pixelsPerError = entity.scale * pixelScale / distance;
+
+			unsigned int level = current;
+			if (lods[current].error * pixelsPerError > finerThreshold)
+			{
+				// Too coarse, drop to the coarsest level that's good enough
+				while (level > 0 && lods[level].error * pixelsPerError > maxPixelError)
+					level--;
+			}
+			else
+			{
+				// Only go coarser once well inside the next level's range
+				while (level + 1 < levelCount && lods[level + 1].error * pixelsPerError <= coarserThreshold)
+					level++;
+			}
+
+			if (level != entity.lod)
+				stats.switches++;
+			entity.lod = level;
+			current = level;
+		}
+
+		stats.trianglesBefore += lods[0].vertex_count / 3;
+		stats.trianglesAfter += lods[current].vertex_count / 3;
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "camera.h"
+#include "entity.h"
+
+struct LodStats
+{
+	// Triangles the visible entities would cost at full detail
+	unsigned int trianglesBefore = 0;
+	// Triangles at the levels actually picked
+	unsigned int trianglesAfter = 0;
+	// Entities whose level changed this frame
+	unsigned int switches = 0;
+};
+
+// Picks a level of detail per entity from its model's LOD chain, the coarsest level whose
+// geometric error projects to at most maxPixelError pixels on screen.
+// To keep entities near a threshold from flickering between two levels, switching to a
+// coarser level needs the error to be a fraction below the threshold, and switching back
+// only happens once the current level is a fraction above it.
+class LodSelector
+{
+public:
+	float maxPixelError = 1.0f;
+	// Width of the dead band around maxPixelError, as a fraction of it
+	float hysteresis = 0.25f;
+
+	LodStats stats;
+
+	// Updates entity.lod for every index in visible. Entities not visible keep their level.
+	void select(std::vector<Entity>& entities, const std::vector<uint32_t>& visible, const Camera& camera, float viewportHeight);
+
+	// Pixels per unit of error at a distance of 1, for a vertical field of view in degrees
+	static float pixelsPerUnit(float fovDegrees, float viewportHeight);
+};
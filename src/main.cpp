@@ -1,5 +1,6 @@
 #include <iostream>
 #include <cmath>
+#include <memory>
 
 #include <glad/glad.h>
 #define GLFW_INCLUDE_NONE
@@ -13,10 +14,31 @@
 #include "shader_s.h"
 #include "display.h"
 #include "entity.h"
+#include "world.h"
+#include "components.h"
+#include "systems.h"
 #include "texture.h"
 #include "renderer.h"
 #include "controls.h"
 #include "model.h"
+#include "render_queue.h"
+#include "gl_state.h"
+#include "program_cache.h"
+#include "shader_library.h"
+#include "thread_pool.h"
+#include "texture_loader.h"
+#include "texture_registry.h"
+#include "culling.h"
+#include "bvh.h"
+#include "occlusion_culler.h"
+#include "occlusion_debug_view.h"
+#include "lod_selector.h"
+#include "command_list.h"
+#include "indirect_renderer.h"
+#include "cluster_culler.h"
+#include "geometry_pool.h"
+#include "gpu_resources.h"
+#include "benchmarks.h"
 
 
 #define USE_GPU_ENGINE 0
@@ -26,9 +48,44 @@ extern "C"
 	__declspec(dllexport) int AmdPowerXpressRequestHighPerformance = USE_GPU_ENGINE;
 }
 
+// Set to 1 to run the CPU benchmarks in benchmarks.cpp and exit, no window is opened
+#define RUN_BENCHMARKS 0
+// Set to e.g. 10000 to spawn a grid of extra cubes and log frame time/draw calls every second
+#define BENCHMARK_ENTITY_COUNT 0
+// The grid cycles through this many separate copies of the cube mesh, so there are distinct models to batch
+#define BENCHMARK_MODEL_COUNT 16
+// How the cubes get drawn:
+// RENDER_PATH_IMMEDIATE - one draw per entity, in vector order
+// RENDER_PATH_INSTANCED - one instanced draw per model
+// RENDER_PATH_QUEUE     - one draw per entity, sorted through a RenderQueue to skip redundant binds
+// RENDER_PATH_COMMAND_LISTS - same as the queue, but the packets are recorded on the thread pool
+// RENDER_PATH_INDIRECT  - one glMultiDrawElementsIndirect per texture through IndirectRenderer (GL 4.6)
+// RENDER_PATH_CLUSTERS  - meshlets culled on the CPU by ClusterCuller, the rest drawn with one multi-draw per texture (GL 4.3)
+#define RENDER_PATH_IMMEDIATE 0
+#define RENDER_PATH_INSTANCED 1
+#define RENDER_PATH_QUEUE 2
+#define RENDER_PATH_COMMAND_LISTS 3
+#define RENDER_PATH_INDIRECT 4
+#define RENDER_PATH_CLUSTERS 5
+#define RENDER_PATH RENDER_PATH_INSTANCED
+// 1 culls through a BVH that's refit every frame, 0 tests every entity with the SIMD culler
+#define USE_BVH 1
+// Frames between checks whether the refit BVH has degraded enough to rebuild it
+#define BVH_REBUILD_CHECK_INTERVAL 60
+// 1 rasterizes the occluder entities on the CPU and drops whatever is hidden behind them
+#define USE_OCCLUSION_CULLING 1
+// Draws the occlusion depth buffer in the bottom left corner
+#define SHOW_OCCLUSION_BUFFER 0
+// 1 stores model vertices as 16-bit positions and half float uvs (12 bytes), 0 as floats (20 bytes)
+#define QUANTIZE_VERTICES 1
+
 
 int main(void)
 {
+#if RUN_BENCHMARKS
+    runBenchmarks();
+    return 0;
+#endif
 
 	if (!glfwInit())
 		return -1;
@@ -48,8 +105,30 @@ int main(void)
 
     Camera camera;
     Controls controls(display.window, &camera);
-    Shader shader(RESOURCES_PATH "shaders/entity.shader");
+    ShaderLibrary shaders;
+    // Every render path streams the transforms through the renderer's ring buffer
+    // and reads them from the instance attribute
+    Shader& shader = shaders.get(RESOURCES_PATH "shaders/entity.shader", { "INSTANCED" });
+    ProgramCache::printReport();
     Renderer renderer;
+    RenderQueue renderQueue;
+    ThreadPool threadPool;
+    TextureLoader textureLoader(threadPool);
+    TextureRegistry textures(&textureLoader);
+    FrustumCuller culler;
+    BVH bvh;
+    std::vector<uint32_t> visibleCubes;
+    int framesSinceRebuildCheck = 0;
+    OcclusionCuller occlusion;
+    LodSelector lodSelector;
+    CommandRecorder recorder(threadPool);
+    ClusterCuller clusterCuller;
+    ClusterDrawList clusterDrawList;
+#if RENDER_PATH == RENDER_PATH_INDIRECT
+    Shader& indirectShader = shaders.get(RESOURCES_PATH "shaders/entity_indirect.shader");
+    IndirectRenderer indirectRenderer;
+#endif
+    OcclusionDebugView occlusionView(shaders.get(RESOURCES_PATH "shaders/occlusion_debug.shader"));
 
     const std::vector<float> vertices = {
         // Front face
@@ -144,17 +223,70 @@ int main(void)
         glm::vec3(-1.3f,  1.0f, -1.5f)
     };
 
-    Model model(RESOURCES_PATH "container.jpg", vertices, textureCoords, indices);
+    const VertexFormat vertexFormat = QUANTIZE_VERTICES ? VERTEX_FORMAT_QUANTIZED : VERTEX_FORMAT_POSITION_UV;
+    // Shows a placeholder until the image has been decoded and uploaded
+    Model model(textures.acquire(RESOURCES_PATH "container.jpg"), vertices, textureCoords, indices, vertexFormat);
     //Entity cube(&model, glm::vec3(0.0f, 0.0f, 0.0f), 0.0f, 0.0f, 0.0f, 0.5f);
 
-    std::vector<Entity> cubes;
+    World world;
+    // What's left of the World after extraction each frame, everything past this point works on it
+    RenderList scene;
+    // Every cube has the same components, extra ones (Spin, Occluder) go on the end
+    auto spawn = [&](Model* cubeModel, glm::vec3 pos, glm::quat rotation, float scale, auto... extra)
+    {
+        return world.create(Position{ pos }, Rotation{ rotation }, Scale{ scale }, LocalToWorld{},
+            LocalBounds{ AABB(cubeModel->boundsMin, cubeModel->boundsMax) }, WorldBounds{}, Renderable{ cubeModel }, LodLevel{ 0 }, extra...);
+    };
+    // Each cube spins a bit faster than the one before
+    const glm::quat tilt(glm::radians(glm::vec3(45.0f, 45.0f, 0.0f)));
+    int spinningCubes = 0;
+
+    for (const glm::vec3& pos : cubePositions)
+    {
+        spawn(&model, pos, tilt, 0.5f, Spin{ tilt, 20.0f * spinningCubes++ });
+    }
+
+#if BENCHMARK_ENTITY_COUNT > 0
+    std::vector<std::unique_ptr<Model>> benchmarkModels;
+    for (int i = 0; i < BENCHMARK_MODEL_COUNT; i++)
+        benchmarkModels.push_back(std::make_unique<Model>(model.texture, vertices, textureCoords, indices, vertexFormat));
 
-    for each(glm::vec3 pos in cubePositions)
+    // Fill a cube shaped grid in front of the camera
+    int gridSize = (int)std::ceil(std::cbrt((float)BENCHMARK_ENTITY_COUNT));
+    for (int i = 0; i < BENCHMARK_ENTITY_COUNT; i++)
     {
-        cubes.push_back(Entity(&model, pos, 45.0f, 45.0f, 0.0f, 0.5f));
+        glm::vec3 pos((i % gridSize) - gridSize / 2.0f, (i / gridSize) % gridSize - gridSize / 2.0f, -(float)(i / (gridSize * gridSize)) - 5.0f);
+        spawn(benchmarkModels[i % BENCHMARK_MODEL_COUNT].get(), pos * 1.5f, tilt, 0.5f, Spin{ tilt, 20.0f * spinningCubes++ });
     }
+    // The GL benchmarks draw the extracted entities
+    TransformSystem::update(world);
+    RenderExtractionSystem::extract(world, scene);
+    // Don't let vsync cap the frame rate we're measuring
+    glfwSwapInterval(0);
+    std::cout << "Benchmarking " << world.size() << " entities, render path " << RENDER_PATH << std::endl;
+    runVertexFormatBenchmark(renderer, shader, model.texture, camera, display);
+#if RENDER_PATH == RENDER_PATH_COMMAND_LISTS
+    runRecordingBenchmark(scene.entities, shader, camera);
+#endif
+#endif
+
+#if RENDER_PATH == RENDER_PATH_INDIRECT && BENCHMARK_ENTITY_COUNT > 0
+    runSubmissionBenchmark(renderer, indirectRenderer, scene.entities, shader, indirectShader, camera, display);
+#endif
+
+    // A big block behind the scene that hides part of the grid. It's drawn like any other
+    // entity but also rasterized on the CPU.
+    spawn(&model, glm::vec3(0.0f, 0.0f, -30.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), 16.0f, Occluder{});
 
     float lastFrame = 0.0f;
+    float benchmarkTimer = 0.0f;
+    int benchmarkFrames = 0;
+    unsigned int benchmarkDrawCalls = 0;
+    unsigned int benchmarkBindsAvoided = 0;
+    unsigned int benchmarkStateIssued = 0;
+    unsigned int benchmarkStateFiltered = 0;
+    size_t benchmarkBytesStreamed = 0;
+    double benchmarkFenceWait = 0.0;
 
 	while (!glfwWindowShouldClose(display.window))
 	{
@@ -165,19 +297,150 @@ int main(void)
         lastFrame = currentFrame;
 
         controls.processInput(display.window, deltaTime);
-        renderer.prepare();
+        // Spend at most a couple of milliseconds per frame on texture uploads
+        textureLoader.update(2.0);
+        // Models unloaded since last frame may have left the geometry buffers full of holes
+        GeometryPool::shared().compactIfFragmented();
+        renderer.prepare(camera, display);
+
+        AnimationSystem::update(world, (float)glfwGetTime());
+        TransformSystem::update(world);
+        RenderExtractionSystem::extract(world, scene);
 
-        //renderer.render(cube, shader, camera, display);
-        int idx = 0;
-        for each(Entity cube in cubes)
+        // Only submit what's on screen
+        float aspectRatio = display.displayWidth / display.displayHeight;
+#if USE_BVH
+        if (bvh.itemCount() != scene.entities.size())
         {
-            cube.rotationZ = (float)glfwGetTime() * 20 * idx;
-            renderer.render(cube, shader, camera, display);
-            idx += 1;
+            bvh.build(scene.bounds, &threadPool);
         }
+        else
+        {
+            bvh.refit(scene.bounds);
+            if (++framesSinceRebuildCheck >= BVH_REBUILD_CHECK_INTERVAL)
+            {
+                framesSinceRebuildCheck = 0;
+                if (bvh.needsRebuild())
+                    bvh.build(scene.bounds, &threadPool);
+            }
+        }
+        visibleCubes.clear();
+        bvh.queryFrustum(camera.getFrustum(aspectRatio), visibleCubes);
+#else
+        culler.gather(scene.entities);
+        culler.cull(camera.getFrustum(aspectRatio), visibleCubes);
+#endif
+#if USE_OCCLUSION_CULLING
+        // Then drop what's hidden behind the occluders
+        occlusion.beginFrame(camera.getProjectionMatrix(aspectRatio) * camera.getViewMatrix());
+        for (uint32_t idx : scene.occluders)
+            occlusion.addOccluder(*scene.entities[idx].model, scene.entities[idx].transform);
+        occlusion.rasterize(threadPool);
+        occlusion.cull(scene.bounds, visibleCubes, threadPool);
+#endif
+        // Models without a LOD chain always stay at level 0
+        lodSelector.select(scene.entities, visibleCubes, camera, display.displayHeight);
+        RenderExtractionSystem::writeBackLods(world, scene);
+
+        //renderer.render(cube, shader);
+        renderQueue.clear();
+        for (uint32_t idx : visibleCubes)
+        {
+#if RENDER_PATH == RENDER_PATH_IMMEDIATE
+            renderer.render(scene.entities[idx], shader);
+#elif RENDER_PATH == RENDER_PATH_QUEUE
+            const Entity& cube = scene.entities[idx];
+            float viewDepth = glm::dot(cube.position - camera.cameraPos, camera.cameraFront);
+            renderQueue.push(&shader, cube.model, cube.transform, viewDepth, camera.FAR_PLANE, cube.lod);
+#endif
+        }
+#if RENDER_PATH == RENDER_PATH_INSTANCED
+        renderer.renderInstanced(scene.entities, visibleCubes, shader);
+#elif RENDER_PATH == RENDER_PATH_QUEUE
+        renderQueue.sort();
+        renderer.submit(renderQueue);
+#elif RENDER_PATH == RENDER_PATH_COMMAND_LISTS
+        recorder.record(scene.entities, visibleCubes, shader, camera, renderQueue);
+        renderer.submit(renderQueue);
+#elif RENDER_PATH == RENDER_PATH_INDIRECT
+        indirectRenderer.render(scene.entities, visibleCubes, indirectShader);
+#elif RENDER_PATH == RENDER_PATH_CLUSTERS
+        clusterCuller.cull(scene.entities, visibleCubes, camera, aspectRatio, clusterDrawList);
+        renderer.submit(clusterDrawList, shader);
+#endif
+
+#if USE_OCCLUSION_CULLING && SHOW_OCCLUSION_BUFFER
+        occlusionView.draw(occlusion, camera.NEAR_PLANE, camera.FAR_PLANE);
+#endif
+
+        // Fences this frame's streamed data, after the last draw reading it
+        renderer.finishFrame();
+        // Deletes the GL objects released FRAMES_IN_FLIGHT frames ago, nothing in flight reads them anymore
+        GpuResources::endFrame();
 
         //std::cout << gameState.fps << " " << gameState.deltaTime << std::endl;
 
+#if BENCHMARK_ENTITY_COUNT > 0
+        benchmarkTimer += deltaTime;
+        benchmarkFrames++;
+#if RENDER_PATH == RENDER_PATH_INDIRECT
+        benchmarkDrawCalls += indirectRenderer.stats.multiDrawCalls;
+#else
+        benchmarkDrawCalls += renderer.stats.drawCalls;
+#endif
+        benchmarkBindsAvoided += renderer.stats.bindsAvoided;
+        benchmarkStateIssued += GLState::stats.issued;
+        benchmarkStateFiltered += GLState::stats.filtered;
+        benchmarkBytesStreamed += renderer.stats.bytesStreamed;
+        benchmarkFenceWait += renderer.stats.fenceWaitMilliseconds;
+        if (benchmarkTimer >= 1.0f)
+        {
+            std::cout << "Frame time: " << benchmarkTimer * 1000.0f / benchmarkFrames << " ms, draw calls/frame: "
+                << benchmarkDrawCalls / benchmarkFrames << ", binds avoided/frame: " << benchmarkBindsAvoided / benchmarkFrames
+                << ", GL state calls issued/filtered per frame: " << benchmarkStateIssued / benchmarkFrames << "/" << benchmarkStateFiltered / benchmarkFrames << std::endl;
+#if USE_BVH
+            std::cout << "BVH: " << visibleCubes.size() << " visible, " << bvh.stats.nodeCount << " nodes, last build "
+                << bvh.stats.buildMilliseconds << " ms, refit " << bvh.stats.refitMilliseconds << " ms, SAH cost " << bvh.cost() << std::endl;
+#else
+            std::cout << "Culling: " << culler.stats.visible << " visible, " << culler.stats.tested - culler.stats.visible << " culled, "
+                << culler.stats.nanosecondsPerEntity << " ns/entity" << std::endl;
+#endif
+#if USE_OCCLUSION_CULLING
+            std::cout << "Occlusion: " << occlusion.stats.occluded << " of " << occlusion.stats.tested << " occluded, "
+                << occlusion.stats.occluderTriangles << " occluder triangles, rasterize " << occlusion.stats.rasterizeMilliseconds
+                << " ms, test " << occlusion.stats.testMilliseconds << " ms" << std::endl;
+#endif
+#if RENDER_PATH == RENDER_PATH_COMMAND_LISTS
+            std::cout << "Recording: " << recorder.stats.commands << " commands in " << recorder.stats.slices << " slices, record "
+                << recorder.stats.recordMilliseconds << " ms, merge " << recorder.stats.mergeMilliseconds << " ms, sort "
+                << recorder.stats.sortMilliseconds << " ms" << std::endl;
+#endif
+#if RENDER_PATH == RENDER_PATH_CLUSTERS
+            std::cout << "Clusters: " << clusterCuller.stats.clustersTested << " tested, " << clusterCuller.stats.frustumCulled << " outside the frustum, "
+                << clusterCuller.stats.backfaceCulled << " back facing, " << clusterCuller.stats.trianglesRejected << " of " << clusterCuller.stats.trianglesTested
+                << " triangles rejected, " << clusterCuller.stats.commands << " commands, " << clusterCuller.stats.cullMilliseconds << " ms" << std::endl;
+#endif
+            std::cout << "Streamed " << benchmarkBytesStreamed / benchmarkFrames / 1024 << " KB/frame, fence wait "
+                << benchmarkFenceWait / benchmarkFrames << " ms/frame" << std::endl;
+            std::cout << "LOD: " << lodSelector.stats.trianglesBefore << " triangles at full detail, " << lodSelector.stats.trianglesAfter
+                << " submitted, " << lodSelector.stats.switches << " switches" << std::endl;
+            GeometryPool::Stats geometry = GeometryPool::shared().getStats();
+            std::cout << "Geometry: " << geometry.meshes << " meshes, vertices " << geometry.vertexBytesUsed / 1024 << "/" << geometry.vertexBytesCapacity / 1024
+                << " KB, indices " << geometry.indexBytesUsed / 1024 << "/" << geometry.indexBytesCapacity / 1024 << " KB, fragmentation "
+                << geometry.fragmentation << ", " << geometry.grows << " grows, " << geometry.compactions << " compactions" << std::endl;
+            textures.printReport();
+            GpuResources::printReport();
+            benchmarkTimer = 0.0f;
+            benchmarkFrames = 0;
+            benchmarkDrawCalls = 0;
+            benchmarkBindsAvoided = 0;
+            benchmarkStateIssued = 0;
+            benchmarkStateFiltered = 0;
+            benchmarkBytesStreamed = 0;
+            benchmarkFenceWait = 0.0;
+        }
+#endif
+
 		glfwSwapBuffers(display.window);
 		glfwPollEvents();
 	}
@@ -185,6 +448,8 @@ int main(void)
 	//there is no need to call the clear function for the libraries since the os will do that for us.
 	//by calling this functions we are just wasting time.
 	//glfwDestroyWindow(window);
+	// Whatever still holds GL objects after this (the renderer, models, the geometry pool) lets go without touching GL
+	GpuResources::shutdown();
 	glfwTerminate();
 	return 0;
 }
@@ -0,0 +1,158 @@
+#include "mapped_file.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path)
+{
+	open(path);
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		close();
+		std::swap(mapping, other.mapping);
+		std::swap(length, other.length);
+		std::swap(opened, other.opened);
+#ifdef _WIN32
+		std::swap(fileHandle, other.fileHandle);
+		std::swap(mappingHandle, other.mappingHandle);
+#endif
+	}
+	return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path)
+{
+	close();
+
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	fileHandle = file;
+	length = (size_t)fileSize.QuadPart;
+	opened = true;
+
+	// Zero length files can't be mapped, but they're still valid (empty) files
+	if (length == 0)
+		return true;
+
+	HANDLE fileMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!fileMapping)
+	{
+		close();
+		return false;
+	}
+	mappingHandle = fileMapping;
+
+	mapping = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+	if (!mapping)
+	{
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (mapping)
+		UnmapViewOfFile(mapping);
+	if (mappingHandle)
+		CloseHandle((HANDLE)mappingHandle);
+	if (fileHandle)
+		CloseHandle((HANDLE)fileHandle);
+
+	mapping = nullptr;
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+	length = 0;
+	opened = false;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path)
+{
+	close();
+
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	length = (size_t)info.st_size;
+	opened = true;
+
+	// Zero length files can't be mapped, but they're still valid (empty) files
+	if (length > 0)
+	{
+		mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapping == MAP_FAILED)
+		{
+			mapping = nullptr;
+			length = 0;
+			opened = false;
+		}
+		else
+		{
+			// We read front to back, let the kernel read ahead
+			madvise(mapping, length, MADV_SEQUENTIAL);
+		}
+	}
+
+	// The mapping keeps its own reference to the file
+	::close(fd);
+	return opened;
+}
+
+void MappedFile::close()
+{
+	if (mapping)
+		munmap(mapping, length);
+
+	mapping = nullptr;
+	length = 0;
+	opened = false;
+}
+
+#endif
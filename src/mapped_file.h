@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file.
+// The mapping lives as long as the object, so pointers into data() must not outlive it.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	explicit MappedFile(const std::string& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	// Returns false if the file couldn't be opened or mapped
+	bool open(const std::string& path);
+	void close();
+
+	bool isOpen() const { return opened; }
+	const char* data() const { return (const char*)mapping; }
+	size_t size() const { return length; }
+
+private:
+	void* mapping = nullptr;
+	size_t length = 0;
+	bool opened = false;
+
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Plain CPU-side mesh in the layout Model takes: 3 floats of position and 2 floats of
+// texture coordinates per vertex, and triangles as 3 indices each.
+// Vertices on a UV seam are duplicated, one copy per side, with identical positions.
+struct MeshData
+{
+	std::vector<float> positions;
+	std::vector<float> uvs;
+	std::vector<unsigned int> indices;
+
+	size_t vertexCount() const { return positions.size() / 3; }
+	size_t triangleCount() const { return indices.size() / 3; }
+};
+
+// Box around a mesh's positions and a sphere containing them all
+struct MeshBounds
+{
+	glm::vec3 min = glm::vec3(0.0f);
+	glm::vec3 max = glm::vec3(0.0f);
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = 0.0f;
+};
+
+// Positions are 3 floats per vertex. All zero for an empty mesh.
+inline MeshBounds computeMeshBounds(const std::vector<float>& positions)
+{
+	MeshBounds bounds;
+	if (positions.size() >= 3)
+	{
+		bounds.min = bounds.max = glm::vec3(positions[0], positions[1], positions[2]);
+		for (size_t i = 3; i + 2 < positions.size(); i += 3)
+		{
+			glm::vec3 position(positions[i], positions[i + 1], positions[i + 2]);
+			bounds.min = glm::min(bounds.min, position);
+			bounds.max = glm::max(bounds.max, position);
+		}
+	}
+
+	// Centering the sphere on the box is not minimal but close, and cheap
+	bounds.center = (bounds.min + bounds.max) * 0.5f;
+	float radiusSquared = 0.0f;
+	for (size_t i = 0; i + 2 < positions.size(); i += 3)
+	{
+		glm::vec3 offset = glm::vec3(positions[i], positions[i + 1], positions[i + 2]) - bounds.center;
+		radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+	}
+	bounds.radius = std::sqrt(radiusSquared);
+	return bounds;
+}
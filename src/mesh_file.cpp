@@ -0,0 +1,203 @@
+#include "mesh_file.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "mesh_optimizer.h"
+
+static uint64_t alignOffset(uint64_t offset)
+{
+	return (offset + MeshFile::ALIGNMENT - 1) / MeshFile::ALIGNMENT * MeshFile::ALIGNMENT;
+}
+
+CookedLod MeshFile::cook(MeshData mesh, VertexFormat format, const glm::vec3& boundsMin, const glm::vec3& boundsMax, float error)
+{
+	MeshOptimizer::optimize(mesh);
+
+	CookedLod lod;
+	lod.vertices = encodeVertices(format, mesh.positions, mesh.uvs, boundsMin, boundsMax);
+	lod.vertexCount = mesh.vertexCount();
+	// After optimizing, so neighbouring triangles are next to each other and land in the same meshlet
+	lod.meshlets = MeshletBuilder::build(mesh);
+	lod.indices = std::move(mesh.indices);
+	lod.error = error;
+	return lod;
+}
+
+bool MeshFile::write(const std::string& path, VertexFormat format, const MeshBounds& bounds, const std::vector<CookedLod>& lods)
+{
+	MeshFileHeader header = {};
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.vertexFormat = format;
+	header.vertexStride = vertexStride(format);
+	header.meshletSize = sizeof(Meshlet);
+	header.lodCount = (uint32_t)lods.size();
+	std::memcpy(header.boundsMin, &bounds.min, sizeof(header.boundsMin));
+	std::memcpy(header.boundsMax, &bounds.max, sizeof(header.boundsMax));
+	std::memcpy(header.boundingCenter, &bounds.center, sizeof(header.boundingCenter));
+	header.boundingRadius = bounds.radius;
+
+	// Lay the sections out first, the table of levels comes before them
+	std::vector<MeshFileLod> table(lods.size());
+	uint64_t offset = sizeof(MeshFileHeader) + sizeof(MeshFileLod) * lods.size();
+	for (size_t level = 0; level < lods.size(); level++)
+	{
+		const CookedLod& lod = lods[level];
+		MeshFileLod& entry = table[level];
+		entry.vertexCount = (uint32_t)lod.vertexCount;
+		entry.indexCount = (uint32_t)lod.indices.size();
+		entry.meshletCount = (uint32_t)lod.meshlets.size();
+		entry.error = lod.error;
+
+		entry.vertexOffset = alignOffset(offset);
+		offset = entry.vertexOffset + lod.vertices.size();
+		entry.indexOffset = alignOffset(offset);
+		offset = entry.indexOffset + lod.indices.size() * sizeof(unsigned int);
+		entry.meshletOffset = alignOffset(offset);
+		offset = entry.meshletOffset + lod.meshlets.size() * sizeof(Meshlet);
+	}
+
+	std::ofstream stream(path, std::ios::binary);
+	if (!stream)
+	{
+		std::cout << "ERROR::MESH_FILE::CANNOT_WRITE: " << path << std::endl;
+		return false;
+	}
+
+	uint64_t written = 0;
+	auto writeAt = [&](uint64_t at, const void* data, size_t size)
+	{
+		static const char padding[ALIGNMENT] = {};
+		stream.write(padding, at - written);
+		stream.write((const char*)data, size);
+		written = at + size;
+	};
+	writeAt(0, &header, sizeof(header));
+	writeAt(written, table.data(), sizeof(MeshFileLod) * table.size());
+	for (size_t level = 0; level < lods.size(); level++)
+	{
+		writeAt(table[level].vertexOffset, lods[level].vertices.data(), lods[level].vertices.size());
+		writeAt(table[level].indexOffset, lods[level].indices.data(), lods[level].indices.size() * sizeof(unsigned int));
+		writeAt(table[level].meshletOffset, lods[level].meshlets.data(), lods[level].meshlets.size() * sizeof(Meshlet));
+	}
+
+	if (!stream)
+	{
+		std::cout << "ERROR::MESH_FILE::CANNOT_WRITE: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool MeshFile::open(const std::string& path)
+{
+	if (!file.open(path))
+	{
+		std::cout << "ERROR::MESH_FILE::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+		return false;
+	}
+	if (!validate(path))
+	{
+		file.close();
+		return false;
+	}
+	return true;
+}
+
+bool MeshFile::validate(const std::string& path) const
+{
+	if (file.size() < sizeof(MeshFileHeader) || std::memcmp(getHeader().magic, MAGIC, sizeof(MAGIC)) != 0)
+	{
+		std::cout << "ERROR::MESH_FILE::NOT_A_MESH_FILE: " << path << std::endl;
+		return false;
+	}
+
+	const MeshFileHeader& header = getHeader();
+	if (header.version != VERSION)
+	{
+		std::cout << "ERROR::MESH_FILE::VERSION_MISMATCH: " << path << " is version " << header.version << ", expected " << VERSION << std::endl;
+		return false;
+	}
+	if (header.vertexFormat >= VERTEX_FORMAT_COUNT || header.vertexStride != vertexStride((VertexFormat)header.vertexFormat)
+		|| header.meshletSize != sizeof(Meshlet))
+	{
+		std::cout << "ERROR::MESH_FILE::LAYOUT_MISMATCH: " << path << std::endl;
+		return false;
+	}
+	if (header.lodCount == 0 || file.size() < sizeof(MeshFileHeader) + sizeof(MeshFileLod) * (uint64_t)header.lodCount)
+	{
+		std::cout << "ERROR::MESH_FILE::TRUNCATED: " << path << std::endl;
+		return false;
+	}
+
+	// Sizes are computed in 64 bits from 32 bit counts, so they can't overflow
+	auto inside = [&](uint64_t offset, uint64_t size)
+	{
+		return offset % ALIGNMENT == 0 && offset <= file.size() && size <= file.size() - offset;
+	};
+	for (unsigned int level = 0; level < header.lodCount; level++)
+	{
+		const MeshFileLod& lod = getLod(level);
+		if (!inside(lod.vertexOffset, (uint64_t)lod.vertexCount * header.vertexStride)
+			|| !inside(lod.indexOffset, (uint64_t)lod.indexCount * sizeof(unsigned int))
+			|| !inside(lod.meshletOffset, (uint64_t)lod.meshletCount * sizeof(Meshlet)))
+		{
+			std::cout << "ERROR::MESH_FILE::TRUNCATED: " << path << " level " << level << std::endl;
+			return false;
+		}
+
+		// Drawing out of range indices reads past the mesh in the shared pool buffers
+		const unsigned int* indices = getIndices(level);
+		for (uint32_t i = 0; i < lod.indexCount; i++)
+		{
+			if (indices[i] >= lod.vertexCount)
+			{
+				std::cout << "ERROR::MESH_FILE::INDEX_OUT_OF_RANGE: " << path << " level " << level << std::endl;
+				return false;
+			}
+		}
+
+		// ClusterCuller draws the meshlets' ranges instead of the level's, so they have to be whole
+		// triangles and tile the indices front to back the way MeshletBuilder writes them
+		uint64_t nextIndex = 0;
+		for (uint32_t i = 0; i < lod.meshletCount; i++)
+		{
+			Meshlet meshlet;
+			std::memcpy(&meshlet, file.data() + lod.meshletOffset + i * sizeof(Meshlet), sizeof(Meshlet));
+			if (meshlet.indexCount % 3 != 0 || meshlet.firstIndex != nextIndex
+				|| (uint64_t)meshlet.firstIndex + meshlet.indexCount > lod.indexCount)
+			{
+				std::cout << "ERROR::MESH_FILE::BAD_MESHLET: " << path << " level " << level << " meshlet " << i << std::endl;
+				return false;
+			}
+			nextIndex += meshlet.indexCount;
+		}
+		if (nextIndex != lod.indexCount)
+		{
+			std::cout << "ERROR::MESH_FILE::BAD_MESHLET: " << path << " level " << level << " meshlets don't cover the indices" << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+MeshBounds MeshFile::getBounds() const
+{
+	const MeshFileHeader& header = getHeader();
+	MeshBounds bounds;
+	std::memcpy(&bounds.min, header.boundsMin, sizeof(header.boundsMin));
+	std::memcpy(&bounds.max, header.boundsMax, sizeof(header.boundsMax));
+	std::memcpy(&bounds.center, header.boundingCenter, sizeof(header.boundingCenter));
+	bounds.radius = header.boundingRadius;
+	return bounds;
+}
+
+std::vector<Meshlet> MeshFile::getMeshlets(unsigned int level) const
+{
+	const MeshFileLod& lod = getLod(level);
+	std::vector<Meshlet> meshlets(lod.meshletCount);
+	std::memcpy(meshlets.data(), file.data() + lod.meshletOffset, lod.meshletCount * sizeof(Meshlet));
+	return meshlets;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "mesh_data.h"
+#include "meshlet_builder.h"
+#include "vertex_format.h"
+
+// One level of a mesh in the form the GPU draws it: reordered by MeshOptimizer, encoded to a
+// vertex format and split into meshlets. What Model uploads, and what mesh files store.
+struct CookedLod
+{
+	std::vector<unsigned char> vertices;
+	size_t vertexCount = 0;
+	std::vector<unsigned int> indices;
+	std::vector<Meshlet> meshlets;
+	float error = 0.0f;
+};
+
+// Binary mesh file layout, little endian:
+//   MeshFileHeader
+//   MeshFileLod[lodCount]
+//   per level: vertices, indices and meshlets, each starting on a MeshFile::ALIGNMENT boundary
+// Every offset is from the start of the file.
+struct MeshFileHeader
+{
+	char magic[4];
+	uint32_t version;
+	// Vertex layout. The stride and meshlet size catch files written by a build where they differ.
+	uint32_t vertexFormat;
+	uint32_t vertexStride;
+	uint32_t meshletSize;
+	uint32_t lodCount;
+	// MeshBounds of the full detail level, quantized vertices are relative to min and max
+	float boundsMin[3];
+	float boundsMax[3];
+	float boundingCenter[3];
+	float boundingRadius;
+};
+static_assert(sizeof(MeshFileHeader) == 64, "MeshFileHeader is part of the file format");
+
+struct MeshFileLod
+{
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	uint64_t meshletOffset;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t meshletCount;
+	// ModelLod::error
+	float error;
+};
+static_assert(sizeof(MeshFileLod) == 40, "MeshFileLod is part of the file format");
+
+// Meshes stored exactly as the GPU reads them. Opening one maps the file and checks the header,
+// after which the vertices and indices are pointers into the mapping that go straight to
+// glBufferSubData: no parsing, no decoding, no copy in between. Written by the convert_mesh tool.
+class MeshFile
+{
+public:
+	static constexpr char MAGIC[4] = { 'M', 'E', 'S', 'H' };
+	// Bump whenever the layout above, a vertex format or Meshlet changes
+	static const uint32_t VERSION = 1;
+	static const size_t ALIGNMENT = 16;
+
+	// Optimizes a copy of mesh and encodes it. boundsMin/boundsMax are the full detail level's.
+	static CookedLod cook(MeshData mesh, VertexFormat format, const glm::vec3& boundsMin, const glm::vec3& boundsMax, float error);
+	// lods[0] is the full detail level, bounds computed from it before cooking
+	static bool write(const std::string& path, VertexFormat format, const MeshBounds& bounds, const std::vector<CookedLod>& lods);
+
+	// Returns false, and stays closed, unless the file is a mesh file this build can draw
+	// with every section inside it
+	bool open(const std::string& path);
+	void close() { file.close(); }
+	bool isOpen() const { return file.isOpen(); }
+	// The whole file, for size reports
+	size_t size() const { return file.size(); }
+
+	const MeshFileHeader& getHeader() const { return *(const MeshFileHeader*)file.data(); }
+	VertexFormat getVertexFormat() const { return (VertexFormat)getHeader().vertexFormat; }
+	MeshBounds getBounds() const;
+	unsigned int lodCount() const { return getHeader().lodCount; }
+	const MeshFileLod& getLod(unsigned int level) const { return ((const MeshFileLod*)(file.data() + sizeof(MeshFileHeader)))[level]; }
+
+	// Point into the mapping, valid until the file is closed
+	const void* getVertices(unsigned int level) const { return file.data() + getLod(level).vertexOffset; }
+	const unsigned int* getIndices(unsigned int level) const { return (const unsigned int*)(file.data() + getLod(level).indexOffset); }
+	// Copied out, ModelLod keeps its own
+	std::vector<Meshlet> getMeshlets(unsigned int level) const;
+
+private:
+	bool validate(const std::string& path) const;
+
+	MappedFile file;
+};
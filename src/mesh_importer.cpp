@@ -0,0 +1,28 @@
+#include "mesh_importer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+
+#include "gltf_file.h"
+#include "mesh_optimizer.h"
+#include "obj_file.h"
+
+bool importMesh(const std::string& path, MeshData& mesh, ThreadPool* threadPool)
+{
+	std::string extension = std::filesystem::path(path).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+
+	bool loaded = false;
+	if (extension == ".obj")
+		loaded = loadObj(path, mesh, threadPool);
+	else if (extension == ".gltf" || extension == ".glb")
+		loaded = loadGltf(path, mesh, threadPool);
+	else
+		std::cout << "ERROR::MESH_IMPORTER::UNKNOWN_FORMAT " << path << std::endl;
+
+	if (loaded)
+		MeshOptimizer::weldVertices(mesh);
+	return loaded;
+}
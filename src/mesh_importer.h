@@ -0,0 +1,10 @@
+#pragma once
+#include <string>
+
+#include "mesh_data.h"
+
+class ThreadPool;
+
+// Loads a mesh file by its extension (.obj, .gltf or .glb) and welds duplicate vertices, ready
+// for Model or MeshFile::cook. Given a thread pool, the loaders parse in parallel.
+bool importMesh(const std::string& path, MeshData& mesh, ThreadPool* threadPool = nullptr);
@@ -0,0 +1,448 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include <glm/glm.hpp>
+
+// Forsyth's scoring. Vertices used by the last triangle get a fixed score so the next triangle
+// doesn't just reuse the same edge over and over, the rest decay with their cache position.
+// Vertices with few triangles left get a boost so they're finished off and leave no stragglers.
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+
+static float vertexScore(int cachePosition, unsigned int remainingTriangles)
+{
+	if (remainingTriangles == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		if (cachePosition < 3)
+			score = LAST_TRIANGLE_SCORE;
+		else
+			score = std::pow(1.0f - (float)(cachePosition - 3) / (MeshOptimizer::CACHE_SIZE - 3), CACHE_DECAY_POWER);
+	}
+	return score + VALENCE_BOOST_SCALE * std::pow((float)remainingTriangles, -VALENCE_BOOST_POWER);
+}
+
+void MeshOptimizer::optimize(MeshData& mesh)
+{
+	optimizeVertexCache(mesh.indices, mesh.vertexCount());
+	optimizeOverdraw(mesh.indices, mesh.positions);
+	optimizeVertexFetch(mesh);
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Triangles using each vertex, as one array with offsets
+	std::vector<unsigned int> remaining(vertexCount, 0);
+	for (unsigned int index : indices)
+		remaining[index]++;
+	std::vector<unsigned int> offsets(vertexCount + 1, 0);
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+		offsets[vertex + 1] = offsets[vertex] + remaining[vertex];
+	std::vector<unsigned int> adjacency(indices.size());
+	std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		for (int corner = 0; corner < 3; corner++)
+			adjacency[fill[indices[triangle * 3 + corner]]++] = (unsigned int)triangle;
+	}
+
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+		vertexScores[vertex] = vertexScore(-1, remaining[vertex]);
+	std::vector<float> triangleScores(triangleCount);
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		triangleScores[triangle] = vertexScores[indices[triangle * 3]] + vertexScores[indices[triangle * 3 + 1]] + vertexScores[indices[triangle * 3 + 2]];
+	}
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<int> cachePositions(vertexCount, -1);
+
+	// One extra slot for each vertex of the incoming triangle, those fall off the end
+	std::vector<unsigned int> cache;
+	std::vector<unsigned int> newCache;
+	cache.reserve(CACHE_SIZE + 3);
+	newCache.reserve(CACHE_SIZE + 3);
+
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+	size_t scanCursor = 0;
+	int64_t best = -1;
+
+	while (result.size() < indices.size())
+	{
+		// Nothing left around the cache, take the next triangle in input order
+		if (best < 0)
+		{
+			while (emitted[scanCursor])
+				scanCursor++;
+			best = (int64_t)scanCursor;
+		}
+
+		unsigned int triangle = (unsigned int)best;
+		emitted[triangle] = true;
+		const unsigned int* corners = &indices[triangle * 3];
+		result.insert(result.end(), corners, corners + 3);
+
+		// The triangle's vertices move to the front, everything else shifts back
+		newCache.assign(corners, corners + 3);
+		for (unsigned int vertex : cache)
+		{
+			if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2])
+				newCache.push_back(vertex);
+		}
+		for (int corner = 0; corner < 3; corner++)
+		{
+			unsigned int vertex = corners[corner];
+			remaining[vertex]--;
+			// Take the emitted triangle out of the vertex's list, keeping the live ones at the front
+			unsigned int* list = &adjacency[offsets[vertex]];
+			unsigned int* end = list + remaining[vertex] + 1;
+			*std::find(list, end, triangle) = *(end - 1);
+		}
+
+		for (size_t i = 0; i < newCache.size(); i++)
+			cachePositions[newCache[i]] = i < CACHE_SIZE ? (int)i : -1;
+
+		// Rescore everything that was or is in the cache, and pick the best triangle touching it
+		best = -1;
+		float bestScore = -1.0f;
+		for (unsigned int vertex : newCache)
+		{
+			float score = vertexScore(cachePositions[vertex], remaining[vertex]);
+			float delta = score - vertexScores[vertex];
+			vertexScores[vertex] = score;
+			for (unsigned int i = 0; i < remaining[vertex]; i++)
+			{
+				unsigned int neighbour = adjacency[offsets[vertex] + i];
+				triangleScores[neighbour] += delta;
+			}
+		}
+		for (unsigned int vertex : newCache)
+		{
+			if (cachePositions[vertex] < 0)
+				continue;
+			for (unsigned int i = 0; i < remaining[vertex]; i++)
+			{
+				unsigned int neighbour = adjacency[offsets[vertex] + i];
+				if (triangleScores[neighbour] > bestScore)
+				{
+					bestScore = triangleScores[neighbour];
+					best = neighbour;
+				}
+			}
+		}
+
+		if (newCache.size() > CACHE_SIZE)
+			newCache.resize(CACHE_SIZE);
+		std::swap(cache, newCache);
+	}
+
+	indices.swap(result);
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<float>& positions, float threshold)
+{
+	size_t triangleCount = indices.size() / 3;
+	size_t vertexCount = positions.size() / 3;
+	if (triangleCount < 2)
+		return;
+
+	// Split the order into clusters. Hard boundaries are where the cache starts over anyway
+	// (all three vertices miss), cutting there costs nothing. Within those, a soft boundary goes
+	// wherever the cluster so far is already within threshold of the whole run's efficiency.
+	std::vector<unsigned int> clusterStarts;
+	{
+		std::vector<unsigned int> cacheTime(vertexCount, 0);
+		unsigned int time = CACHE_SIZE + 1;
+		auto misses = [&](size_t triangle)
+		{
+			unsigned int count = 0;
+			for (int corner = 0; corner < 3; corner++)
+			{
+				unsigned int vertex = indices[triangle * 3 + corner];
+				if (time - cacheTime[vertex] > CACHE_SIZE)
+				{
+					cacheTime[vertex] = time++;
+					count++;
+				}
+			}
+			return count;
+		};
+
+		std::vector<unsigned int> hardStarts;
+		for (size_t triangle = 0; triangle < triangleCount; triangle++)
+		{
+			if (misses(triangle) == 3)
+				hardStarts.push_back((unsigned int)triangle);
+		}
+		hardStarts.push_back((unsigned int)triangleCount);
+
+		for (size_t hard = 0; hard + 1 < hardStarts.size(); hard++)
+		{
+			unsigned int start = hardStarts[hard];
+			unsigned int end = hardStarts[hard + 1];
+
+			// The run's efficiency with a cold cache, then cut it up while staying close to it
+			time += CACHE_SIZE + 1;
+			unsigned int runMisses = 0;
+			for (unsigned int triangle = start; triangle < end; triangle++)
+				runMisses += misses(triangle);
+			float runAcmr = (float)runMisses / (end - start);
+
+			time += CACHE_SIZE + 1;
+			unsigned int clusterStart = start;
+			unsigned int clusterMisses = 0;
+			clusterStarts.push_back(start);
+			for (unsigned int triangle = start; triangle < end; triangle++)
+			{
+				clusterMisses += misses(triangle);
+				if (triangle + 1 < end && (float)clusterMisses / (triangle + 1 - clusterStart) <= runAcmr * threshold)
+				{
+					clusterStart = triangle + 1;
+					clusterMisses = 0;
+					clusterStarts.push_back(clusterStart);
+					time += CACHE_SIZE + 1;
+				}
+			}
+		}
+	}
+	clusterStarts.push_back((unsigned int)triangleCount);
+	size_t clusterCount = clusterStarts.size() - 1;
+
+	auto position = [&](unsigned int vertex) { return glm::vec3(positions[vertex * 3], positions[vertex * 3 + 1], positions[vertex * 3 + 2]); };
+
+	// Area weighted centroid of the whole mesh
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+	std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.0f));
+	std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+	for (size_t cluster = 0; cluster < clusterCount; cluster++)
+	{
+		float clusterArea = 0.0f;
+		for (unsigned int triangle = clusterStarts[cluster]; triangle < clusterStarts[cluster + 1]; triangle++)
+		{
+			glm::vec3 a = position(indices[triangle * 3]);
+			glm::vec3 b = position(indices[triangle * 3 + 1]);
+			glm::vec3 c = position(indices[triangle * 3 + 2]);
+			// Twice the area, pointing along the normal
+			glm::vec3 normal = glm::cross(b - a, c - a);
+			float area = glm::length(normal);
+			clusterCentroids[cluster] += (a + b + c) * (area / 3.0f);
+			clusterNormals[cluster] += normal;
+			clusterArea += area;
+		}
+		meshCentroid += clusterCentroids[cluster];
+		meshArea += clusterArea;
+		if (clusterArea > 0.0f)
+			clusterCentroids[cluster] /= clusterArea;
+	}
+	if (meshArea > 0.0f)
+		meshCentroid /= meshArea;
+
+	// Clusters far out along their own normal are likely to be in front of the rest from any
+	// direction they're visible from, so they go first
+	std::vector<float> sortKeys(clusterCount);
+	for (size_t cluster = 0; cluster < clusterCount; cluster++)
+	{
+		float normalLength = glm::length(clusterNormals[cluster]);
+		glm::vec3 normal = normalLength > 0.0f ? clusterNormals[cluster] / normalLength : glm::vec3(0.0f);
+		sortKeys[cluster] = glm::dot(clusterCentroids[cluster] - meshCentroid, normal);
+	}
+	std::vector<unsigned int> order(clusterCount);
+	for (size_t cluster = 0; cluster < clusterCount; cluster++)
+		order[cluster] = (unsigned int)cluster;
+	std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+	for (unsigned int cluster : order)
+		result.insert(result.end(), indices.begin() + clusterStarts[cluster] * 3, indices.begin() + clusterStarts[cluster + 1] * 3);
+	indices.swap(result);
+}
+
+void MeshOptimizer::optimizeVertexFetch(MeshData& mesh)
+{
+	const unsigned int UNUSED = 0xFFFFFFFF;
+	size_t vertexCount = mesh.vertexCount();
+	bool hasUvs = mesh.uvs.size() >= vertexCount * 2;
+
+	std::vector<unsigned int> remap(vertexCount, UNUSED);
+	std::vector<float> positions;
+	std::vector<float> uvs;
+	positions.reserve(mesh.positions.size());
+	uvs.reserve(mesh.uvs.size());
+	unsigned int next = 0;
+	for (unsigned int& index : mesh.indices)
+	{
+		if (remap[index] == UNUSED)
+		{
+			remap[index] = next++;
+			positions.insert(positions.end(), &mesh.positions[index * 3], &mesh.positions[index * 3] + 3);
+			if (hasUvs)
+				uvs.insert(uvs.end(), &mesh.uvs[index * 2], &mesh.uvs[index * 2] + 2);
+		}
+		index = remap[index];
+	}
+	mesh.positions.swap(positions);
+	if (hasUvs)
+		mesh.uvs.swap(uvs);
+}
+
+// Bit patterns of a vertex's position and uv, with -0 turned into 0 so the two compare equal
+struct WeldKey
+{
+	uint32_t bits[5];
+
+	bool operator==(const WeldKey& other) const { return std::memcmp(bits, other.bits, sizeof(bits)) == 0; }
+};
+
+static WeldKey makeWeldKey(const MeshData& mesh, size_t vertex)
+{
+	WeldKey key;
+	float values[5] = { mesh.positions[vertex * 3], mesh.positions[vertex * 3 + 1], mesh.positions[vertex * 3 + 2], 0.0f, 0.0f };
+	if (vertex * 2 + 1 < mesh.uvs.size())
+	{
+		values[3] = mesh.uvs[vertex * 2];
+		values[4] = mesh.uvs[vertex * 2 + 1];
+	}
+	for (int i = 0; i < 5; i++)
+	{
+		float value = values[i] == 0.0f ? 0.0f : values[i];
+		std::memcpy(&key.bits[i], &value, sizeof(float));
+	}
+	return key;
+}
+
+static uint64_t hashWeldKey(const WeldKey& key)
+{
+	// FNV-1a over the words, then Fibonacci hashing spreads it over the table
+	uint64_t hash = 14695981039346656037ull;
+	for (uint32_t word : key.bits)
+		hash = (hash ^ word) * 1099511628211ull;
+	return hash * 0x9E3779B97F4A7C15ull;
+}
+
+size_t MeshOptimizer::weldVertices(MeshData& mesh)
+{
+	const unsigned int EMPTY = 0xFFFFFFFF;
+	size_t vertexCount = mesh.vertexCount();
+	bool hasUvs = mesh.uvs.size() >= vertexCount * 2;
+
+	// Open addressing, at most half full, slots hold the vertex that first had the key
+	size_t capacity = 16;
+	while (capacity < vertexCount * 2)
+		capacity *= 2;
+	std::vector<unsigned int> table(capacity, EMPTY);
+	std::vector<WeldKey> keys(vertexCount);
+
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<float> positions;
+	std::vector<float> uvs;
+	positions.reserve(mesh.positions.size());
+	uvs.reserve(mesh.uvs.size());
+	unsigned int next = 0;
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		WeldKey key = makeWeldKey(mesh, vertex);
+		size_t slot = (size_t)(hashWeldKey(key) >> 32) & (capacity - 1);
+		while (table[slot] != EMPTY && !(keys[table[slot]] == key))
+			slot = (slot + 1) & (capacity - 1);
+
+		if (table[slot] == EMPTY)
+		{
+			table[slot] = next;
+			keys[next] = key;
+			positions.insert(positions.end(), &mesh.positions[vertex * 3], &mesh.positions[vertex * 3] + 3);
+			if (hasUvs)
+				uvs.insert(uvs.end(), &mesh.uvs[vertex * 2], &mesh.uvs[vertex * 2] + 2);
+			next++;
+		}
+		remap[vertex] = table[slot];
+	}
+
+	for (unsigned int& index : mesh.indices)
+		index = remap[index];
+	mesh.positions.swap(positions);
+	if (hasUvs)
+		mesh.uvs.swap(uvs);
+	return vertexCount - next;
+}
+
+// Counts the distinct vertices the indices reference, the denominator of ATVR
+static size_t referencedVertices(const std::vector<unsigned int>& indices, size_t vertexCount)
+{
+	std::vector<bool> used(vertexCount, false);
+	size_t count = 0;
+	for (unsigned int index : indices)
+	{
+		if (!used[index])
+		{
+			used[index] = true;
+			count++;
+		}
+	}
+	return count;
+}
+
+static VertexCacheStats makeStats(unsigned int misses, const std::vector<unsigned int>& indices, size_t vertexCount)
+{
+	VertexCacheStats stats;
+	stats.misses = misses;
+	size_t triangleCount = indices.size() / 3;
+	size_t referenced = referencedVertices(indices, vertexCount);
+	stats.acmr = triangleCount ? (float)misses / triangleCount : 0.0f;
+	stats.atvr = referenced ? (float)misses / referenced : 0.0f;
+	return stats;
+}
+
+VertexCacheStats MeshOptimizer::simulateFifo(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize)
+{
+	// A vertex is still cached if fewer than cacheSize misses happened since it was inserted
+	std::vector<unsigned int> insertedAt(vertexCount, 0);
+	unsigned int misses = 0;
+	unsigned int time = cacheSize + 1;
+	for (unsigned int index : indices)
+	{
+		if (time - insertedAt[index] > cacheSize)
+		{
+			insertedAt[index] = time++;
+			misses++;
+		}
+	}
+	return makeStats(misses, indices, vertexCount);
+}
+
+VertexCacheStats MeshOptimizer::simulateLru(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize)
+{
+	// Most recently used first
+	std::vector<unsigned int> cache;
+	cache.reserve(cacheSize + 1);
+	unsigned int misses = 0;
+	for (unsigned int index : indices)
+	{
+		auto it = std::find(cache.begin(), cache.end(), index);
+		if (it == cache.end())
+		{
+			misses++;
+			cache.insert(cache.begin(), index);
+			if (cache.size() > cacheSize)
+				cache.pop_back();
+		}
+		else
+			std::rotate(cache.begin(), it, it + 1);
+	}
+	return makeStats(misses, indices, vertexCount);
+}
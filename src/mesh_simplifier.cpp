@@ -0,0 +1,347 @@
+#include "mesh_simplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+// Border edges get a plane perpendicular to their triangle, weighted so sliding a border
+// vertex off the border line costs a lot more than moving it within a flat area
+static const double BORDER_WEIGHT = 10.0;
+// Collapses that turn a triangle's normal by more than about 80 degrees are rejected
+static const float MIN_NORMAL_DOT = 0.2f;
+
+namespace
+{
+	// Symmetric 4x4 matrix summing p * p^T over planes p = (a, b, c, d)
+	struct Quadric
+	{
+		double a2 = 0, ab = 0, ac = 0, ad = 0;
+		double b2 = 0, bc = 0, bd = 0;
+		double c2 = 0, cd = 0;
+		double d2 = 0;
+		// Total weight of the planes, to turn the sum back into an average
+		double weight = 0;
+
+		void addPlane(const glm::dvec3& normal, double distance, double weight)
+		{
+			a2 += weight * normal.x * normal.x; ab += weight * normal.x * normal.y; ac += weight * normal.x * normal.z; ad += weight * normal.x * distance;
+			b2 += weight * normal.y * normal.y; bc += weight * normal.y * normal.z; bd += weight * normal.y * distance;
+			c2 += weight * normal.z * normal.z; cd += weight * normal.z * distance;
+			d2 += weight * distance * distance;
+			this->weight += weight;
+		}
+
+		void add(const Quadric& other)
+		{
+			a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+			b2 += other.b2; bc += other.bc; bd += other.bd;
+			c2 += other.c2; cd += other.cd;
+			d2 += other.d2;
+			weight += other.weight;
+		}
+
+		// Sum of squared distances from the point to every plane
+		double evaluate(const glm::dvec3& p) const
+		{
+			return a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x
+				+ b2 * p.y * p.y + 2 * bc * p.y * p.z + 2 * bd * p.y
+				+ c2 * p.z * p.z + 2 * cd * p.z
+				+ d2;
+		}
+	};
+
+	enum VertexKind : uint8_t
+	{
+		VERTEX_INTERIOR,
+		// On an open border, may only collapse along it
+		VERTEX_BORDER,
+		// On a UV seam or a non-manifold edge, never moves
+		VERTEX_LOCKED
+	};
+
+	struct Collapse
+	{
+		double cost;
+		// Mean squared distance to the merged planes, what gets reported as the error
+		double error;
+		unsigned int from;
+		unsigned int to;
+	};
+
+	uint64_t edgeKey(unsigned int a, unsigned int b)
+	{
+		return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+	}
+
+	glm::vec3 vertexPosition(const MeshData& mesh, unsigned int vertex)
+	{
+		return glm::vec3(mesh.positions[vertex * 3], mesh.positions[vertex * 3 + 1], mesh.positions[vertex * 3 + 2]);
+	}
+
+	struct PositionHash
+	{
+		size_t operator()(const glm::vec3& p) const
+		{
+			uint32_t bits[3];
+			std::memcpy(bits, &p, sizeof(bits));
+			return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+		}
+	};
+}
+
+// Would moving every triangle around from onto to flip or squash any of them?
+static bool collapseFlips(const MeshData& mesh, const std::vector<unsigned int>& indices, const std::vector<unsigned int>& triangleStart,
+	const std::vector<unsigned int>& vertexTriangles, unsigned int from, unsigned int to)
+{
+	glm::vec3 target = vertexPosition(mesh, to);
+	for (unsigned int i = triangleStart[from]; i < triangleStart[from + 1]; i++)
+	{
+		const unsigned int* triangle = &indices[vertexTriangles[i] * 3];
+		// Triangles on the collapsed edge disappear
+		if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+			continue;
+
+		glm::vec3 corners[3];
+		glm::vec3 moved[3];
+		for (int corner = 0; corner < 3; corner++)
+		{
+			corners[corner] = vertexPosition(mesh, triangle[corner]);
+			moved[corner] = triangle[corner] == from ? target : corners[corner];
+		}
+		glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+		glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+		float lengths = glm::length(before) * glm::length(after);
+		if (lengths <= 0.0f || glm::dot(before, after) < MIN_NORMAL_DOT * lengths)
+			return true;
+	}
+	return false;
+}
+
+SimplifiedMesh MeshSimplifier::simplify(const MeshData& mesh, float targetRatio, float maxError)
+{
+	SimplifiedMesh result;
+	size_t vertexCount = mesh.vertexCount();
+	std::vector<unsigned int> indices = mesh.indices;
+	size_t targetTriangles = (size_t)(mesh.triangleCount() * std::max(0.0f, std::min(targetRatio, 1.0f)));
+	double maxSquaredError = maxError < FLT_MAX ? (double)maxError * maxError : DBL_MAX;
+
+	// Vertices sharing a position with another vertex sit on a UV seam
+	std::vector<VertexKind> kinds(vertexCount, VERTEX_INTERIOR);
+	{
+		std::unordered_map<glm::vec3, unsigned int, PositionHash> firstAtPosition;
+		for (unsigned int vertex = 0; vertex < vertexCount; vertex++)
+		{
+			auto inserted = firstAtPosition.emplace(vertexPosition(mesh, vertex), vertex);
+			if (!inserted.second)
+			{
+				kinds[vertex] = VERTEX_LOCKED;
+				kinds[inserted.first->second] = VERTEX_LOCKED;
+			}
+		}
+	}
+
+	// Edges used by a single triangle are borders, by more than two non-manifold
+	std::unordered_map<uint64_t, int> edgeUse;
+	for (size_t i = 0; i < indices.size(); i += 3)
+		for (int edge = 0; edge < 3; edge++)
+			edgeUse[edgeKey(indices[i + edge], indices[i + (edge + 1) % 3])]++;
+
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		glm::dvec3 corners[3] = { vertexPosition(mesh, indices[i]), vertexPosition(mesh, indices[i + 1]), vertexPosition(mesh, indices[i + 2]) };
+		glm::dvec3 normal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+		double length = glm::length(normal);
+		if (length <= 0.0)
+			continue;
+		normal /= length;
+
+		for (int corner = 0; corner < 3; corner++)
+			quadrics[indices[i + corner]].addPlane(normal, -glm::dot(normal, corners[0]), 1.0);
+
+		for (int edge = 0; edge < 3; edge++)
+		{
+			unsigned int a = indices[i + edge];
+			unsigned int b = indices[i + (edge + 1) % 3];
+			int uses = edgeUse[edgeKey(a, b)];
+			if (uses > 2)
+			{
+				kinds[a] = kinds[b] = VERTEX_LOCKED;
+			}
+			else if (uses == 1)
+			{
+				for (unsigned int vertex : { a, b })
+					if (kinds[vertex] == VERTEX_INTERIOR)
+						kinds[vertex] = VERTEX_BORDER;
+
+				glm::dvec3 along = corners[(edge + 1) % 3] - corners[edge];
+				glm::dvec3 borderNormal = glm::cross(along, normal);
+				double borderLength = glm::length(borderNormal);
+				if (borderLength > 0.0)
+				{
+					borderNormal /= borderLength;
+					double distance = -glm::dot(borderNormal, corners[edge]);
+					quadrics[a].addPlane(borderNormal, distance, BORDER_WEIGHT);
+					quadrics[b].addPlane(borderNormal, distance, BORDER_WEIGHT);
+				}
+			}
+		}
+	}
+
+	// Each pass collapses a batch of the cheapest edges that don't touch each other,
+	// then rebuilds the index buffer. Adjacency only needs to be correct at the start of a pass.
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<unsigned int> triangleStart(vertexCount + 1);
+	std::vector<unsigned int> vertexTriangles;
+	std::vector<uint8_t> touched(vertexCount);
+	std::vector<Collapse> collapses;
+	double worstError = 0.0;
+
+	while (indices.size() / 3 > targetTriangles)
+	{
+		size_t triangleCount = indices.size() / 3;
+
+		// Vertex -> triangles, as offsets into one array
+		std::fill(triangleStart.begin(), triangleStart.end(), 0);
+		for (unsigned int index : indices)
+			triangleStart[index + 1]++;
+		for (size_t vertex = 0; vertex < vertexCount; vertex++)
+			triangleStart[vertex + 1] += triangleStart[vertex];
+		vertexTriangles.resize(indices.size());
+		{
+			std::vector<unsigned int> fill(triangleStart.begin(), triangleStart.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++)
+				vertexTriangles[fill[indices[i]]++] = (unsigned int)(i / 3);
+		}
+
+		collapses.clear();
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			for (int edge = 0; edge < 3; edge++)
+			{
+				unsigned int a = indices[i + edge];
+				unsigned int b = indices[i + (edge + 1) % 3];
+				bool border = edgeUse[edgeKey(a, b)] == 1;
+
+				// Try both directions, keep the cheaper one that's allowed
+				Collapse best = { DBL_MAX, 0.0, 0, 0 };
+				for (int direction = 0; direction < 2; direction++)
+				{
+					unsigned int from = direction ? b : a;
+					unsigned int to = direction ? a : b;
+					if (kinds[from] == VERTEX_LOCKED || (kinds[from] == VERTEX_BORDER && !border))
+						continue;
+
+					Quadric merged = quadrics[from];
+					merged.add(quadrics[to]);
+					double cost = std::max(0.0, merged.evaluate(glm::dvec3(vertexPosition(mesh, to))));
+					if (cost < best.cost)
+						best = { cost, merged.weight > 0.0 ? cost / merged.weight : 0.0, from, to };
+				}
+				if (best.cost < DBL_MAX)
+					collapses.push_back(best);
+			}
+		}
+		if (collapses.empty())
+			break;
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+		for (unsigned int vertex = 0; vertex < vertexCount; vertex++)
+			remap[vertex] = vertex;
+		std::fill(touched.begin(), touched.end(), 0);
+
+		size_t removed = 0;
+		size_t collapsed = 0;
+		for (const Collapse& collapse : collapses)
+		{
+			if (triangleCount - removed <= targetTriangles)
+				break;
+			if (collapse.error > maxSquaredError)
+				continue;
+			if (touched[collapse.from] || touched[collapse.to])
+				continue;
+			if (collapseFlips(mesh, indices, triangleStart, vertexTriangles, collapse.from, collapse.to))
+				continue;
+
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to].add(quadrics[collapse.from]);
+			worstError = std::max(worstError, collapse.error);
+			collapsed++;
+
+			// Everything around the moved vertex is off limits until the next pass
+			for (unsigned int i = triangleStart[collapse.from]; i < triangleStart[collapse.from + 1]; i++)
+			{
+				const unsigned int* triangle = &indices[vertexTriangles[i] * 3];
+				if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+					removed++;
+				touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = 1;
+			}
+		}
+		if (collapsed == 0)
+			break;
+
+		// Apply the collapses and drop the triangles that became degenerate
+		size_t written = 0;
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			unsigned int a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+			if (a == b || b == c || c == a)
+				continue;
+			indices[written++] = a;
+			indices[written++] = b;
+			indices[written++] = c;
+		}
+		indices.resize(written);
+
+		// Merged edges keep their border status, rebuilding the counts picks that up
+		edgeUse.clear();
+		for (size_t i = 0; i < indices.size(); i += 3)
+			for (int edge = 0; edge < 3; edge++)
+				edgeUse[edgeKey(indices[i + edge], indices[i + (edge + 1) % 3])]++;
+	}
+
+	// Keep only the vertices still in use, in order of first use
+	std::vector<unsigned int> compacted(vertexCount, UINT32_MAX);
+	for (unsigned int& index : indices)
+	{
+		if (compacted[index] == UINT32_MAX)
+		{
+			compacted[index] = (unsigned int)result.mesh.vertexCount();
+			result.mesh.positions.insert(result.mesh.positions.end(), &mesh.positions[index * 3], &mesh.positions[index * 3] + 3);
+			if (!mesh.uvs.empty())
+				result.mesh.uvs.insert(result.mesh.uvs.end(), &mesh.uvs[index * 2], &mesh.uvs[index * 2] + 2);
+		}
+		index = compacted[index];
+	}
+	result.mesh.indices = std::move(indices);
+	result.error = (float)std::sqrt(worstError);
+	return result;
+}
+
+std::vector<SimplifiedMesh> MeshSimplifier::buildLodChain(const MeshData& mesh, const std::vector<float>& ratios)
+{
+	std::vector<SimplifiedMesh> chain;
+	for (float ratio : ratios)
+	{
+		chain.push_back(simplify(mesh, ratio));
+		if (chain.size() > 1)
+			chain.back().error = std::max(chain.back().error, chain[chain.size() - 2].error);
+	}
+	return chain;
+}
+
+std::vector<std::vector<SimplifiedMesh>> MeshSimplifier::buildLodChains(const std::vector<MeshData>& meshes, const std::vector<float>& ratios, ThreadPool& threadPool)
+{
+	std::vector<std::vector<SimplifiedMesh>> chains(meshes.size());
+	threadPool.parallelFor(meshes.size(), 1, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				chains[i] = buildLodChain(meshes[i], ratios);
+		});
+	return chains;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cfloat>
+#include <vector>
+
+#include "mesh_data.h"
+#include "thread_pool.h"
+
+struct SimplifiedMesh
+{
+	MeshData mesh;
+	// Estimated distance from the original surface, in the mesh's units: the RMS distance to the
+	// original planes around the worst collapse. Fits ModelLod::error.
+	float error = 0.0f;
+};
+
+// Quadric error metric simplification (Garland & Heckbert) with half edge collapses:
+// a vertex is merged into one of its neighbours, so no new vertices or texture coordinates
+// are ever made up.
+// UV seams show up as vertices sharing a position; those are never moved, so both sides of
+// a seam stay stitched together. Open borders may only slide along themselves.
+class MeshSimplifier
+{
+public:
+	// Collapses edges until the triangle count is at most targetRatio of the input, or the next
+	// collapse would exceed maxError. The result only holds the vertices still referenced.
+	static SimplifiedMesh simplify(const MeshData& mesh, float targetRatio, float maxError = FLT_MAX);
+
+	// One level per ratio, in decreasing order (e.g. 0.5, 0.25, 0.125). Every level is simplified
+	// from the input so its error is measured against it, and errors never decrease along the
+	// chain as Model::addLod expects.
+	static std::vector<SimplifiedMesh> buildLodChain(const MeshData& mesh, const std::vector<float>& ratios);
+
+	// buildLodChain for many meshes at once, one mesh per job
+	static std::vector<std::vector<SimplifiedMesh>> buildLodChains(const std::vector<MeshData>& meshes, const std::vector<float>& ratios, ThreadPool& threadPool);
+};
@@ -0,0 +1,111 @@
+#include "meshlet_builder.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Fills in the bounds of the meshlet's triangles
+static void computeBounds(Meshlet& meshlet, const MeshData& mesh)
+{
+	auto position = [&](unsigned int vertex) { return glm::vec3(mesh.positions[vertex * 3], mesh.positions[vertex * 3 + 1], mesh.positions[vertex * 3 + 2]); };
+	const unsigned int* indices = &mesh.indices[meshlet.firstIndex];
+
+	// Same as Model's sphere, centered on the box. Not minimal but close.
+	glm::vec3 boundsMin = position(indices[0]);
+	glm::vec3 boundsMax = boundsMin;
+	for (unsigned int i = 1; i < meshlet.indexCount; i++)
+	{
+		boundsMin = glm::min(boundsMin, position(indices[i]));
+		boundsMax = glm::max(boundsMax, position(indices[i]));
+	}
+	meshlet.center = (boundsMin + boundsMax) * 0.5f;
+	float radiusSquared = 0.0f;
+	for (unsigned int i = 0; i < meshlet.indexCount; i++)
+	{
+		glm::vec3 offset = position(indices[i]) - meshlet.center;
+		radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+	}
+	meshlet.radius = std::sqrt(radiusSquared);
+
+	// The cone axis is the average normal, the cone just wide enough for the furthest normal off it
+	std::vector<glm::vec3> normals;
+	normals.reserve(meshlet.indexCount / 3);
+	glm::vec3 axis(0.0f);
+	for (unsigned int i = 0; i + 2 < meshlet.indexCount; i += 3)
+	{
+		glm::vec3 a = position(indices[i]);
+		glm::vec3 normal = glm::cross(position(indices[i + 1]) - a, position(indices[i + 2]) - a);
+		float length = glm::length(normal);
+		// Degenerate triangles don't face anywhere
+		if (length <= 0.0f)
+			continue;
+		normals.push_back(normal / length);
+		axis += normals.back();
+	}
+
+	meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+	meshlet.coneCutoff = 1.0f;
+	float axisLength = glm::length(axis);
+	if (normals.empty() || axisLength <= 0.0f)
+		return;
+	axis /= axisLength;
+
+	float minimumDot = 1.0f;
+	for (const glm::vec3& normal : normals)
+		minimumDot = std::min(minimumDot, glm::dot(axis, normal));
+	meshlet.coneAxis = axis;
+	// A cone wider than a hemisphere always has a triangle facing the eye
+	if (minimumDot <= 0.0f)
+		return;
+	meshlet.coneCutoff = std::sqrt(1.0f - minimumDot * minimumDot);
+}
+
+std::vector<Meshlet> MeshletBuilder::build(const MeshData& mesh, unsigned int maxVertices, unsigned int maxTriangles)
+{
+	std::vector<Meshlet> meshlets;
+	size_t triangleCount = mesh.triangleCount();
+	if (triangleCount == 0)
+		return meshlets;
+
+	// Which meshlet last used each vertex, so counting distinct vertices needs no clearing
+	std::vector<unsigned int> lastMeshlet(mesh.vertexCount(), 0xFFFFFFFF);
+	Meshlet current = {};
+	unsigned int currentIndex = 0;
+
+	// Vertices of the triangle the current meshlet doesn't have yet
+	auto countNewVertices = [&](const unsigned int* corners)
+	{
+		unsigned int count = 0;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			bool repeated = (corner > 0 && corners[corner] == corners[0]) || (corner > 1 && corners[corner] == corners[1]);
+			if (lastMeshlet[corners[corner]] != currentIndex && !repeated)
+				count++;
+		}
+		return count;
+	};
+
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		const unsigned int* corners = &mesh.indices[triangle * 3];
+		unsigned int newVertices = countNewVertices(corners);
+
+		if (current.indexCount > 0 && (current.vertexCount + newVertices > maxVertices || current.indexCount / 3 + 1 > maxTriangles))
+		{
+			computeBounds(current, mesh);
+			meshlets.push_back(current);
+			currentIndex++;
+			current = {};
+			current.firstIndex = (unsigned int)(triangle * 3);
+			newVertices = countNewVertices(corners);
+		}
+
+		for (int corner = 0; corner < 3; corner++)
+			lastMeshlet[corners[corner]] = currentIndex;
+		current.vertexCount += newVertices;
+		current.indexCount += 3;
+	}
+
+	computeBounds(current, mesh);
+	meshlets.push_back(current);
+	return meshlets;
+}
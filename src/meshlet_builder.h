@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "mesh_data.h"
+
+// A small cluster of a mesh's triangles, contiguous in its index buffer, with the bounds
+// needed to cull it on its own
+struct Meshlet
+{
+	// Relative to the start of the mesh's indices
+	unsigned int firstIndex;
+	unsigned int indexCount;
+	// Distinct vertices the triangles use
+	unsigned int vertexCount;
+
+	// Bounding sphere in model space
+	glm::vec3 center;
+	float radius;
+
+	// Every triangle's normal lies within the cone around coneAxis, see MeshletBuilder::isBackFacing.
+	// coneCutoff is the sine of the cone's half angle, or 1 when the normals spread too far to cull anything.
+	glm::vec3 coneAxis;
+	float coneCutoff;
+};
+
+// Splits a mesh into meshlets by walking its triangles in index order and starting a new meshlet
+// whenever the next triangle would exceed the vertex or triangle limit. No triangles are moved, so
+// run it on an order with good locality, like MeshOptimizer's: neighbouring triangles then end up
+// together and the meshlets come out compact.
+class MeshletBuilder
+{
+public:
+	// The sizes mesh shader hardware prefers, small enough to cull tightly
+	static const unsigned int MAX_VERTICES = 64;
+	static const unsigned int MAX_TRIANGLES = 124;
+
+	static std::vector<Meshlet> build(const MeshData& mesh, unsigned int maxVertices = MAX_VERTICES, unsigned int maxTriangles = MAX_TRIANGLES);
+
+	// True when no triangle of the meshlet can face an eye at this position (in the same space).
+	// Uses the bounding sphere rather than the exact apex, so it's conservative.
+	static bool isBackFacing(const Meshlet& meshlet, const glm::vec3& eye)
+	{
+		glm::vec3 toCenter = meshlet.center - eye;
+		return glm::dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius;
+	}
+};
@@ -1,47 +1,92 @@
 #include "model.h"
 
-#include <glad/glad.h>
-
-Model::Model(std::string texturePath, const std::vector<float>& vertex_positions, const std::vector<float>& vertex_texture_uvs, const std::vector<unsigned int>& vertex_indices)
-    : texture(texturePath)
-{
-    // Create VAO to store our data in
-    // VAO = vertex array objects (stores configuration of the attributes)
-    // The VAO is the top-level storage container
-    // It stores references to the other information - buffer objects of our vertex positions, textures, indices, etc.
-    // Using the VAO ID, we can pull up all the other info (which we do in our renderer).
-    glGenVertexArrays(1, &VAO_ID);
-    glBindVertexArray(VAO_ID);
-
-    // Create EBO for our indices
-    // EBO = element buffer objects 
-    // This stores indices that OpenGL uses to decide what vertices to draw and in what order (counterclockwise)
-    unsigned int EBO;
-    glGenBuffers(1, &EBO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, vertex_indices.size() * sizeof(unsigned int), vertex_indices.data(), GL_STATIC_DRAW);
-
-    // Create VBO for positions and textures
-    // VBO = vertex buffer objects 
-    // This stores the actual object vertices
-    unsigned int VBOs[2];
-    glGenBuffers(2, VBOs);
-
-    // Positions
-    glBindBuffer(GL_ARRAY_BUFFER, VBOs[0]);
-    glBufferData(GL_ARRAY_BUFFER, vertex_positions.size() * sizeof(float), vertex_positions.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, 0);
-    glEnableVertexAttribArray(0);
-
-    // Texture coords
-    glBindBuffer(GL_ARRAY_BUFFER, VBOs[1]);
-    glBufferData(GL_ARRAY_BUFFER, vertex_texture_uvs.size() * sizeof(float), vertex_texture_uvs.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 2, 0);
-    glEnableVertexAttribArray(1);
-
-    // Unbind
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    vertex_count = vertex_indices.size();
+#include <iostream>
+
+Model::Model(std::string texturePath, const std::vector<float>& vertex_positions, const std::vector<float>& vertex_texture_uvs, const std::vector<unsigned int>& vertex_indices,
+    VertexFormat vertexFormat)
+    : Model(std::make_shared<Texture>(texturePath), vertex_positions, vertex_texture_uvs, vertex_indices, vertexFormat)
+{
+}
+
+Model::Model(std::shared_ptr<Texture> pTexture, const std::vector<float>& vertex_positions, const std::vector<float>& vertex_texture_uvs, const std::vector<unsigned int>& vertex_indices,
+    VertexFormat pVertexFormat)
+    : texture(pTexture), vertexFormat(pVertexFormat), vertex_positions(vertex_positions), vertex_texture_uvs(vertex_texture_uvs), vertex_indices(vertex_indices)
+{
+    // Quantized formats store positions relative to the bounds, so they come first
+    computeBounds(vertex_positions);
+    positionDecode = positionDecodeMatrix(vertexFormat, boundsMin, boundsMax);
+
+    lods.push_back(upload(vertex_positions, vertex_texture_uvs, vertex_indices, 0.0f));
+    VAO_ID = lods[0].VAO_ID;
+    vertex_count = lods[0].vertex_count;
+}
+
+Model::Model(std::shared_ptr<Texture> pTexture, const MeshFile& file)
+    : texture(pTexture), vertexFormat(file.getVertexFormat())
+{
+    MeshBounds bounds = file.getBounds();
+    boundsMin = bounds.min;
+    boundsMax = bounds.max;
+    boundingCenter = bounds.center;
+    boundingRadius = bounds.radius;
+    positionDecode = positionDecodeMatrix(vertexFormat, boundsMin, boundsMax);
+
+    // Already optimized and encoded when the file was written
+    for (unsigned int level = 0; level < file.lodCount(); level++)
+    {
+        const MeshFileLod& lod = file.getLod(level);
+        lods.push_back(upload(file.getVertices(level), lod.vertexCount, file.getIndices(level), lod.indexCount, file.getMeshlets(level), lod.error));
+    }
+    VAO_ID = lods[0].VAO_ID;
+    vertex_count = lods[0].vertex_count;
+
+    // The CPU copies are only read by the occlusion rasterizer, close enough even when quantized
+    const MeshFileLod& full = file.getLod(0);
+    decodeVertices(vertexFormat, file.getVertices(0), full.vertexCount, boundsMin, boundsMax, vertex_positions, vertex_texture_uvs);
+    vertex_indices.assign(file.getIndices(0), file.getIndices(0) + full.indexCount);
+}
+
+Model::~Model()
+{
+    for (const ModelLod& lod : lods)
+        GeometryPool::shared().free(lod.geometry);
+}
+
+void Model::addLod(const std::vector<float>& vertex_positions, const std::vector<float>& vertex_texture_uvs, const std::vector<unsigned int>& vertex_indices, float error)
+{
+    if (error < lods.back().error)
+        std::cout << "ERROR::MODEL::LOD_ERROR_NOT_INCREASING" << std::endl;
+
+    lods.push_back(upload(vertex_positions, vertex_texture_uvs, vertex_indices, error));
+}
+
+ModelLod Model::upload(const std::vector<float>& vertex_positions, const std::vector<float>& vertex_texture_uvs, const std::vector<unsigned int>& vertex_indices, float error)
+{
+    // Reorder for the vertex cache, overdraw and fetch first. Only the GPU copy is reordered,
+    // the CPU copies keep the order they were given in.
+    CookedLod cooked = MeshFile::cook({ vertex_positions, vertex_texture_uvs, vertex_indices }, vertexFormat, boundsMin, boundsMax, error);
+    return upload(cooked.vertices.data(), cooked.vertexCount, cooked.indices.data(), cooked.indices.size(), std::move(cooked.meshlets), error);
+}
+
+ModelLod Model::upload(const void* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount, std::vector<Meshlet> meshlets, float error)
+{
+    // The vertices (positions and texture coords, interleaved) and the indices saying in which order
+    // to draw them (counterclockwise) are copied into the shared pool buffers.
+    // The pool's VAO stores how to read them, we only remember where our part is.
+    ModelLod lod;
+    lod.geometry = GeometryPool::shared().allocate(vertexFormat, vertices, vertexCount, indices, indexCount);
+    lod.VAO_ID = GeometryPool::shared().getVAO(vertexFormat);
+    lod.vertex_count = (unsigned int)indexCount;
+    lod.error = error;
+    lod.meshlets = std::move(meshlets);
+    return lod;
+}
+
+void Model::computeBounds(const std::vector<float>& vertex_positions)
+{
+    MeshBounds bounds = computeMeshBounds(vertex_positions);
+    boundsMin = bounds.min;
+    boundsMax = bounds.max;
+    boundingCenter = bounds.center;
+    boundingRadius = bounds.radius;
 }
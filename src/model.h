@@ -1,19 +1,85 @@
 #pragma once
+#include <memory>
 #include <string>
 #include <vector>
 
+#include <glm/glm.hpp>
+
+#include "geometry_pool.h"
+#include "mesh_file.h"
+#include "meshlet_builder.h"
 #include "texture.h"
 
+// One level of detail of a model, drawn with the model's texture
+struct ModelLod
+{
+	// Shared by every mesh in the pool with the same vertex format
+	unsigned int VAO_ID;
+	unsigned int vertex_count;
+	// Where the vertices and indices sit in GeometryPool::shared()
+	GeometryHandle geometry;
+	// The level's triangles split into clusters, for ClusterCuller. Index ranges are relative to the geometry's firstIndex.
+	std::vector<Meshlet> meshlets;
+	// Largest distance (in model space) between this level's surface and the full detail mesh
+	float error;
+};
+
 class Model
 {
 public:
+	// The full detail mesh, also lods[0]. The VAO is shared with other models, draw with
+	// the base vertex and first index of the mesh's GeometryRange.
 	unsigned int VAO_ID;
-	Texture texture;
+	std::shared_ptr<Texture> texture;
 	unsigned int vertex_count;
 
-	Model(std::string texturePath, const std::vector<float>& vertex_positions, const std::vector<float>& vertex_texture_uvs, const std::vector<unsigned int >& vertex_indices);
+	// Ordered from most to least detailed, error increasing
+	std::vector<ModelLod> lods;
+
+	// Bounds of the vertex positions in model space
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	glm::vec3 boundingCenter;
+	float boundingRadius;
+
+	// How every level's vertices are stored on the GPU
+	VertexFormat vertexFormat;
+	// Maps the positions the shader reads back to model space. Identity unless the format is
+	// quantized, renderers draw with the entity transform times this.
+	glm::mat4 positionDecode;
+
+	Model(std::string texturePath, const std::vector<float>& vertex_positions, const std::vector<float>& vertex_texture_uvs, const std::vector<unsigned int >& vertex_indices,
+		VertexFormat vertexFormat = VERTEX_FORMAT_POSITION_UV);
+	// Uses a texture loaded elsewhere, e.g. by TextureLoader, which may still be a placeholder
+	Model(std::shared_ptr<Texture> texture, const std::vector<float>& vertex_positions, const std::vector<float>& vertex_texture_uvs, const std::vector<unsigned int >& vertex_indices,
+		VertexFormat vertexFormat = VERTEX_FORMAT_POSITION_UV);
+	// Every level stored in an open mesh file, uploaded straight from its mapping.
+	// The file can be closed once the model is made.
+	Model(std::shared_ptr<Texture> texture, const MeshFile& file);
+	// Returns the geometry to the pool
+	~Model();
+
+	// Owns its pool ranges, so copies would free them twice
+	Model(const Model&) = delete;
+	Model& operator=(const Model&) = delete;
+
+	// Appends a coarser level. error must be larger than the previous level's.
+	// Its positions must lie within the full detail mesh's bounds.
+	void addLod(const std::vector<float>& vertex_positions, const std::vector<float>& vertex_texture_uvs, const std::vector<unsigned int>& vertex_indices, float error);
+	// Clamps to the coarsest level there is
+	const ModelLod& getLod(unsigned int level) const { return lods[level < lods.size() ? level : lods.size() - 1]; }
+
+	// CPU copies of the geometry, for things like the occlusion rasterizer that can't read the GPU buffers
+	const std::vector<float>& getPositions() const { return vertex_positions; }
+	const std::vector<float>& getTextureCoords() const { return vertex_texture_uvs; }
+	const std::vector<unsigned int>& getIndices() const { return vertex_indices; }
 
 private:
+	void computeBounds(const std::vector<float>& vertex_positions);
+	ModelLod upload(const std::vector<float>& vertex_positions, const std::vector<float>& vertex_texture_uvs, const std::vector<unsigned int>& vertex_indices, float error);
+	// Vertices already in vertexFormat
+	ModelLod upload(const void* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount, std::vector<Meshlet> meshlets, float error);
+
 	std::vector<float> vertex_positions;
 	std::vector<float> vertex_texture_uvs;
 	std::vector<unsigned int> vertex_indices;
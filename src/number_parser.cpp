@@ -0,0 +1,127 @@
+#include "number_parser.h"
+
+#include <cmath>
+
+// Every power of ten up to 1e22 is exactly representable as a double
+static const double EXACT_POWERS_OF_TEN[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+static const int MAX_EXACT_POWER = 22;
+// 19 digits always fit in 64 bits
+static const int MAX_MANTISSA_DIGITS = 19;
+
+static bool isDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+const char* parseDouble(const char* begin, const char* end, double& value)
+{
+	const char* p = begin;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = *p == '-';
+		p++;
+	}
+
+	// Digits beyond what the mantissa holds only shift the exponent
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool anyDigits = false;
+	for (; p < end && isDigit(*p); p++)
+	{
+		anyDigits = true;
+		if (digits < MAX_MANTISSA_DIGITS)
+		{
+			mantissa = mantissa * 10 + (*p - '0');
+			if (mantissa != 0)
+				digits++;
+		}
+		else
+			exponent++;
+	}
+	if (p < end && *p == '.')
+	{
+		p++;
+		for (; p < end && isDigit(*p); p++)
+		{
+			anyDigits = true;
+			if (digits < MAX_MANTISSA_DIGITS)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa != 0)
+					digits++;
+				exponent--;
+			}
+		}
+	}
+	if (!anyDigits)
+		return begin;
+
+	// An 'e' without digits after it isn't part of the number
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		const char* exponentStart = p + 1;
+		int64_t written = 0;
+		const char* exponentEnd = parseInt(exponentStart, end, written);
+		if (exponentEnd != exponentStart)
+		{
+			// Far past anything a double can hold, clamp so the sum can't overflow
+			if (written > 100000)
+				written = 100000;
+			if (written < -100000)
+				written = -100000;
+			exponent += (int)written;
+			p = exponentEnd;
+		}
+	}
+
+	double result = (double)mantissa;
+	if (mantissa == 0)
+		result = 0.0;
+	else if (mantissa < (1ull << 53) && exponent >= -MAX_EXACT_POWER && exponent <= MAX_EXACT_POWER)
+	{
+		// Both operands exact, so the one rounding is IEEE correct
+		result = exponent < 0 ? result / EXACT_POWERS_OF_TEN[-exponent] : result * EXACT_POWERS_OF_TEN[exponent];
+	}
+	else
+		result = result * std::pow(10.0, exponent);
+
+	value = negative ? -result : result;
+	return p;
+}
+
+const char* parseFloat(const char* begin, const char* end, float& value)
+{
+	double result = 0.0;
+	const char* p = parseDouble(begin, end, result);
+	if (p != begin)
+		value = (float)result;
+	return p;
+}
+
+const char* parseInt(const char* begin, const char* end, int64_t& value)
+{
+	const char* p = begin;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = *p == '-';
+		p++;
+	}
+	if (p == end || !isDigit(*p))
+		return begin;
+
+	// Saturates instead of overflowing, nothing we read has numbers that long
+	int64_t result = 0;
+	for (; p < end && isDigit(*p); p++)
+	{
+		if (result < INT64_MAX / 10 - 9)
+			result = result * 10 + (*p - '0');
+	}
+	value = negative ? -result : result;
+	return p;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+
+// Number parsing for text asset formats (OBJ, JSON). Unlike strtod and streams these ignore the
+// C locale, so "1.5" parses the same with a German locale set, and never allocate.
+// Each takes [begin, end), skips no whitespace, and returns one past the last character used,
+// or begin when there's no number there.
+
+// Decimal with optional sign, fraction and exponent. Only correctly rounded on Clinger's fast path:
+// the significant digits (19 at most are kept) make a mantissa below 2^53, about 15 digits, and the
+// decimal exponent left after them is within +-22. Anything else is the mantissa times
+// std::pow(10, exponent), which can be a few ulps off, more near and below DBL_MIN. Plenty for
+// vertex data, use strtod/from_chars where the last bit matters.
+const char* parseDouble(const char* begin, const char* end, double& value);
+const char* parseFloat(const char* begin, const char* end, float& value);
+// Optional sign and decimal digits
+const char* parseInt(const char* begin, const char* end, int64_t& value);
@@ -0,0 +1,350 @@
+#include "obj_file.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "mapped_file.h"
+#include "number_parser.h"
+#include "thread_pool.h"
+
+// A chunk of about this many bytes per job, small files aren't worth splitting
+static const size_t CHUNK_BYTES = 1 << 20;
+
+// One corner of a triangle as written in the file. Negative OBJ indices count back from the
+// vertices read so far, which a chunk only knows relative to its own start, so those are
+// stored relative and resolved once every chunk's counts are known.
+struct ObjCorner
+{
+	int position;
+	int uv;
+	unsigned char flags;
+};
+static const unsigned char CORNER_RELATIVE_POSITION = 1;
+static const unsigned char CORNER_RELATIVE_UV = 2;
+static const unsigned char CORNER_NO_UV = 4;
+
+struct ObjChunk
+{
+	const char* begin;
+	const char* end;
+	std::vector<float> positions;
+	std::vector<float> uvs;
+	// Triangulated, 3 per triangle
+	std::vector<ObjCorner> corners;
+	// The first line that couldn't be read, empty if none
+	std::string error;
+};
+
+static bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char* skipSpaces(const char* p, const char* end)
+{
+	while (p < end && isSpace(*p))
+		p++;
+	return p;
+}
+
+// Up to count floats separated by spaces, missing ones stay 0
+static const char* parseFloats(const char* p, const char* end, float* values, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		p = skipSpaces(p, end);
+		p = parseFloat(p, end, values[i]);
+	}
+	return p;
+}
+
+// OBJ indices are 1 based, negative ones count back from the end of the list so far.
+// Anything that doesn't fit an int is rejected here rather than wrapped into a valid looking
+// index. A relative one can still land before the chunk, loadObj checks it against the file.
+static bool parseCornerIndex(const char*& p, const char* end, size_t countSoFar, int& index, bool& relative)
+{
+	int64_t written = 0;
+	const char* numberEnd = parseInt(p, end, written);
+	if (numberEnd == p || written == 0 || written > INT_MAX || written < -INT_MAX || countSoFar > INT_MAX)
+		return false;
+	p = numberEnd;
+	relative = written < 0;
+	index = relative ? (int)((int64_t)countSoFar + written) : (int)(written - 1);
+	return true;
+}
+
+static void parseChunk(ObjChunk& chunk)
+{
+	std::vector<ObjCorner> polygon;
+	const char* p = chunk.begin;
+	while (p < chunk.end)
+	{
+		const char* lineEnd = (const char*)std::memchr(p, '\n', chunk.end - p);
+		if (!lineEnd)
+			lineEnd = chunk.end;
+		const char* line = skipSpaces(p, lineEnd);
+		p = lineEnd + 1;
+
+		if (lineEnd - line >= 2 && line[0] == 'v' && isSpace(line[1]))
+		{
+			float position[3] = { 0.0f, 0.0f, 0.0f };
+			parseFloats(line + 2, lineEnd, position, 3);
+			chunk.positions.insert(chunk.positions.end(), position, position + 3);
+		}
+		else if (lineEnd - line >= 3 && line[0] == 'v' && line[1] == 't' && isSpace(line[2]))
+		{
+			float uv[2] = { 0.0f, 0.0f };
+			parseFloats(line + 3, lineEnd, uv, 2);
+			chunk.uvs.insert(chunk.uvs.end(), uv, uv + 2);
+		}
+		else if (lineEnd - line >= 2 && line[0] == 'f' && isSpace(line[1]))
+		{
+			polygon.clear();
+			const char* q = skipSpaces(line + 2, lineEnd);
+			while (q < lineEnd)
+			{
+				// v, v/vt, v//vn or v/vt/vn
+				ObjCorner corner = { 0, 0, CORNER_NO_UV };
+				bool relative = false;
+				if (!parseCornerIndex(q, lineEnd, chunk.positions.size() / 3, corner.position, relative))
+					break;
+				if (relative)
+					corner.flags |= CORNER_RELATIVE_POSITION;
+				if (q < lineEnd && *q == '/')
+				{
+					q++;
+					if (q < lineEnd && *q != '/')
+					{
+						if (!parseCornerIndex(q, lineEnd, chunk.uvs.size() / 2, corner.uv, relative))
+							break;
+						corner.flags = (corner.flags & ~CORNER_NO_UV) | (relative ? CORNER_RELATIVE_UV : 0);
+					}
+					// The normal isn't used
+					if (q < lineEnd && *q == '/')
+					{
+						int64_t normal;
+						q = parseInt(q + 1, lineEnd, normal);
+					}
+				}
+				polygon.push_back(corner);
+				q = skipSpaces(q, lineEnd);
+			}
+
+			if (q < lineEnd)
+			{
+				if (chunk.error.empty())
+					chunk.error.assign(line, lineEnd);
+				continue;
+			}
+			for (size_t i = 2; i < polygon.size(); i++)
+				chunk.corners.insert(chunk.corners.end(), { polygon[0], polygon[i - 1], polygon[i] });
+		}
+	}
+}
+
+// Open addressing from position index << 32 | uv index to vertex. Much faster than
+// std::unordered_map at the tens of millions of lookups a big file needs.
+class CornerMap
+{
+public:
+	explicit CornerMap(size_t expectedCount)
+	{
+		size_t capacity = 1024;
+		while (capacity < expectedCount * 2)
+			capacity *= 2;
+		keys.assign(capacity, EMPTY);
+		values.resize(capacity);
+	}
+
+	// Returns the vertex for key, adding it as nextVertex if it's new
+	unsigned int findOrInsert(uint64_t key, unsigned int nextVertex, bool& inserted)
+	{
+		if ((count + 1) * 2 > keys.size())
+			rehash(keys.size() * 2);
+
+		size_t slot = find(key);
+		inserted = keys[slot] == EMPTY;
+		if (inserted)
+		{
+			keys[slot] = key;
+			values[slot] = nextVertex;
+			count++;
+		}
+		return values[slot];
+	}
+
+private:
+	// No corner has both indices at UINT32_MAX
+	static constexpr uint64_t EMPTY = UINT64_MAX;
+
+	std::vector<uint64_t> keys;
+	std::vector<unsigned int> values;
+	size_t count = 0;
+
+	size_t find(uint64_t key) const
+	{
+		// Fibonacci hashing spreads the sequential indices OBJ files are full of
+		size_t mask = keys.size() - 1;
+		size_t slot = (size_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+		while (keys[slot] != EMPTY && keys[slot] != key)
+			slot = (slot + 1) & mask;
+		return slot;
+	}
+
+	void rehash(size_t capacity)
+	{
+		std::vector<uint64_t> oldKeys = std::move(keys);
+		std::vector<unsigned int> oldValues = std::move(values);
+		keys.assign(capacity, EMPTY);
+		values.resize(capacity);
+		for (size_t i = 0; i < oldKeys.size(); i++)
+		{
+			if (oldKeys[i] == EMPTY)
+				continue;
+			size_t slot = find(oldKeys[i]);
+			keys[slot] = oldKeys[i];
+			values[slot] = oldValues[i];
+		}
+	}
+};
+
+bool loadObj(const std::string& path, MeshData& mesh, ThreadPool* threadPool)
+{
+	MappedFile file(path);
+	if (!file.isOpen())
+	{
+		std::cout << "ERROR::OBJ::FILE_NOT_FOUND " << path << std::endl;
+		return false;
+	}
+	mesh = MeshData();
+
+	// Cut at the first line break after every CHUNK_BYTES, so no line is split
+	std::vector<ObjChunk> chunks;
+	const char* data = file.data();
+	const char* fileEnd = data + file.size();
+	size_t chunkBytes = threadPool ? CHUNK_BYTES : file.size();
+	for (const char* begin = data; begin < fileEnd;)
+	{
+		const char* end = begin + std::min(chunkBytes, (size_t)(fileEnd - begin));
+		if (end < fileEnd)
+		{
+			const char* lineBreak = (const char*)std::memchr(end, '\n', fileEnd - end);
+			end = lineBreak ? lineBreak + 1 : fileEnd;
+		}
+		chunks.emplace_back();
+		chunks.back().begin = begin;
+		chunks.back().end = end;
+		begin = end;
+	}
+
+	if (threadPool)
+	{
+		threadPool->parallelFor(chunks.size(), 1, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				parseChunk(chunks[i]);
+		});
+	}
+	else
+	{
+		for (ObjChunk& chunk : chunks)
+			parseChunk(chunk);
+	}
+
+	// Stitch the chunks back together in file order
+	size_t positionCount = 0;
+	size_t uvCount = 0;
+	size_t cornerCount = 0;
+	std::vector<float> filePositions;
+	std::vector<float> fileUVs;
+	for (ObjChunk& chunk : chunks)
+	{
+		if (!chunk.error.empty())
+		{
+			std::cout << "ERROR::OBJ::INVALID_FACE " << path << ": " << chunk.error << std::endl;
+			return false;
+		}
+		positionCount += chunk.positions.size() / 3;
+		uvCount += chunk.uvs.size() / 2;
+		cornerCount += chunk.corners.size();
+	}
+	filePositions.reserve(positionCount * 3);
+	fileUVs.reserve(uvCount * 2);
+	mesh.indices.reserve(cornerCount);
+
+	// Every chunk's vertices go in before any face is resolved, so a face using a vertex defined
+	// later in the file loads the same however the file was cut into chunks
+	std::vector<int> positionBases(chunks.size());
+	std::vector<int> uvBases(chunks.size());
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		positionBases[i] = (int)(filePositions.size() / 3);
+		uvBases[i] = (int)(fileUVs.size() / 2);
+		filePositions.insert(filePositions.end(), chunks[i].positions.begin(), chunks[i].positions.end());
+		fileUVs.insert(fileUVs.end(), chunks[i].uvs.begin(), chunks[i].uvs.end());
+		// Done with them, don't hold two copies of a big file's numbers
+		chunks[i].positions = std::vector<float>();
+		chunks[i].uvs = std::vector<float>();
+	}
+
+	// Every distinct position/uv pair becomes one vertex, in order of first use
+	CornerMap vertexLookup(positionCount);
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		for (ObjCorner corner : chunks[i].corners)
+		{
+			int positionIndex = corner.position + (corner.flags & CORNER_RELATIVE_POSITION ? positionBases[i] : 0);
+			int uvIndex = corner.flags & CORNER_NO_UV ? -1 : corner.uv + (corner.flags & CORNER_RELATIVE_UV ? uvBases[i] : 0);
+			if (positionIndex < 0 || (size_t)positionIndex * 3 >= filePositions.size() || (uvIndex >= 0 && (size_t)uvIndex * 2 >= fileUVs.size())
+				|| (uvIndex < 0 && !(corner.flags & CORNER_NO_UV)))
+			{
+				std::cout << "ERROR::OBJ::INDEX_OUT_OF_RANGE " << path << ": face corner " << positionIndex + 1 << "/" << uvIndex + 1 << std::endl;
+				return false;
+			}
+
+			uint64_t key = ((uint64_t)positionIndex << 32) | (uint32_t)uvIndex;
+			bool inserted;
+			unsigned int vertex = vertexLookup.findOrInsert(key, (unsigned int)mesh.vertexCount(), inserted);
+			if (inserted)
+			{
+				mesh.positions.insert(mesh.positions.end(), &filePositions[positionIndex * 3], &filePositions[positionIndex * 3] + 3);
+				if (uvIndex >= 0)
+					mesh.uvs.insert(mesh.uvs.end(), &fileUVs[uvIndex * 2], &fileUVs[uvIndex * 2] + 2);
+				else
+					mesh.uvs.insert(mesh.uvs.end(), { 0.0f, 0.0f });
+			}
+			mesh.indices.push_back(vertex);
+		}
+		chunks[i].corners = std::vector<ObjCorner>();
+	}
+	return true;
+}
+
+bool saveObj(const std::string& path, const MeshData& mesh)
+{
+	FILE* file = std::fopen(path.c_str(), "w");
+	if (!file)
+	{
+		std::cout << "ERROR::OBJ::CANNOT_WRITE " << path << std::endl;
+		return false;
+	}
+
+	// Positions and uvs share indices, every vertex is written once as both
+	for (size_t i = 0; i < mesh.vertexCount(); i++)
+		std::fprintf(file, "v %.7g %.7g %.7g\n", mesh.positions[i * 3], mesh.positions[i * 3 + 1], mesh.positions[i * 3 + 2]);
+	for (size_t i = 0; i < mesh.vertexCount(); i++)
+		std::fprintf(file, "vt %.7g %.7g\n", mesh.uvs[i * 2], mesh.uvs[i * 2 + 1]);
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+	{
+		unsigned int a = mesh.indices[i] + 1, b = mesh.indices[i + 1] + 1, c = mesh.indices[i + 2] + 1;
+		std::fprintf(file, "f %u/%u %u/%u %u/%u\n", a, a, b, b, c, c);
+	}
+
+	std::fclose(file);
+	return true;
+}
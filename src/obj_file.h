@@ -0,0 +1,14 @@
+#pragma once
+#include <string>
+
+#include "mesh_data.h"
+
+class ThreadPool;
+
+// Minimal Wavefront OBJ support: v, vt and f lines only, polygons are fan triangulated.
+// Every distinct position/uv pair becomes one vertex, so UV seams come out split like Model expects.
+// Normals, groups and materials are ignored. Faces may use vertices defined anywhere in the file.
+// The file is memory mapped and, given a thread pool, split into chunks at line breaks that are
+// parsed in parallel; numbers are read with number_parser, so the C locale doesn't matter.
+bool loadObj(const std::string& path, MeshData& mesh, ThreadPool* threadPool = nullptr);
+bool saveObj(const std::string& path, const MeshData& mesh);
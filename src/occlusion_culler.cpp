@@ -0,0 +1,316 @@
+#include "occlusion_culler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_SSE 1
+#include <emmintrin.h>
+#endif
+
+// Vertices closer than this in clip space w are treated as crossing the near plane
+static const float MIN_W = 1e-4f;
+
+OcclusionCuller::OcclusionCuller(int pWidth, int pHeight)
+	: width((pWidth + 3) & ~3), height(pHeight)
+{
+	glm::ivec2 size(width, height);
+	while (true)
+	{
+		levelSizes.push_back(size);
+		pyramid.emplace_back((size_t)size.x * size.y, 1.0f);
+		if (size.x == 1 && size.y == 1)
+			break;
+		size = glm::max((size + 1) / 2, glm::ivec2(1));
+	}
+}
+
+bool OcclusionCuller::hasSSE()
+{
+#if OCCLUSION_SSE
+	return true;
+#else
+	return false;
+#endif
+}
+
+void OcclusionCuller::beginFrame(const glm::mat4& pProjectionView)
+{
+	projectionView = pProjectionView;
+	triangles.clear();
+	std::fill(pyramid[0].begin(), pyramid[0].end(), 1.0f);
+	stats = OcclusionStats();
+}
+
+void OcclusionCuller::addOccluder(const Model& model, const glm::mat4& transform)
+{
+	const std::vector<float>& positions = model.getPositions();
+	const std::vector<unsigned int>& indices = model.getIndices();
+
+	glm::mat4 modelProjectionView = projectionView * transform;
+	clipVertices.resize(positions.size() / 3);
+	for (size_t i = 0; i < clipVertices.size(); i++)
+		clipVertices[i] = modelProjectionView * glm::vec4(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2], 1.0f);
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		glm::vec3 screen[3];
+		bool clipped = false;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			const glm::vec4& clip = clipVertices[indices[i + corner]];
+			// Dropping a triangle only makes the occluder smaller, which is always safe,
+			// so triangles crossing the near plane are skipped instead of clipped
+			if (clip.w < MIN_W || clip.z < -clip.w)
+			{
+				clipped = true;
+				break;
+			}
+			glm::vec3 ndc = glm::vec3(clip) / clip.w;
+			screen[corner] = glm::vec3((ndc.x * 0.5f + 0.5f) * width, (ndc.y * 0.5f + 0.5f) * height, ndc.z * 0.5f + 0.5f);
+		}
+		if (clipped)
+			continue;
+
+		// Occluders are treated as double sided, flip clockwise triangles so the inside is always positive
+		float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[2].x - screen[0].x) * (screen[1].y - screen[0].y);
+		if (area < 0.0f)
+		{
+			std::swap(screen[1], screen[2]);
+			area = -area;
+		}
+		if (area < 1e-6f)
+			continue;
+
+		ScreenTriangle triangle;
+		triangle.minX = std::max(0, (int)std::floor(std::min({ screen[0].x, screen[1].x, screen[2].x })));
+		triangle.maxX = std::min(width - 1, (int)std::ceil(std::max({ screen[0].x, screen[1].x, screen[2].x })));
+		triangle.minY = std::max(0, (int)std::floor(std::min({ screen[0].y, screen[1].y, screen[2].y })));
+		triangle.maxY = std::min(height - 1, (int)std::ceil(std::max({ screen[0].y, screen[1].y, screen[2].y })));
+		if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+			continue;
+
+		for (int edge = 0; edge < 3; edge++)
+		{
+			const glm::vec3& from = screen[edge];
+			const glm::vec3& to = screen[(edge + 1) % 3];
+			float a = from.y - to.y;
+			float b = to.x - from.x;
+			triangle.edges[edge] = glm::vec3(a, b, -(a * from.x + b * from.y));
+		}
+
+		// Window space depth is linear in screen space, so it can be interpolated as a plane
+		glm::vec3 d1 = screen[1] - screen[0];
+		glm::vec3 d2 = screen[2] - screen[0];
+		float depthX = (d1.z * d2.y - d2.z * d1.y) / area;
+		float depthY = (d2.z * d1.x - d1.z * d2.x) / area;
+		triangle.depthPlane = glm::vec3(depthX, depthY, screen[0].z - depthX * screen[0].x - depthY * screen[0].y);
+
+		triangles.push_back(triangle);
+	}
+}
+
+void OcclusionCuller::rasterize(ThreadPool& threadPool)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	// Bands don't overlap, so every job can write its rows without locking
+	size_t bandCount = (height + BAND_HEIGHT - 1) / BAND_HEIGHT;
+	threadPool.parallelFor(bandCount, 1, [this](size_t begin, size_t end)
+		{
+			int rowEnd = std::min(height, (int)end * BAND_HEIGHT);
+#if OCCLUSION_SSE
+			rasterizeRows((int)begin * BAND_HEIGHT, rowEnd);
+#else
+			rasterizeRowsScalar((int)begin * BAND_HEIGHT, rowEnd);
+#endif
+		});
+	buildPyramid();
+
+	stats.occluderTriangles = (unsigned int)triangles.size();
+	stats.rasterizeMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void OcclusionCuller::rasterizeRowsScalar(int rowBegin, int rowEnd)
+{
+	float* depth = pyramid[0].data();
+	for (const ScreenTriangle& triangle : triangles)
+	{
+		int minY = std::max(triangle.minY, rowBegin);
+		int maxY = std::min(triangle.maxY, rowEnd - 1);
+		for (int y = minY; y <= maxY; y++)
+		{
+			float* row = depth + (size_t)y * width;
+			float py = y + 0.5f;
+			for (int x = triangle.minX; x <= triangle.maxX; x++)
+			{
+				float px = x + 0.5f;
+				// Strictly inside, pixels on an edge stay empty which can only let more through
+				bool inside = true;
+				for (const glm::vec3& edge : triangle.edges)
+					inside &= edge.x * px + edge.y * py + edge.z > 0.0f;
+				if (!inside)
+					continue;
+				float z = triangle.depthPlane.x * px + triangle.depthPlane.y * py + triangle.depthPlane.z;
+				row[x] = std::min(row[x], z);
+			}
+		}
+	}
+}
+
+void OcclusionCuller::rasterizeRows(int rowBegin, int rowEnd)
+{
+#if OCCLUSION_SSE
+	float* depth = pyramid[0].data();
+	const __m128 pixelOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+
+	for (const ScreenTriangle& triangle : triangles)
+	{
+		int minY = std::max(triangle.minY, rowBegin);
+		int maxY = std::min(triangle.maxY, rowEnd - 1);
+		if (minY > maxY)
+			continue;
+
+		__m128 edgeA[3], edgeB[3], edgeC[3];
+		for (int edge = 0; edge < 3; edge++)
+		{
+			edgeA[edge] = _mm_set1_ps(triangle.edges[edge].x);
+			edgeB[edge] = _mm_set1_ps(triangle.edges[edge].y);
+			edgeC[edge] = _mm_set1_ps(triangle.edges[edge].z);
+		}
+		__m128 depthA = _mm_set1_ps(triangle.depthPlane.x);
+		__m128 depthB = _mm_set1_ps(triangle.depthPlane.y);
+		__m128 depthC = _mm_set1_ps(triangle.depthPlane.z);
+
+		// The width is a multiple of 4, so an aligned group of 4 never runs past the row.
+		// Pixels of the group outside the triangle's bounds fail the edge tests anyway.
+		int startX = triangle.minX & ~3;
+		for (int y = minY; y <= maxY; y++)
+		{
+			float* row = depth + (size_t)y * width;
+			__m128 py = _mm_set1_ps(y + 0.5f);
+			__m128 rowEdge[3];
+			for (int edge = 0; edge < 3; edge++)
+				rowEdge[edge] = _mm_add_ps(_mm_mul_ps(edgeB[edge], py), edgeC[edge]);
+			__m128 rowDepth = _mm_add_ps(_mm_mul_ps(depthB, py), depthC);
+
+			for (int x = startX; x <= triangle.maxX; x += 4)
+			{
+				__m128 px = _mm_add_ps(_mm_set1_ps((float)x), pixelOffsets);
+				__m128 inside = _mm_cmpgt_ps(_mm_add_ps(_mm_mul_ps(edgeA[0], px), rowEdge[0]), zero);
+				inside = _mm_and_ps(inside, _mm_cmpgt_ps(_mm_add_ps(_mm_mul_ps(edgeA[1], px), rowEdge[1]), zero));
+				inside = _mm_and_ps(inside, _mm_cmpgt_ps(_mm_add_ps(_mm_mul_ps(edgeA[2], px), rowEdge[2]), zero));
+				if (_mm_movemask_ps(inside) == 0)
+					continue;
+
+				__m128 z = _mm_add_ps(_mm_mul_ps(depthA, px), rowDepth);
+				__m128 current = _mm_loadu_ps(row + x);
+				__m128 closer = _mm_min_ps(current, z);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, closer), _mm_andnot_ps(inside, current)));
+			}
+		}
+	}
+#else
+	rasterizeRowsScalar(rowBegin, rowEnd);
+#endif
+}
+
+void OcclusionCuller::buildPyramid()
+{
+	for (size_t level = 1; level < pyramid.size(); level++)
+	{
+		const std::vector<float>& source = pyramid[level - 1];
+		std::vector<float>& destination = pyramid[level];
+		glm::ivec2 sourceSize = levelSizes[level - 1];
+		glm::ivec2 size = levelSizes[level];
+
+		for (int y = 0; y < size.y; y++)
+		{
+			// Odd sizes: the last texel also covers the leftover row/column
+			int y0 = y * 2;
+			int y1 = std::min(y0 + 1, sourceSize.y - 1);
+			for (int x = 0; x < size.x; x++)
+			{
+				int x0 = x * 2;
+				int x1 = std::min(x0 + 1, sourceSize.x - 1);
+				destination[(size_t)y * size.x + x] = std::max(
+					std::max(source[(size_t)y0 * sourceSize.x + x0], source[(size_t)y0 * sourceSize.x + x1]),
+					std::max(source[(size_t)y1 * sourceSize.x + x0], source[(size_t)y1 * sourceSize.x + x1]));
+			}
+		}
+	}
+}
+
+bool OcclusionCuller::isVisible(const AABB& bounds) const
+{
+	glm::vec2 screenMin(FLT_MAX);
+	glm::vec2 screenMax(-FLT_MAX);
+	float nearestDepth = FLT_MAX;
+	for (int corner = 0; corner < 8; corner++)
+	{
+		glm::vec3 point((corner & 1) ? bounds.max.x : bounds.min.x, (corner & 2) ? bounds.max.y : bounds.min.y, (corner & 4) ? bounds.max.z : bounds.min.z);
+		glm::vec4 clip = projectionView * glm::vec4(point, 1.0f);
+		// Crossing the near plane, the camera might be inside the box
+		if (clip.w < MIN_W || clip.z < -clip.w)
+			return true;
+
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		glm::vec2 screen((ndc.x * 0.5f + 0.5f) * width, (ndc.y * 0.5f + 0.5f) * height);
+		screenMin = glm::min(screenMin, screen);
+		screenMax = glm::max(screenMax, screen);
+		nearestDepth = std::min(nearestDepth, ndc.z * 0.5f + 0.5f);
+	}
+
+	int minX = std::max(0, (int)std::floor(screenMin.x));
+	int minY = std::max(0, (int)std::floor(screenMin.y));
+	int maxX = std::min(width - 1, (int)std::floor(screenMax.x));
+	int maxY = std::min(height - 1, (int)std::floor(screenMax.y));
+	// Off screen, that's for the frustum culler to decide
+	if (minX > maxX || minY > maxY)
+		return true;
+
+	// Go up the pyramid until the rectangle covers at most 4x4 texels
+	size_t level = 0;
+	while (level + 1 < pyramid.size() && ((maxX >> level) - (minX >> level) > 3 || (maxY >> level) - (minY >> level) > 3))
+		level++;
+
+	const std::vector<float>& depth = pyramid[level];
+	int levelWidth = levelSizes[level].x;
+	for (int y = minY >> level; y <= (maxY >> level); y++)
+	{
+		for (int x = minX >> level; x <= (maxX >> level); x++)
+		{
+			// The box is hidden only where all occluders in the texel are in front of it
+			if (depth[(size_t)y * levelWidth + x] >= nearestDepth)
+				return true;
+		}
+	}
+	return false;
+}
+
+void OcclusionCuller::cull(const std::vector<AABB>& bounds, std::vector<uint32_t>& visible, ThreadPool& threadPool)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<uint8_t> keep(visible.size());
+	threadPool.parallelFor(visible.size(), 256, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				keep[i] = isVisible(bounds[visible[i]]);
+		});
+
+	size_t written = 0;
+	for (size_t i = 0; i < visible.size(); i++)
+	{
+		if (keep[i])
+			visible[written++] = visible[i];
+	}
+
+	stats.tested = (unsigned int)visible.size();
+	stats.occluded = (unsigned int)(visible.size() - written);
+	visible.resize(written);
+
+	stats.testMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
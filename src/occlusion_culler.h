@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "aabb.h"
+#include "model.h"
+#include "thread_pool.h"
+
+struct OcclusionStats
+{
+	unsigned int occluderTriangles = 0;
+	unsigned int tested = 0;
+	unsigned int occluded = 0;
+	double rasterizeMilliseconds = 0.0;
+	double testMilliseconds = 0.0;
+};
+
+// Software occlusion culling. A handful of big, simple occluders (walls, floors, ...) are
+// rasterized into a small depth buffer on the CPU, then entity bounding boxes are tested
+// against a max depth pyramid built from it. Only boxes that are completely behind the
+// occluders get rejected, anything uncertain counts as visible.
+// Depth is window space [0, 1] like the GL depth buffer, rows go bottom to top.
+class OcclusionCuller
+{
+public:
+	OcclusionStats stats;
+
+	// The width is rounded up to a multiple of 4 so rows can be filled 4 pixels at a time
+	OcclusionCuller(int width = 256, int height = 144);
+
+	// Clears the depth buffer and forgets last frame's occluders
+	void beginFrame(const glm::mat4& projectionView);
+	// Transforms the occluder's triangles to screen space, nothing is rasterized yet
+	void addOccluder(const Model& model, const glm::mat4& transform);
+	// Rasterizes the occluders in horizontal bands on the pool, then builds the pyramid
+	void rasterize(ThreadPool& threadPool);
+
+	bool isVisible(const AABB& bounds) const;
+	// Removes the occluded entries from visible, indices refer to bounds
+	void cull(const std::vector<AABB>& bounds, std::vector<uint32_t>& visible, ThreadPool& threadPool);
+
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	// Full resolution depth, width * height floats
+	const float* getDepth() const { return pyramid[0].data(); }
+
+	static bool hasSSE();
+
+private:
+	// Rows per job when rasterizing
+	static const int BAND_HEIGHT = 8;
+
+	struct ScreenTriangle
+	{
+		// Edge functions a * x + b * y + c, positive inside
+		glm::vec3 edges[3];
+		// Depth as a plane over the screen
+		glm::vec3 depthPlane;
+		int minX, maxX, minY, maxY;
+	};
+
+	int width;
+	int height;
+	glm::mat4 projectionView;
+	std::vector<ScreenTriangle> triangles;
+	std::vector<glm::vec4> clipVertices;
+
+	// Level 0 is the depth buffer, every level after holds the max depth of 2x2 texels of the one before
+	std::vector<std::vector<float>> pyramid;
+	std::vector<glm::ivec2> levelSizes;
+
+	// Rasterizes the part of every triangle that falls in rows [rowBegin, rowEnd)
+	void rasterizeRows(int rowBegin, int rowEnd);
+	void rasterizeRowsScalar(int rowBegin, int rowEnd);
+	void buildPyramid();
+};
@@ -0,0 +1,44 @@
+#include "occlusion_debug_view.h"
+
+#include <glad/glad.h>
+
+#include "gl_state.h"
+
+OcclusionDebugView::OcclusionDebugView(Shader& pShader)
+	: shader(pShader)
+{
+	texture = TextureHandle::create("OcclusionDebugView");
+	// Core profile won't draw without a VAO bound, even one with no attributes
+	emptyVAO = VertexArrayHandle::create("OcclusionDebugView");
+
+	depthLocation = shader.getUniformLocation("occlusionDepth");
+	nearLocation = shader.getUniformLocation("nearPlane");
+	farLocation = shader.getUniformLocation("farPlane");
+}
+
+void OcclusionDebugView::draw(const OcclusionCuller& culler, float nearPlane, float farPlane)
+{
+	GLState::bindTexture(0, GL_TEXTURE_2D, texture.get());
+	if (textureWidth != culler.getWidth() || textureHeight != culler.getHeight())
+	{
+		textureWidth = culler.getWidth();
+		textureHeight = culler.getHeight();
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, textureWidth, textureHeight, 0, GL_RED, GL_FLOAT, nullptr);
+		texture.setMemory((size_t)textureWidth * textureHeight * sizeof(float));
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	}
+	// Rows are 4 floats aligned, the default unpack alignment is fine
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, textureWidth, textureHeight, GL_RED, GL_FLOAT, culler.getDepth());
+
+	shader.activate();
+	shader.setInt(depthLocation, 0);
+	shader.setFloat(nearLocation, nearPlane);
+	shader.setFloat(farLocation, farPlane);
+
+	// Drawn on top of everything, prepare() turns depth testing back on next frame
+	GLState::disable(GL_DEPTH_TEST);
+	GLState::bindVertexArray(emptyVAO.get());
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	GLState::enable(GL_DEPTH_TEST);
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "gpu_resources.h"
+#include "occlusion_culler.h"
+#include "shader_s.h"
+
+// Draws the occlusion culler's depth buffer into a corner of the screen.
+// Uses occlusion_debug.shader, which makes its quad from gl_VertexID so no vertex data is needed.
+class OcclusionDebugView
+{
+public:
+	explicit OcclusionDebugView(Shader& shader);
+
+	OcclusionDebugView(const OcclusionDebugView&) = delete;
+	OcclusionDebugView& operator=(const OcclusionDebugView&) = delete;
+
+	// Uploads the current depth buffer and draws it. Near and far linearize the depth for display.
+	void draw(const OcclusionCuller& culler, float nearPlane, float farPlane);
+
+private:
+	Shader& shader;
+	TextureHandle texture;
+	VertexArrayHandle emptyVAO;
+	int textureWidth = 0;
+	int textureHeight = 0;
+
+	int depthLocation;
+	int nearLocation;
+	int farLocation;
+};
@@ -0,0 +1,144 @@
+#include "program_cache.h"
+
+#include <glad/glad.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+ProgramCache::Stats ProgramCache::stats;
+std::string ProgramCache::directory = RESOURCES_PATH "shader_cache/";
+
+// Header written before the binary blob
+struct ProgramCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t format;
+	uint32_t binaryLength;
+	// Length of the driver string stored after the header
+	uint32_t driverLength;
+};
+
+// FNV-1a, good enough to tell shader sources apart
+static uint64_t hashBytes(uint64_t hash, const std::string& bytes)
+{
+	for (unsigned char c : bytes)
+	{
+		hash ^= c;
+		hash *= 0x100000001b3ull;
+	}
+	// Separator so ("ab", "c") and ("a", "bc") hash differently
+	hash ^= 0xFF;
+	hash *= 0x100000001b3ull;
+	return hash;
+}
+
+bool ProgramCache::supported()
+{
+	static int formats = -1;
+	if (formats < 0)
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	return formats > 0;
+}
+
+const std::string& ProgramCache::driverString()
+{
+	static std::string driver;
+	if (driver.empty())
+	{
+		driver = std::string((const char*)glGetString(GL_VENDOR)) + "|"
+			+ (const char*)glGetString(GL_RENDERER) + "|"
+			+ (const char*)glGetString(GL_VERSION);
+	}
+	return driver;
+}
+
+std::string ProgramCache::entryPath(const std::string& vertexSource, const std::string& fragmentSource)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	hash = hashBytes(hash, vertexSource);
+	hash = hashBytes(hash, fragmentSource);
+	hash = hashBytes(hash, driverString());
+
+	std::stringstream path;
+	path << directory << std::hex << hash << ".bin";
+	return path.str();
+}
+
+bool ProgramCache::load(unsigned int program, const std::string& vertexSource, const std::string& fragmentSource)
+{
+	if (!supported())
+		return false;
+
+	// Opened at the end so the lengths in the header can be checked against the file's size
+	std::ifstream file(entryPath(vertexSource, fragmentSource), std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+	uint64_t fileSize = (uint64_t)file.tellg();
+	file.seekg(0);
+
+	ProgramCacheHeader header;
+	if (!file.read((char*)&header, sizeof(header)) || header.magic != MAGIC || header.version != VERSION)
+		return false;
+
+	// store() writes exactly header, driver and binary. Anything else is a corrupt or truncated
+	// entry and a miss, before its lengths get to size an allocation.
+	if ((uint64_t)header.driverLength + header.binaryLength != fileSize - sizeof(header))
+		return false;
+
+	// The hash already covers the driver, but a collision must never feed a foreign binary to the driver
+	std::string driver(header.driverLength, '\0');
+	if (!file.read(&driver[0], header.driverLength) || driver != driverString())
+		return false;
+
+	std::vector<char> binary(header.binaryLength);
+	if (!file.read(binary.data(), header.binaryLength))
+		return false;
+
+	glProgramBinary(program, header.format, binary.data(), header.binaryLength);
+
+	// Drivers are allowed to reject binaries at any time, e.g. after an update
+	int success = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	return success != 0;
+}
+
+void ProgramCache::store(unsigned int program, const std::string& vertexSource, const std::string& fragmentSource)
+{
+	if (!supported())
+		return;
+
+	int length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+
+	std::ofstream file(entryPath(vertexSource, fragmentSource), std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		std::cout << "ERROR::PROGRAM_CACHE::Could not write to " << directory << std::endl;
+		return;
+	}
+
+	const std::string& driver = driverString();
+	ProgramCacheHeader header = { MAGIC, VERSION, format, (uint32_t)length, (uint32_t)driver.size() };
+	file.write((const char*)&header, sizeof(header));
+	file.write(driver.data(), driver.size());
+	file.write(binary.data(), length);
+}
+
+void ProgramCache::printReport()
+{
+	std::cout << "Program cache: " << stats.hits << " hits (" << stats.hitMilliseconds << " ms), "
+		<< stats.misses << " misses (" << stats.missMilliseconds << " ms)" << std::endl;
+}
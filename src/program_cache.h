@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Keeps linked program binaries on disk so later launches can skip compiling and linking GLSL.
+// Entries are keyed by a hash of the sources plus the driver's vendor/renderer/version,
+// so a driver update or a different GPU just misses and falls back to a source compile.
+class ProgramCache
+{
+public:
+	struct Stats
+	{
+		unsigned int hits = 0;
+		unsigned int misses = 0;
+		// Time spent creating programs, split by whether the cache was used
+		double hitMilliseconds = 0.0;
+		double missMilliseconds = 0.0;
+	};
+
+	static Stats stats;
+	// Where binaries are written, created on first store
+	static std::string directory;
+
+	// Loads a cached binary for these sources into program.
+	// Returns false on a miss or if the driver rejects the binary, program must then be built from source.
+	static bool load(unsigned int program, const std::string& vertexSource, const std::string& fragmentSource);
+	// Saves the binary of a successfully linked program.
+	// It must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+	static void store(unsigned int program, const std::string& vertexSource, const std::string& fragmentSource);
+
+	// Logs hits/misses and the time they took
+	static void printReport();
+
+private:
+	static const uint32_t MAGIC = 0x42505047; // "GPPB"
+	static const uint32_t VERSION = 1;
+
+	static bool supported();
+	static const std::string& driverString();
+	static std::string entryPath(const std::string& vertexSource, const std::string& fragmentSource);
+};
@@ -0,0 +1,110 @@
+#include "render_queue.h"
+
+#include <algorithm>
+
+void RenderQueue::clear()
+{
+	// Keep the allocations around for next frame
+	packets.clear();
+	order.clear();
+}
+
+void RenderQueue::push(Shader* shader, Model* model, const glm::mat4& transform, float viewDepth, float farPlane, unsigned int lod)
+{
+	packets.push_back(makePacket(shader, model, transform, viewDepth, farPlane, lod));
+}
+
+DrawPacket* RenderQueue::append(size_t count)
+{
+	size_t first = packets.size();
+	packets.resize(first + count);
+	return packets.data() + first;
+}
+
+DrawPacket RenderQueue::makePacket(Shader* shader, Model* model, const glm::mat4& transform, float viewDepth, float farPlane, unsigned int lod)
+{
+	DrawPacket packet;
+	packet.sortKey = makeSortKey(shader->ID, model->texture->textureID, model->getLod(lod).VAO_ID, viewDepth / farPlane);
+	packet.shader = shader;
+	packet.model = model;
+	packet.lod = lod;
+	packet.transform = transform;
+	return packet;
+}
+
+uint64_t RenderQueue::makeSortKey(unsigned int shaderID, unsigned int textureID, unsigned int VAO_ID, float normalizedDepth)
+{
+	// GL object names are small integers handed out sequentially, so masking them keeps
+	// them unique unless an app creates tens of thousands of objects of one kind
+	uint64_t shaderBits = shaderID & ((1u << SHADER_BITS) - 1);
+	uint64_t textureBits = textureID & ((1u << TEXTURE_BITS) - 1);
+	uint64_t vaoBits = VAO_ID & ((1u << VAO_BITS) - 1);
+
+	// Anything behind the camera or past the far plane is clamped to the ends of the range
+	float depth = std::min(std::max(normalizedDepth, 0.0f), 1.0f);
+	uint64_t depthBits = (uint64_t)(depth * ((1u << DEPTH_BITS) - 1));
+
+	return (shaderBits << (TEXTURE_BITS + VAO_BITS + DEPTH_BITS))
+		| (textureBits << (VAO_BITS + DEPTH_BITS))
+		| (vaoBits << DEPTH_BITS)
+		| depthBits;
+}
+
+void RenderQueue::sort()
+{
+	size_t count = packets.size();
+	order.resize(count);
+	scratch.resize(count);
+	for (size_t i = 0; i < count; i++)
+		order[i] = { packets[i].sortKey, (uint32_t)i };
+
+	// LSD radix sort, one byte per pass. All eight histograms are built in a single
+	// read over the keys, then every pass is a stable scatter into the other buffer.
+	const int PASSES = sizeof(uint64_t);
+	size_t histograms[PASSES][256] = {};
+	for (const SortEntry& entry : order)
+	{
+		for (int pass = 0; pass < PASSES; pass++)
+			histograms[pass][(entry.key >> (pass * 8)) & 0xFF]++;
+	}
+
+	SortEntry* src = order.data();
+	SortEntry* dst = scratch.data();
+	for (int pass = 0; pass < PASSES; pass++)
+	{
+		size_t* histogram = histograms[pass];
+
+		// If every key has the same byte here this pass wouldn't move anything.
+		// This is common, since the high shader bits are usually all zero.
+		bool trivial = false;
+		for (int b = 0; b < 256; b++)
+		{
+			if (histogram[b] == count)
+			{
+				trivial = true;
+				break;
+			}
+		}
+		if (trivial)
+			continue;
+
+		// Turn counts into starting offsets
+		size_t offset = 0;
+		for (int b = 0; b < 256; b++)
+		{
+			size_t bucketCount = histogram[b];
+			histogram[b] = offset;
+			offset += bucketCount;
+		}
+
+		int shift = pass * 8;
+		for (size_t i = 0; i < count; i++)
+			dst[histogram[(src[i].key >> shift) & 0xFF]++] = src[i];
+
+		std::swap(src, dst);
+	}
+
+	// An odd number of scatters leaves the result in the scratch buffer
+	if (src != order.data())
+		order.swap(scratch);
+}
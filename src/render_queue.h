@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "model.h"
+#include "shader_s.h"
+
+// Everything needed to issue one draw, collected during the frame and submitted later
+struct DrawPacket
+{
+	uint64_t sortKey;
+	Shader* shader;
+	Model* model;
+	// Index into model->lods
+	unsigned int lod;
+	glm::mat4 transform;
+};
+
+// Collects draw packets for a frame and orders them so packets sharing
+// a shader, then a texture, then a VAO end up next to each other.
+// Within a state bucket packets are ordered front to back for early depth rejection.
+class RenderQueue
+{
+public:
+	// Bit layout of the sort key, most significant first:
+	// shader (12) | texture (16) | VAO (16) | depth (20)
+	static const int SHADER_BITS = 12;
+	static const int TEXTURE_BITS = 16;
+	static const int VAO_BITS = 16;
+	static const int DEPTH_BITS = 20;
+
+	void clear();
+	// viewDepth is the distance along the camera's view direction, farPlane is used to normalize it
+	void push(Shader* shader, Model* model, const glm::mat4& transform, float viewDepth, float farPlane, unsigned int lod = 0);
+	// Adds count packets at the end and returns where to write them. Lets several threads copy
+	// recorded packets in at once, each into its own range. Only valid until the next push/append.
+	DrawPacket* append(size_t count);
+	// Radix sorts the packets by key. Call once after all packets are pushed.
+	void sort();
+
+	size_t size() const { return packets.size(); }
+	// Valid after sort(), in submission order
+	const DrawPacket& operator[](size_t i) const { return packets[order[i].index]; }
+
+	static uint64_t makeSortKey(unsigned int shaderID, unsigned int textureID, unsigned int VAO_ID, float normalizedDepth);
+	static DrawPacket makePacket(Shader* shader, Model* model, const glm::mat4& transform, float viewDepth, float farPlane, unsigned int lod = 0);
+
+private:
+	struct SortEntry
+	{
+		uint64_t key;
+		uint32_t index;
+	};
+
+	std::vector<DrawPacket> packets;
+	std::vector<SortEntry> order;
+	// Ping-pong buffer for the radix passes
+	std::vector<SortEntry> scratch;
+};
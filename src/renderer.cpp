@@ -1,57 +1,297 @@
 #include "renderer.h"
-#define GLM_ENABLE_EXPERIMENTAL
+
+#include <algorithm>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
-#include <glm/gtc/quaternion.hpp>
-#include <glm/gtx/quaternion.hpp>
 
 #include "shader_s.h"
+#include "gl_state.h"
+#include "geometry_pool.h"
 
 Renderer::Renderer()
+	: instanceStream(GL_ARRAY_BUFFER, STREAM_REGION_SIZE)
 {
+	// Camera block storage, filled in by prepare() every frame
+	cameraBuffer = BufferHandle::create("Renderer");
+	GLState::bindBuffer(GL_UNIFORM_BUFFER, cameraBuffer.get());
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), nullptr, GL_DYNAMIC_DRAW);
+	cameraBuffer.setMemory(sizeof(CameraBlock));
+	GLState::bindBufferBase(GL_UNIFORM_BUFFER, Shader::CAMERA_BLOCK_BINDING, cameraBuffer.get());
 }
 
-void Renderer::render(Entity& entity, Shader& shader, Camera& camera, Display& display)
+void Renderer::render(Entity& entity, Shader& shader)
 {
-	glBindVertexArray(entity.model->VAO_ID);
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
+	// The attribute arrays are enabled once in the pool's VAO, binding it is enough
+	const ModelLod& lod = entity.model->getLod(entity.lod);
+	const GeometryRange& range = GeometryPool::shared().getRange(lod.geometry);
+	GLState::bindVertexArray(lod.VAO_ID);
 	shader.activate();
 
-	float aspectRatio = display.displayWidth / display.displayHeight;
-	glm::mat4 perspective = glm::perspective(glm::radians(camera.FOV), aspectRatio, camera.NEAR_PLANE, camera.FAR_PLANE);
-	shader.setMat4("projection", glm::value_ptr(perspective));
+	// Apply entity positions and transformations, after decoding quantized vertex positions.
+	// Projection and view come from the camera block uploaded in prepare().
+	glm::mat4 transform = entity.transform * entity.model->positionDecode;
+	int location = getTransformLocation(shader);
+
+	GLState::bindTexture(0, GL_TEXTURE_2D, entity.model->texture->textureID);
+
+	if (transformIsAttribute)
+	{
+		// A draw of one instance, reading its transform from the stream buffer
+		unsigned int baseInstance;
+		*allocateTransforms(1, baseInstance) = transform;
+		enableInstanceAttributes(lod.VAO_ID);
+		GLState::bindVertexArray(lod.VAO_ID);
+		glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, lod.vertex_count, GL_UNSIGNED_INT, range.indexOffset(), 1, range.baseVertex, baseInstance);
+	}
+	else
+	{
+		shader.setMat4(location, transform);
+		glDrawElementsBaseVertex(GL_TRIANGLES, lod.vertex_count, GL_UNSIGNED_INT, range.indexOffset(), range.baseVertex);
+	}
+	stats.drawCalls++;
+	stats.instances++;
+}
+
+void Renderer::renderInstanced(const std::vector<Entity>& entities, Shader& shader)
+{
+	// Group transforms by model. Clearing keeps each vector's capacity from last frame.
+	for (auto& batch : batches)
+		batch.second.transforms.clear();
+	for (const Entity& entity : entities)
+		addToBatch(entity);
 
-	// Apply entity positions and transformations
-	glm::mat4 translate = glm::translate(glm::mat4(1.0f), entity.position);
+	drawBatches(entities.size(), shader);
+}
 
-	glm::vec3 eulerAngles(glm::radians(entity.rotationX), glm::radians(entity.rotationY), glm::radians(entity.rotationZ));
-	glm::mat4 rotation = glm::toMat4(glm::quat(eulerAngles));
+void Renderer::renderInstanced(const std::vector<Entity>& entities, const std::vector<uint32_t>& visible, Shader& shader)
+{
+	for (auto& batch : batches)
+		batch.second.transforms.clear();
+	for (uint32_t index : visible)
+		addToBatch(entities[index]);
 
-	glm::mat4 scale = glm::scale(glm::mat4(1.0f), glm::vec3(entity.scale, entity.scale, entity.scale));
+	drawBatches(visible.size(), shader);
+}
 
-	glm::mat4 transform = translate * rotation * scale;
-	shader.setMat4("transform", glm::value_ptr(transform));
+void Renderer::addToBatch(const Entity& entity)
+{
+	const ModelLod& lod = entity.model->getLod(entity.lod);
+	InstanceBatch& batch = batches[lod.geometry];
+	batch.model = entity.model;
+	batch.lod = entity.lod;
+	batch.transforms.push_back(entity.transform * entity.model->positionDecode);
+}
 
-	glm::mat4 view;
-	view = glm::lookAt(camera.cameraPos, camera.cameraPos + camera.cameraFront, camera.cameraUp);
-	shader.setMat4("view", glm::value_ptr(view));
+void Renderer::drawBatches(size_t instanceCount, Shader& shader)
+{
+	// Write every batch back to back into the stream buffer. Each batch is then drawn
+	// with a base instance pointing at its first transform, so the attribute pointers
+	// stored in the pool VAOs never need to change.
+	unsigned int baseInstance;
+	glm::mat4* transforms = allocateTransforms(instanceCount, baseInstance);
+	for (auto& batch : batches)
+	{
+		std::copy(batch.second.transforms.begin(), batch.second.transforms.end(), transforms);
+		transforms += batch.second.transforms.size();
+	}
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, entity.model->texture.textureID);
+	shader.activate();
 
-	glDrawElements(GL_TRIANGLES, entity.model->vertex_count, GL_UNSIGNED_INT, 0);
+	for (auto& batch : batches)
+	{
+		Model* model = batch.second.model;
+		unsigned int batchCount = batch.second.transforms.size();
+		if (batchCount == 0)
+			continue;
 
-	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
-	glBindVertexArray(0);
+		const ModelLod& lod = model->getLod(batch.second.lod);
+		const GeometryRange& range = GeometryPool::shared().getRange(lod.geometry);
+		enableInstanceAttributes(lod.VAO_ID);
+		// Models sharing a vertex format share the VAO, so this is usually filtered
+		GLState::bindVertexArray(lod.VAO_ID);
+		GLState::bindTexture(0, GL_TEXTURE_2D, model->texture->textureID);
+
+		glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, lod.vertex_count, GL_UNSIGNED_INT, range.indexOffset(), batchCount, range.baseVertex, baseInstance);
+		stats.drawCalls++;
+		stats.instances += batchCount;
+
+		baseInstance += batchCount;
+	}
 }
 
-void Renderer::prepare()
+void Renderer::submit(const RenderQueue& queue)
 {
-	glEnable(GL_DEPTH_TEST);
-	glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+	Shader* currentShader = nullptr;
+	int currentTransformLocation = -1;
+	unsigned int currentTexture = 0;
+	unsigned int currentVAO = 0;
+
+	// Stream every transform up front, packet i reads instance baseInstance + i.
+	// Shaders using the uniform just ignore them.
+	unsigned int baseInstance = 0;
+	glm::mat4* transforms = allocateTransforms(queue.size(), baseInstance);
+	for (size_t i = 0; i < queue.size(); i++)
+		transforms[i] = queue[i].transform * queue[i].model->positionDecode;
+
+	for (size_t i = 0; i < queue.size(); i++)
+	{
+		const DrawPacket& packet = queue[i];
+
+		if (packet.shader != currentShader)
+		{
+			currentShader = packet.shader;
+			currentShader->activate();
+			currentTransformLocation = getTransformLocation(*currentShader);
+			// The VAO may have only been used with uniform transforms so far
+			if (transformIsAttribute && currentVAO != 0)
+				enableInstanceAttributes(currentVAO);
+		}
+		else
+			stats.bindsAvoided++;
+
+		if (packet.model->texture->textureID != currentTexture)
+		{
+			currentTexture = packet.model->texture->textureID;
+			GLState::bindTexture(0, GL_TEXTURE_2D, currentTexture);
+		}
+		else
+			stats.bindsAvoided++;
+
+		const ModelLod& lod = packet.model->getLod(packet.lod);
+		const GeometryRange& range = GeometryPool::shared().getRange(lod.geometry);
+		if (lod.VAO_ID != currentVAO)
+		{
+			currentVAO = lod.VAO_ID;
+			if (transformIsAttribute)
+				enableInstanceAttributes(currentVAO);
+			GLState::bindVertexArray(currentVAO);
+		}
+		else
+			stats.bindsAvoided++;
+
+		if (transformIsAttribute)
+		{
+			glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, lod.vertex_count, GL_UNSIGNED_INT, range.indexOffset(), 1, range.baseVertex, baseInstance + (unsigned int)i);
+		}
+		else
+		{
+			currentShader->setMat4(currentTransformLocation, packet.transform * packet.model->positionDecode);
+			glDrawElementsBaseVertex(GL_TRIANGLES, lod.vertex_count, GL_UNSIGNED_INT, range.indexOffset(), range.baseVertex);
+		}
+		stats.drawCalls++;
+		stats.instances++;
+	}
+}
+
+void Renderer::submit(const ClusterDrawList& drawList, Shader& shader)
+{
+	if (drawList.commands.empty())
+		return;
+
+	// Transforms and commands share one allocation, so a grow can't separate them.
+	// Starting on a whole mat4 makes the offset an exact instance index.
+	size_t transformSize = drawList.transforms.size() * sizeof(glm::mat4);
+	size_t commandSize = drawList.commands.size() * sizeof(DrawElementsIndirectCommand);
+	size_t offset;
+	unsigned char* memory = (unsigned char*)instanceStream.allocate(transformSize + commandSize, sizeof(glm::mat4), offset);
+	unsigned int baseInstance = (unsigned int)(offset / sizeof(glm::mat4));
+
+	std::copy(drawList.transforms.begin(), drawList.transforms.end(), (glm::mat4*)memory);
+	DrawElementsIndirectCommand* commands = (DrawElementsIndirectCommand*)(memory + transformSize);
+	for (size_t i = 0; i < drawList.commands.size(); i++)
+	{
+		commands[i] = drawList.commands[i];
+		commands[i].baseInstance += baseInstance;
+	}
+
+	shader.activate();
+	// Any buffer can be read as commands, the stream buffer just has to be bound there too
+	GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, instanceStream.getBufferID());
+
+	for (const ClusterDrawList::Batch& batch : drawList.batches)
+	{
+		enableInstanceAttributes(batch.VAO_ID);
+		GLState::bindVertexArray(batch.VAO_ID);
+		GLState::bindTexture(0, GL_TEXTURE_2D, batch.textureID);
+
+		size_t commandOffset = offset + transformSize + batch.firstCommand * sizeof(DrawElementsIndirectCommand);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)commandOffset, (GLsizei)batch.commandCount, 0);
+		stats.drawCalls++;
+	}
+	stats.instances += (unsigned int)drawList.transforms.size();
+}
+
+int Renderer::getTransformLocation(Shader& shader)
+{
+	// Resolved when the shader was linked, no lookup on the per-draw path
+	transformIsAttribute = shader.transformIsAttribute;
+	return shader.transformLocation;
+}
+
+glm::mat4* Renderer::allocateTransforms(size_t count, unsigned int& baseInstance)
+{
+	// Aligned to a whole mat4 so the offset is an exact instance index
+	size_t offset;
+	void* memory = instanceStream.allocate(std::max<size_t>(count, 1) * sizeof(glm::mat4), sizeof(glm::mat4), offset);
+	baseInstance = (unsigned int)(offset / sizeof(glm::mat4));
+	return (glm::mat4*)memory;
+}
+
+void Renderer::enableInstanceAttributes(unsigned int VAO_ID)
+{
+	// The stream buffer grew, every VAO still points at the old one
+	if (instanceBufferID != instanceStream.getBufferID())
+	{
+		instanceBufferID = instanceStream.getBufferID();
+		instancedVAOs.clear();
+	}
+	if (instancedVAOs.count(VAO_ID))
+		return;
+
+	GLState::bindVertexArray(VAO_ID);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, instanceBufferID);
+
+	// A mat4 attribute takes up 4 consecutive locations, one per column
+	for (unsigned int column = 0; column < 4; column++)
+	{
+		unsigned int location = 2 + column;
+		glEnableVertexAttribArray(location);
+		glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(sizeof(glm::vec4) * column));
+		// Advance once per instance instead of once per vertex
+		glVertexAttribDivisor(location, 1);
+	}
+
+	instancedVAOs.insert(VAO_ID);
+}
+
+void Renderer::prepare(Camera& camera, Display& display)
+{
+	stats = RenderStats();
+	GLState::resetStats();
+	instanceStream.beginFrame();
+
+	// Projection and view only change once per frame, so they're uploaded here once
+	// and every shader declaring the camera block reads them from the same buffer
+	float aspectRatio = display.displayWidth / display.displayHeight;
+	CameraBlock block;
+	block.projection = camera.getProjectionMatrix(aspectRatio);
+	block.view = camera.getViewMatrix();
+	block.projectionView = block.projection * block.view;
+	block.cameraPosition = glm::vec4(camera.cameraPos, 1.0f);
+
+	GLState::bindBuffer(GL_UNIFORM_BUFFER, cameraBuffer.get());
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraBlock), &block);
+
+	GLState::enable(GL_DEPTH_TEST);
+	GLState::clearColor(0.2f, 0.3f, 0.3f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
+
+void Renderer::finishFrame()
+{
+	instanceStream.endFrame();
+	stats.bytesStreamed = instanceStream.stats.bytesStreamed;
+	stats.fenceWaitMilliseconds = instanceStream.stats.fenceWaitMilliseconds;
+}
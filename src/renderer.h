@@ -1,5 +1,9 @@
 #pragma once
 
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
 #include <glad/glad.h>
 #include <stb_image/stb_image.h>
 #include <glm/glm.hpp>
@@ -9,12 +13,95 @@
 #include "camera.h"
 #include "display.h"
 #include "shader_s.h"
+#include "render_queue.h"
+#include "cluster_culler.h"
+#include "stream_buffer.h"
+
+// Per-frame counters, reset by Renderer::prepare
+struct RenderStats
+{
+	unsigned int drawCalls = 0;
+	unsigned int instances = 0;
+	// Program/texture/VAO binds skipped by RenderQueue submission because the state was already current
+	unsigned int bindsAvoided = 0;
+	// Per-draw data written to the stream buffer, and time spent waiting for the GPU to release it
+	size_t bytesStreamed = 0;
+	double fenceWaitMilliseconds = 0.0;
+};
+
+// Mirrors the std140 CameraBlock uniform block declared in the shaders.
+// Only mat4/vec4 members, so the C++ layout matches std140 without padding.
+struct CameraBlock
+{
+	glm::mat4 projection;
+	glm::mat4 view;
+	glm::mat4 projectionView;
+	glm::vec4 cameraPosition;
+};
 
 class Renderer
 {
 public:
+	RenderStats stats;
+
 	Renderer();
 
-	void render(Entity& entity, Shader& shader, Camera& camera, Display& display);
-	void prepare();
-};
\ No newline at end of file
+	// Shaders with an instanceTransform attribute (location 2) get the transform through the
+	// stream buffer, any others through the "transform" uniform
+	void render(Entity& entity, Shader& shader);
+	// Groups the entities by Model and LOD and draws each group with a single instanced draw call.
+	// The shader must read its transform from the per-instance attribute at location 2.
+	void renderInstanced(const std::vector<Entity>& entities, Shader& shader);
+	// Same, but only draws entities[i] for each i in visible (e.g. the output of FrustumCuller)
+	void renderInstanced(const std::vector<Entity>& entities, const std::vector<uint32_t>& visible, Shader& shader);
+	// Draws a sorted queue, only binding state that differs from the previous packet.
+	// Transforms are passed like in render().
+	void submit(const RenderQueue& queue);
+	// Draws what ClusterCuller left, one glMultiDrawElementsIndirect per batch.
+	// The shader must read its transform from the per-instance attribute at location 2.
+	void submit(const ClusterDrawList& drawList, Shader& shader);
+	// Clears the screen and uploads this frame's camera block
+	void prepare(Camera& camera, Display& display);
+	// Call after the frame's last draw, before swapping buffers
+	void finishFrame();
+
+	// Per-frame dynamic data can be streamed through here too, between prepare() and finishFrame()
+	StreamBuffer& getStreamBuffer() { return instanceStream; }
+
+private:
+	BufferHandle cameraBuffer;
+
+	// Room for 64k transforms per frame before the stream buffer has to grow
+	static const size_t STREAM_REGION_SIZE = 4 * 1024 * 1024;
+
+	// Per-instance transforms, streamed every frame
+	StreamBuffer instanceStream;
+	// The buffer the instance attributes in instancedVAOs point at
+	unsigned int instanceBufferID = 0;
+
+	// Entities drawn with the same model and level of detail
+	struct InstanceBatch
+	{
+		Model* model;
+		unsigned int lod;
+		std::vector<glm::mat4> transforms;
+	};
+
+	// Keyed by the LOD's pool geometry, the VAO is shared between models.
+	// Reused between frames so batching doesn't allocate once warmed up.
+	std::unordered_map<GeometryHandle, InstanceBatch> batches;
+	// Pool VAOs that already have the instance attributes attached
+	std::unordered_set<unsigned int> instancedVAOs;
+
+	// Whether the last shader asked about reads instanceTransform instead of a uniform
+	bool transformIsAttribute = false;
+
+	void enableInstanceAttributes(unsigned int VAO_ID);
+	// Room for count transforms in this frame's stream region. baseInstance is the first one's
+	// instance index, to pass to glDrawElementsInstancedBaseVertexBaseInstance.
+	glm::mat4* allocateTransforms(size_t count, unsigned int& baseInstance);
+	void addToBatch(const Entity& entity);
+	// Uploads the batches and draws them, shared by both renderInstanced overloads
+	void drawBatches(size_t instanceCount, Shader& shader);
+	int getTransformLocation(Shader& shader);
+};
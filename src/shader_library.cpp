@@ -0,0 +1,20 @@
+#include "shader_library.h"
+
+#include <algorithm>
+
+Shader& ShaderLibrary::get(const std::string& path, std::vector<std::string> defines)
+{
+	// Define order doesn't change the result, so it mustn't change the key either
+	std::sort(defines.begin(), defines.end());
+	defines.erase(std::unique(defines.begin(), defines.end()), defines.end());
+
+	std::string key = path;
+	for (const std::string& define : defines)
+		key += "|" + define;
+
+	std::unique_ptr<Shader>& variant = variants[key];
+	if (!variant)
+		variant = std::make_unique<Shader>(path, defines);
+
+	return *variant;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "shader_s.h"
+
+// Owns every compiled shader variant. A variant is a shader file plus a set of defines,
+// and is only compiled the first time it's asked for. Later requests for the same
+// variant (in any define order) return the same Shader.
+class ShaderLibrary
+{
+public:
+	Shader& get(const std::string& path, std::vector<std::string> defines = {});
+
+	// Number of variants compiled so far
+	size_t size() const { return variants.size(); }
+
+private:
+	std::unordered_map<std::string, std::unique_ptr<Shader>> variants;
+};
@@ -0,0 +1,124 @@
+#include "shader_preprocessor.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+#include "mapped_file.h"
+
+bool ShaderPreprocessor::process(const std::string& path, const std::vector<std::string>& defines, std::string& vertexSource, std::string& fragmentSource)
+{
+	vertexSource.clear();
+	fragmentSource.clear();
+
+	Context context;
+	context.defines = &defines;
+	context.sources[STAGE_VERTEX] = &vertexSource;
+	context.sources[STAGE_FRAGMENT] = &fragmentSource;
+
+	int stage = STAGE_NONE;
+	return processFile(path, context, stage, true);
+}
+
+bool ShaderPreprocessor::processFile(const std::string& path, Context& context, int& stage, bool topLevel)
+{
+	MappedFile file(path);
+	if (!file.isOpen())
+	{
+		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+		return false;
+	}
+
+	std::filesystem::path directory = std::filesystem::path(path).parent_path();
+
+	// Walk the mapped bytes line by line without copying anything but the output
+	std::string_view text(file.data(), file.size());
+	size_t lineStart = 0;
+	while (lineStart < text.size())
+	{
+		size_t lineEnd = text.find('\n', lineStart);
+		if (lineEnd == std::string_view::npos)
+			lineEnd = text.size();
+
+		std::string_view line = text.substr(lineStart, lineEnd - lineStart);
+		lineStart = lineEnd + 1;
+		if (!line.empty() && line.back() == '\r')
+			line.remove_suffix(1);
+
+		std::string_view directive = line.substr(std::min(line.find_first_not_of(" \t"), line.size()));
+
+		if (startsWith(directive, "#shader"))
+		{
+			if (!topLevel)
+			{
+				std::cout << "ERROR::SHADER::#shader is not allowed in included file " << path << std::endl;
+				return false;
+			}
+
+			if (directive.find("vertex") != std::string_view::npos)
+				stage = STAGE_VERTEX;
+			else if (directive.find("fragment") != std::string_view::npos)
+				stage = STAGE_FRAGMENT;
+			continue;
+		}
+
+		// Anything before the first #shader line has nowhere to go
+		if (stage == STAGE_NONE)
+			continue;
+
+		std::string& source = *context.sources[stage];
+
+		if (startsWith(directive, "#include"))
+		{
+			size_t open = directive.find('"');
+			size_t close = open == std::string_view::npos ? open : directive.find('"', open + 1);
+			if (close == std::string_view::npos)
+			{
+				std::cout << "ERROR::SHADER::Malformed #include in " << path << ": " << line << std::endl;
+				return false;
+			}
+
+			std::filesystem::path includePath = directory / std::string(directive.substr(open + 1, close - open - 1));
+			std::error_code error;
+			std::string canonical = std::filesystem::weakly_canonical(includePath, error).string();
+			if (error)
+				canonical = includePath.string();
+
+			// Include once per stage, which also stops include cycles
+			if (context.included[stage].insert(canonical).second)
+			{
+				if (!processFile(canonical, context, stage, false))
+					return false;
+			}
+			continue;
+		}
+
+		source.append(line.data(), line.size());
+		source += '\n';
+
+		// Defines have to come after #version, which must be the first statement
+		if (startsWith(directive, "#version"))
+			appendDefines(context, source);
+	}
+
+	return true;
+}
+
+void ShaderPreprocessor::appendDefines(const Context& context, std::string& source)
+{
+	for (const std::string& define : *context.defines)
+	{
+		size_t equals = define.find('=');
+		source += "#define ";
+		if (equals == std::string::npos)
+			source += define;
+		else
+			source += define.substr(0, equals) + " " + define.substr(equals + 1);
+		source += '\n';
+	}
+}
+
+bool ShaderPreprocessor::startsWith(std::string_view text, std::string_view prefix)
+{
+	return text.substr(0, prefix.size()) == prefix;
+}
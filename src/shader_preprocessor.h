@@ -0,0 +1,37 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_set>
+
+// Turns a combined shader file into per-stage GLSL.
+// Supported directives, each on its own line:
+//   #shader vertex / #shader fragment   - starts a stage (top-level file only)
+//   #include "path"                      - pasted in place, relative to the including file.
+//                                          A file is only included once per stage.
+// Defines ("NAME" or "NAME=VALUE") are injected right after each stage's #version line,
+// so the same file can be compiled into feature variants with #ifdef.
+class ShaderPreprocessor
+{
+public:
+	static bool process(const std::string& path, const std::vector<std::string>& defines, std::string& vertexSource, std::string& fragmentSource);
+
+private:
+	enum Stage
+	{
+		STAGE_NONE = -1, STAGE_VERTEX = 0, STAGE_FRAGMENT = 1, STAGE_COUNT = 2
+	};
+
+	struct Context
+	{
+		const std::vector<std::string>* defines;
+		std::string* sources[STAGE_COUNT];
+		// Canonical paths already pasted into each stage
+		std::unordered_set<std::string> included[STAGE_COUNT];
+	};
+
+	// Appends the file to the current stage's source. stage is updated by #shader lines.
+	static bool processFile(const std::string& path, Context& context, int& stage, bool topLevel);
+	static void appendDefines(const Context& context, std::string& source);
+	static bool startsWith(std::string_view text, std::string_view prefix);
+};
@@ -3,21 +3,30 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <chrono>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "gl_state.h"
+#include "program_cache.h"
+#include "shader_preprocessor.h"
 
 
 Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath)
 {
-    parseShaders(vertexPath, fragmentPath);
-    createProgram();
+    if (parseShaders(vertexPath, fragmentPath))
+        createProgram();
 }
 
-Shader::Shader(const std::string& vertexFragPath)
+Shader::Shader(const std::string& vertexFragPath, const std::vector<std::string>& defines)
 {
-    parseShaders(vertexFragPath);
-    createProgram();
+    // No point compiling half a source, ID stays 0 and the errors are already out
+    if (parseShaders(vertexFragPath, defines))
+        createProgram();
 }
 
-void Shader::parseShaders(const std::string& vertexPath, const std::string& fragmentPath)
+bool Shader::parseShaders(const std::string& vertexPath, const std::string& fragmentPath)
 {
     // 1. retrieve the vertex/fragment source code from filePath
     std::ifstream vShaderFile;
@@ -44,42 +53,19 @@ void Shader::parseShaders(const std::string& vertexPath, const std::string& frag
     catch (std::ifstream::failure& e)
     {
         std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+        return false;
     }
+    return true;
 }
 
-void Shader::parseShaders(const std::string& vertexFragPath)
+bool Shader::parseShaders(const std::string& vertexFragPath, const std::vector<std::string>& defines)
 {
-    std::ifstream stream(vertexFragPath);
-
-    enum class ShaderType
-    {
-        None = -1, VERTEX = 0, FRAGMENT = 1
-    };
-
-    std::string line;
-    std::stringstream ss[2];
-    ShaderType type = ShaderType::None;
-    while (std::getline(stream, line))
+    if (!ShaderPreprocessor::process(vertexFragPath, defines, VertexSource, FragmentSource))
     {
-        if (line.find("#shader") != std::string::npos)
-        {
-            if (line.find("vertex") != std::string::npos)
-            {
-                type = ShaderType::VERTEX;
-            }
-            else if (line.find("fragment") != std::string::npos)
-            {
-                type = ShaderType::FRAGMENT;
-            }
-        }
-        else
-        {
-            ss[(int)type] << line << "\n";
-        }
+        std::cout << "ERROR::SHADER::PREPROCESS: " << vertexFragPath << std::endl;
+        return false;
     }
-
-    VertexSource = ss[0].str();
-    FragmentSource = ss[1].str();
+    return true;
 }
 
 unsigned int Shader::compileShader(unsigned int type, const std::string& source)
@@ -100,21 +86,57 @@ unsigned int Shader::compileShader(unsigned int type, const std::string& source)
 
 void Shader::createProgram()
 {
-    ID = glCreateProgram();
-    unsigned int vs = compileShader(GL_VERTEX_SHADER, VertexSource);
-    unsigned int fs = compileShader(GL_FRAGMENT_SHADER, FragmentSource);
+    auto start = std::chrono::steady_clock::now();
+
+    program = ProgramHandle::create("Shader");
+    ID = program.get();
+
+    // A cached binary from an earlier launch skips compiling and linking entirely
+    bool cached = ProgramCache::load(ID, VertexSource, FragmentSource);
+    if (!cached)
+    {
+        unsigned int vs = compileShader(GL_VERTEX_SHADER, VertexSource);
+        unsigned int fs = compileShader(GL_FRAGMENT_SHADER, FragmentSource);
+
+        // This combines the individual shaders into one shader program
+        glAttachShader(ID, vs);
+        glAttachShader(ID, fs);
+        // Ask the driver to keep the binary around so we can cache it
+        glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(ID);
+
+        checkCompileErrors(ID, "PROGRAM");
+        //glValidateProgram(ID);
+
+        int success = 0;
+        glGetProgramiv(ID, GL_LINK_STATUS, &success);
+        if (success)
+            ProgramCache::store(ID, VertexSource, FragmentSource);
+
+        // Delete intermediates now that we're done
+        glDeleteShader(vs);
+        glDeleteShader(fs);
+    }
 
-    // This combines the individual shaders into one shader program
-    glAttachShader(ID, vs);
-    glAttachShader(ID, fs);
-    glLinkProgram(ID);
+    reflect();
 
-    checkCompileErrors(ID, "PROGRAM");
-    //glValidateProgram(ID);
+    // GLSL 330 can't pick a block binding in the source, so do it here.
+    // This isn't part of the program binary, so it's needed on cache hits too.
+    auto cameraBlock = uniformBlocks.find("CameraBlock");
+    if (cameraBlock != uniformBlocks.end())
+        glUniformBlockBinding(ID, cameraBlock->second.location, CAMERA_BLOCK_BINDING);
 
-    // Delete intermediates now that we're done
-    glDeleteShader(vs);
-    glDeleteShader(fs);
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (cached)
+    {
+        ProgramCache::stats.hits++;
+        ProgramCache::stats.hitMilliseconds += milliseconds;
+    }
+    else
+    {
+        ProgramCache::stats.misses++;
+        ProgramCache::stats.missMilliseconds += milliseconds;
+    }
 }
 
 void Shader::checkCompileErrors(unsigned int shader, std::string type)
@@ -142,47 +164,175 @@ void Shader::checkCompileErrors(unsigned int shader, std::string type)
     }
 }
 
+void Shader::reflect()
+{
+    uniforms.clear();
+    attributes.clear();
+    uniformBlocks.clear();
+
+    int maxNameLength = 0;
+    int count = 0;
+    std::vector<char> name;
+
+    // Uniforms. Members of uniform blocks are reported too, but have no location of their own.
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    name.resize(maxNameLength + 1);
+    for (int i = 0; i < count; i++)
+    {
+        int length = 0;
+        ShaderVariable variable;
+        glGetActiveUniform(ID, i, (int)name.size(), &length, &variable.size, &variable.type, name.data());
+        variable.location = glGetUniformLocation(ID, name.data());
+        if (variable.location == -1)
+            continue;
+
+        std::string uniformName(name.data(), length);
+        // Arrays are reported as "name[0]", make them reachable as plain "name" too
+        if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+            uniforms[uniformName.substr(0, uniformName.size() - 3)] = variable;
+        uniforms[uniformName] = variable;
+    }
+
+    // Vertex attributes
+    glGetProgramiv(ID, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxNameLength);
+    glGetProgramiv(ID, GL_ACTIVE_ATTRIBUTES, &count);
+    name.resize(maxNameLength + 1);
+    for (int i = 0; i < count; i++)
+    {
+        int length = 0;
+        ShaderVariable variable;
+        glGetActiveAttrib(ID, i, (int)name.size(), &length, &variable.size, &variable.type, name.data());
+        variable.location = glGetAttribLocation(ID, name.data());
+        attributes[std::string(name.data(), length)] = variable;
+    }
+
+    // Uniform blocks, located by their index
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxNameLength);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+    name.resize(maxNameLength + 1);
+    for (int i = 0; i < count; i++)
+    {
+        int length = 0;
+        ShaderVariable variable;
+        glGetActiveUniformBlockName(ID, i, (int)name.size(), &length, name.data());
+        glGetActiveUniformBlockiv(ID, i, GL_UNIFORM_BLOCK_DATA_SIZE, &variable.size);
+        variable.location = i;
+        variable.type = 0;
+        uniformBlocks[std::string(name.data(), length)] = variable;
+    }
+
+    transformIsAttribute = getAttributeLocation("instanceTransform") >= 0;
+    transformLocation = transformIsAttribute ? -1 : getUniformLocation("transform");
+}
+
+int Shader::getUniformLocation(const std::string& name) const
+{
+    return checkGetUniform(name);
+}
+
+int Shader::getAttributeLocation(const std::string& name) const
+{
+    auto it = attributes.find(name);
+    return it != attributes.end() ? it->second.location : -1;
+}
+
 int Shader::checkGetUniform(const std::string& name) const
 {
-    int location = glGetUniformLocation(ID, name.c_str());
-    if (location == -1)
+    auto it = uniforms.find(name);
+    if (it != uniforms.end())
+        return it->second.location;
+
+    if (reportedMissing.insert(name).second)
     {
         std::cout << "ERROR::Could not find uniform: " << name << std::endl;
     }
 
-    return location;
+    return -1;
 }
 
 void Shader::activate()
 {
-    glUseProgram(ID);
+    GLState::useProgram(ID);
 }
 void Shader::deactivate()
 {
-    glUseProgram(0);
+    GLState::useProgram(0);
 }
 void Shader::deleteShader()
 {
-    glDeleteProgram(ID);
+    program.reset();
+    ID = 0;
+    transformIsAttribute = false;
+    transformLocation = -1;
 }
 
 void Shader::setBool(const std::string& name, bool value) const
 {
-    glUniform1i(checkGetUniform(name.c_str()), (int)value);
+    glUniform1i(checkGetUniform(name), (int)value);
 }
 void Shader::setInt(const std::string& name, int value) const
 {
-    glUniform1i(checkGetUniform(name.c_str()), value);
+    glUniform1i(checkGetUniform(name), value);
 }
 void Shader::setFloat(const std::string& name, float value) const
 {
-    glUniform1f(checkGetUniform(name.c_str()), value);
+    glUniform1f(checkGetUniform(name), value);
 }
 void Shader::setVec4(const std::string& name, glm::vec4& value) const
 {
-    glUniform4f(checkGetUniform(name.c_str()), value.x, value.y, value.z, value.w);
+    glUniform4f(checkGetUniform(name), value.x, value.y, value.z, value.w);
+}
+void Shader::setMat4(const std::string& name, const glm::f32* value) const
+{
+    glUniformMatrix4fv(checkGetUniform(name), 1, GL_FALSE, value);
+}
+
+void Shader::setInt(int location, int value) const
+{
+    glUniform1i(location, value);
+}
+void Shader::setFloat(int location, float value) const
+{
+    glUniform1f(location, value);
+}
+void Shader::setVec2(int location, const glm::vec2& value) const
+{
+    glUniform2fv(location, 1, glm::value_ptr(value));
+}
+void Shader::setVec3(int location, const glm::vec3& value) const
+{
+    glUniform3fv(location, 1, glm::value_ptr(value));
+}
+void Shader::setVec4(int location, const glm::vec4& value) const
+{
+    glUniform4fv(location, 1, glm::value_ptr(value));
+}
+void Shader::setMat3(int location, const glm::mat3& value) const
+{
+    glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+}
+void Shader::setMat4(int location, const glm::mat4& value) const
+{
+    glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+}
+void Shader::setIntArray(int location, const int* values, int count) const
+{
+    glUniform1iv(location, count, values);
+}
+void Shader::setFloatArray(int location, const float* values, int count) const
+{
+    glUniform1fv(location, count, values);
+}
+void Shader::setVec3Array(int location, const glm::vec3* values, int count) const
+{
+    glUniform3fv(location, count, glm::value_ptr(values[0]));
+}
+void Shader::setVec4Array(int location, const glm::vec4* values, int count) const
+{
+    glUniform4fv(location, count, glm::value_ptr(values[0]));
 }
-void Shader::setMat4(const std::string& name, glm::f32* value) const
+void Shader::setMat4Array(int location, const glm::mat4* values, int count) const
 {
-    glUniformMatrix4fv(checkGetUniform(name.c_str()), 1, GL_FALSE, value);
+    glUniformMatrix4fv(location, count, GL_FALSE, glm::value_ptr(values[0]));
 }
\ No newline at end of file
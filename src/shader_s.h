@@ -3,46 +3,108 @@
 
 #include <string>
 #include <array>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <glm/glm.hpp>
 
+#include "gpu_resources.h"
+
+// What the linker reported about an active uniform, attribute or uniform block
+struct ShaderVariable
+{
+	// Uniform/attribute location, or the block index for uniform blocks
+	int location;
+	// GL type enum (GL_FLOAT_MAT4...), 0 for uniform blocks
+	GLenum type;
+	// Array length for arrays, 1 otherwise. For blocks, the data size in bytes
+	int size;
+};
 
 class Shader
 {
 public:
-	// OpenGL program ID
-	unsigned int ID;
+	// OpenGL program ID, 0 if the sources couldn't be read
+	unsigned int ID = 0;
+
+	// Uniform buffer binding point of the per-frame CameraBlock.
+	// Any program declaring the block gets it bound here when linked.
+	static const unsigned int CAMERA_BLOCK_BINDING = 0;
 
 	// Constructor reads and builds the shaders
 	Shader(const std::string& vertexPath, const std::string& fragmentPath);
 	// Combined shaders - use #shader vertex and #shader fragment
-	// as the delimeter.
-	Shader(const std::string& vertexFragPath);
+	// as the delimeter. #include is supported, and each define
+	// ("NAME" or "NAME=VALUE") is added after #version in both stages.
+	// See ShaderPreprocessor.
+	Shader(const std::string& vertexFragPath, const std::vector<std::string>& defines = {});
 
 	// Activates the shader
 	void activate();
 	void deactivate();
 
+	// Releases the program early, otherwise that happens when the Shader is destroyed
 	void deleteShader();
-	// Utility functions to set uniforms
+
+	// Everything active in the program, filled in right after linking
+	std::unordered_map<std::string, ShaderVariable> uniforms;
+	std::unordered_map<std::string, ShaderVariable> attributes;
+	std::unordered_map<std::string, ShaderVariable> uniformBlocks;
+
+	// Where draws put the model transform, resolved with the rest of the reflection data:
+	// the per-instance "instanceTransform" attribute if the program has one, else the
+	// "transform" uniform. Lives here rather than in a cache keyed by program ID, since a
+	// deleted program's ID gets handed out again.
+	bool transformIsAttribute = false;
+	int transformLocation = -1;
+
+	// Resolves a uniform from the reflection data without asking the driver.
+	// Look handles up once at setup and pass them to the setters below on the hot path.
+	// Returns -1 (which glUniform* silently ignores) if the uniform isn't active.
+	int getUniformLocation(const std::string& name) const;
+	int getAttributeLocation(const std::string& name) const;
+
+	// Utility functions to set uniforms by name
 	void setBool(const std::string& name, bool value) const;
 	void setInt(const std::string& name, int value) const;
 	void setFloat(const std::string& name, float value) const;
 	void setVec4(const std::string& name, glm::vec4& value) const;
-	void setMat4(const std::string& name, glm::f32* value) const;
+	void setMat4(const std::string& name, const glm::f32* value) const;
+
+	// Setters taking a handle from getUniformLocation. These expect the shader to be active.
+	void setInt(int location, int value) const;
+	void setFloat(int location, float value) const;
+	void setVec2(int location, const glm::vec2& value) const;
+	void setVec3(int location, const glm::vec3& value) const;
+	void setVec4(int location, const glm::vec4& value) const;
+	void setMat3(int location, const glm::mat3& value) const;
+	void setMat4(int location, const glm::mat4& value) const;
+	void setIntArray(int location, const int* values, int count) const;
+	void setFloatArray(int location, const float* values, int count) const;
+	void setVec3Array(int location, const glm::vec3* values, int count) const;
+	void setVec4Array(int location, const glm::vec4* values, int count) const;
+	void setMat4Array(int location, const glm::mat4* values, int count) const;
 
 private:
+	ProgramHandle program;
+
 	std::string VertexSource;
 	std::string FragmentSource;
 
-	// Parses the shader source files to strings
-	void parseShaders(const std::string& vertexPath, const std::string& fragmentPath);
-	void parseShaders(const std::string& filePath);
+	// Parses the shader source files to strings, false if that failed
+	bool parseShaders(const std::string& vertexPath, const std::string& fragmentPath);
+	bool parseShaders(const std::string& filePath, const std::vector<std::string>& defines);
 
 	unsigned int compileShader(unsigned int type, const std::string& source);
 	// Check for shader compilation/linking errors and log to cout ifa ny
 	void checkCompileErrors(unsigned int shader, std::string type);
 
+	// Names we already complained about, so a missing uniform is logged once rather than every frame
+	mutable std::unordered_set<std::string> reportedMissing;
+
 	void createProgram();
+	// Queries all active uniforms, attributes and uniform blocks after linking
+	void reflect();
 	int checkGetUniform(const std::string& name) const;
 };
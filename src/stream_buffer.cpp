@@ -0,0 +1,103 @@
+#include "stream_buffer.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "gl_state.h"
+
+StreamBuffer::StreamBuffer(GLenum pTarget, size_t pRegionSize)
+	: target(pTarget), regionSize(pRegionSize)
+{
+	create();
+}
+
+StreamBuffer::~StreamBuffer()
+{
+	// The context and everything in it is already gone
+	if (GpuResources::isShutDown())
+		return;
+	for (int i = 0; i < REGION_COUNT; i++)
+	{
+		if (fences[i])
+			glDeleteSync(fences[i]);
+	}
+	GLState::bindBuffer(target, buffer.get());
+	glUnmapBuffer(target);
+}
+
+void StreamBuffer::create()
+{
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	buffer = BufferHandle::create("StreamBuffer");
+	GLState::bindBuffer(target, buffer.get());
+	// Immutable storage is what allows it to stay mapped while the GPU reads from it
+	glBufferStorage(target, regionSize * REGION_COUNT, nullptr, flags);
+	buffer.setMemory(regionSize * REGION_COUNT);
+	mapped = (unsigned char*)glMapBufferRange(target, 0, regionSize * REGION_COUNT, flags);
+}
+
+void StreamBuffer::waitForFence(int fenceRegion)
+{
+	if (!fences[fenceRegion])
+		return;
+
+	auto start = std::chrono::steady_clock::now();
+	// Usually already signaled, the GPU is only a frame or two behind
+	GLenum result = glClientWaitSync(fences[fenceRegion], 0, 0);
+	while (result == GL_TIMEOUT_EXPIRED)
+		result = glClientWaitSync(fences[fenceRegion], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+	glDeleteSync(fences[fenceRegion]);
+	fences[fenceRegion] = nullptr;
+	stats.fenceWaitMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void StreamBuffer::beginFrame()
+{
+	stats = Stats();
+	region = (region + 1) % REGION_COUNT;
+	used = 0;
+	waitForFence(region);
+}
+
+void StreamBuffer::endFrame()
+{
+	if (fences[region])
+		glDeleteSync(fences[region]);
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void* StreamBuffer::allocate(size_t size, size_t alignment, size_t& offset)
+{
+	size_t aligned = (used + alignment - 1) / alignment * alignment;
+	if (aligned + size > regionSize)
+	{
+		grow(aligned + size);
+		aligned = 0;
+	}
+
+	offset = region * regionSize + aligned;
+	used = aligned + size;
+	stats.bytesStreamed += size;
+	return mapped + offset;
+}
+
+void StreamBuffer::grow(size_t minimumRegionSize)
+{
+	// Draws already issued this frame keep reading the old buffer, its deletion is deferred
+	// until they're done. The new buffer isn't used by anything yet, so the fences can go.
+	for (int i = 0; i < REGION_COUNT; i++)
+	{
+		if (fences[i])
+			glDeleteSync(fences[i]);
+		fences[i] = nullptr;
+	}
+	GLState::bindBuffer(target, buffer.get());
+	glUnmapBuffer(target);
+
+	while (regionSize < minimumRegionSize)
+		regionSize *= 2;
+	create();
+	region = 0;
+	used = 0;
+	stats.grows++;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <glad/glad.h>
+
+#include <cstddef>
+
+#include "gpu_resources.h"
+
+// Ring buffer for data that's rewritten every frame (instance transforms, dynamic vertices...).
+// The storage is created once with glBufferStorage and stays mapped, so writing is a plain
+// memcpy with no glBufferSubData or orphaning. It's split into REGION_COUNT regions, one per
+// frame in flight. Each frame writes to its own region, and a fence placed at the end of
+// the frame stops the CPU from writing that region again before the GPU has read it.
+class StreamBuffer
+{
+public:
+	struct Stats
+	{
+		size_t bytesStreamed = 0;
+		double fenceWaitMilliseconds = 0.0;
+		// Times the buffer had to be reallocated because a frame didn't fit
+		unsigned int grows = 0;
+	};
+
+	static const int REGION_COUNT = 3;
+
+	// Reset by beginFrame
+	Stats stats;
+
+	StreamBuffer(GLenum target, size_t regionSize);
+	~StreamBuffer();
+
+	StreamBuffer(const StreamBuffer&) = delete;
+	StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+	// Moves on to the next region, waiting for the GPU if it's still reading it
+	void beginFrame();
+	// Fences the current region, call after the frame's last draw that reads from it
+	void endFrame();
+
+	// Reserves size bytes in this frame's region and returns where to write them.
+	// offset receives the position in the buffer, a multiple of alignment.
+	// A frame that runs out of room makes the buffer grow, which changes getBufferID():
+	// anything that captured the old buffer (like VAO attribute pointers) must be set up again.
+	void* allocate(size_t size, size_t alignment, size_t& offset);
+
+	unsigned int getBufferID() const { return buffer.get(); }
+	size_t getRegionSize() const { return regionSize; }
+
+private:
+	GLenum target;
+	BufferHandle buffer;
+	unsigned char* mapped = nullptr;
+	size_t regionSize;
+
+	int region = 0;
+	// Bytes used in the current region
+	size_t used = 0;
+	GLsync fences[REGION_COUNT] = {};
+
+	void create();
+	void waitForFence(int fenceRegion);
+	void grow(size_t minimumRegionSize);
+};
@@ -0,0 +1,83 @@
+#include "systems.h"
+
+#include <cmath>
+
+#include "components.h"
+
+void AnimationSystem::update(World& world, float time)
+{
+	world.eachChunk<Spin, Rotation>([time](size_t count, Spin* spins, Rotation* rotations)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				float halfAngle = glm::radians(time * spins[i].degreesPerSecond) * 0.5f;
+				glm::quat aboutZ(std::cos(halfAngle), 0.0f, 0.0f, std::sin(halfAngle));
+				rotations[i].value = aboutZ * spins[i].base;
+			}
+		});
+}
+
+void TransformSystem::update(World& world)
+{
+	// Bounds in the same pass while the matrix is still in registers, instead of reading it back
+	world.eachChunk<Position, Rotation, Scale, LocalBounds, LocalToWorld, WorldBounds>(
+		[](size_t count, Position* positions, Rotation* rotations, Scale* scales, LocalBounds* localBounds, LocalToWorld* transforms, WorldBounds* worldBounds)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				glm::mat4 transform = composeTransform(positions[i].value, rotations[i].value, scales[i].value);
+				transforms[i].value = transform;
+				worldBounds[i].value = localBounds[i].value.transformed(transform);
+			}
+		});
+	world.eachChunk<Position, Rotation, Scale, LocalToWorld>([](size_t count, Position* positions, Rotation* rotations, Scale* scales, LocalToWorld* transforms)
+		{
+			for (size_t i = 0; i < count; i++)
+				transforms[i].value = composeTransform(positions[i].value, rotations[i].value, scales[i].value);
+		}, World::maskOf<LocalBounds>());
+}
+
+// Both walk the renderables in the same order: everything but the occluders, then the occluders
+void RenderExtractionSystem::extract(World& world, RenderList& list)
+{
+	list.entities.clear();
+	list.bounds.clear();
+	list.occluders.clear();
+	auto append = [&](size_t count, Renderable* renderables, LocalToWorld* transforms, WorldBounds* bounds, Scale* scales, LodLevel* lods)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			Entity entity;
+			entity.model = renderables[i].model;
+			entity.transform = transforms[i].value;
+			entity.position = glm::vec3(transforms[i].value[3]);
+			entity.scale = scales[i].value;
+			entity.lod = lods[i].level;
+			list.entities.push_back(entity);
+			list.bounds.push_back(bounds[i].value);
+		}
+	};
+	world.eachChunk<Renderable, LocalToWorld, WorldBounds, Scale, LodLevel>(append, World::maskOf<Occluder>());
+	size_t firstOccluder = list.entities.size();
+	world.eachChunk<Occluder, Renderable, LocalToWorld, WorldBounds, Scale, LodLevel>(
+		[&](size_t count, Occluder*, Renderable* renderables, LocalToWorld* transforms, WorldBounds* bounds, Scale* scales, LodLevel* lods)
+		{
+			append(count, renderables, transforms, bounds, scales, lods);
+		});
+	for (size_t i = firstOccluder; i < list.entities.size(); i++)
+		list.occluders.push_back((uint32_t)i);
+}
+
+void RenderExtractionSystem::writeBackLods(World& world, const RenderList& list)
+{
+	size_t next = 0;
+	auto store = [&](size_t count, LodLevel* lods)
+	{
+		for (size_t i = 0; i < count && next < list.entities.size(); i++)
+			lods[i].level = list.entities[next++].lod;
+	};
+	world.eachChunk<Renderable, LocalToWorld, WorldBounds, Scale, LodLevel>(
+		[&](size_t count, Renderable*, LocalToWorld*, WorldBounds*, Scale*, LodLevel* lods) { store(count, lods); }, World::maskOf<Occluder>());
+	world.eachChunk<Occluder, Renderable, LocalToWorld, WorldBounds, Scale, LodLevel>(
+		[&](size_t count, Occluder*, Renderable*, LocalToWorld*, WorldBounds*, Scale*, LodLevel* lods) { store(count, lods); });
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "aabb.h"
+#include "entity.h"
+#include "world.h"
+
+// The per-frame passes over the World, run in this order before culling. Each one is a
+// query streaming through the chunks of the archetypes that have its components.
+
+// Sets Rotation from Spin
+class AnimationSystem
+{
+public:
+	static void update(World& world, float time);
+};
+
+// Position, Rotation and Scale into LocalToWorld, then LocalBounds through it into WorldBounds
+class TransformSystem
+{
+public:
+	static void update(World& world);
+};
+
+// What culling, LOD selection and the renderers work on for one frame. The three are
+// indexed the same way, visible lists from the cullers index into them.
+struct RenderList
+{
+	std::vector<Entity> entities;
+	std::vector<AABB> bounds;
+	// Indices of the entities tagged Occluder
+	std::vector<uint32_t> occluders;
+};
+
+// Copies every renderable entity out of the World into a RenderList, occluders last
+class RenderExtractionSystem
+{
+public:
+	static void extract(World& world, RenderList& list);
+	// Stores the levels LodSelector picked back into LodLevel. The World's structure must not
+	// have changed since extract(), the order is how entities are matched up.
+	static void writeBackLods(World& world, const RenderList& list);
+};
@@ -3,11 +3,16 @@
 #include <iostream>
 
 #include "texture.h"
+#include "gl_state.h"
 
-Texture::Texture(std::string texturePath)
+Texture::Texture(std::string pTexturePath)
 {
-	glGenTextures(1, &textureID);
-	glBindTexture(GL_TEXTURE_2D, textureID);
+	texturePath = pTexturePath;
+
+	handle = TextureHandle::create("Texture");
+	textureID = handle.get();
+	resident = true;
+	GLState::bindTexture(0, GL_TEXTURE_2D, textureID);
     // Set texture wrapping/filtering options
     // on currently bound texture object.
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -16,11 +21,14 @@ Texture::Texture(std::string texturePath)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
     // Load and generate the texture
-    int width, height, nChannels;
-    unsigned char* data = stbi_load(texturePath.c_str(), &width, &height, &nChannels, 0);
+    unsigned char* data = stbi_load(texturePath.c_str(), &width, &height, &channels, 0);
     if (data)
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+        // Rows of RGB images aren't necessarily 4 byte aligned
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        unsigned int format = formatForChannels(channels);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
         glGenerateMipmap(GL_TEXTURE_2D);
     }
     else
@@ -28,4 +36,35 @@ Texture::Texture(std::string texturePath)
         std::cout << "Failed to load texture" << std::endl;
     }
     stbi_image_free(data);
+    handle.setMemory(memoryBytes());
+}
+
+void Texture::adopt(TextureHandle pHandle, int pWidth, int pHeight, int pChannels)
+{
+    handle = std::move(pHandle);
+    textureID = handle.get();
+    width = pWidth;
+    height = pHeight;
+    channels = pChannels;
+    resident = true;
+    handle.setMemory(memoryBytes());
+}
+
+size_t Texture::memoryBytes() const
+{
+    if (!resident)
+        return 0;
+    // A full mip chain adds a third on top of the base level
+    return (size_t)width * height * channels * 4 / 3;
+}
+
+unsigned int Texture::formatForChannels(int channels)
+{
+    switch (channels)
+    {
+    case 1: return GL_RED;
+    case 2: return GL_RG;
+    case 4: return GL_RGBA;
+    default: return GL_RGB;
+    }
 }
@@ -1,13 +1,38 @@
 #pragma once
 #include <string>
 
+#include "gpu_resources.h"
+
 class Texture
 {
 public:
-	unsigned int textureID;
+	unsigned int textureID = 0;
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	// True once textureID is a GL texture owned by this object (and not e.g. a shared placeholder)
+	bool resident = false;
 
+	// Loads and uploads the image right away, on the calling (GL) thread
 	Texture(std::string texturePath);
+	// Empty texture, to be filled in later (see TextureLoader)
+	Texture() = default;
+
+	// Owns a GL object, so it must not be copied. Share it through a shared_ptr instead.
+	Texture(const Texture&) = delete;
+	Texture& operator=(const Texture&) = delete;
+
+	// Takes over a texture uploaded elsewhere, replacing whatever was shown until now
+	void adopt(TextureHandle handle, int width, int height, int channels);
+
+	// Approximate GPU memory used, including the mip chain
+	size_t memoryBytes() const;
+
+	// GL pixel format for an image with this many 8-bit channels
+	static unsigned int formatForChannels(int channels);
 
 private:
 	std::string texturePath;
-};
\ No newline at end of file
+	// Empty while textureID is someone else's (a placeholder)
+	TextureHandle handle;
+};
@@ -0,0 +1,154 @@
+#include "texture_loader.h"
+
+#include <glad/glad.h>
+#include <stb_image/stb_image.h>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include "gl_state.h"
+
+TextureLoader::TextureLoader(ThreadPool& pThreadPool)
+	: threadPool(pThreadPool)
+{
+	// Grey/magenta checkerboard shown until the real image is resident
+	const unsigned char checker[] = {
+		128, 128, 128, 255,   255, 0, 255, 255,
+		255, 0, 255, 255,     128, 128, 128, 255
+	};
+	placeholder = TextureHandle::create("TextureLoader");
+	GLState::bindTexture(0, GL_TEXTURE_2D, placeholder.get());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, checker);
+	placeholder.setMemory(sizeof(checker));
+
+	for (BufferHandle& pbo : pbos)
+		pbo = BufferHandle::create("TextureLoader");
+}
+
+TextureLoader::~TextureLoader()
+{
+	// Decode jobs hold a pointer to us
+	std::unique_lock<std::mutex> lock(decodedMutex);
+	decodeFinished.wait(lock, [this]() { return decoding == 0; });
+
+	for (DecodedImage& image : decoded)
+		stbi_image_free(image.pixels);
+}
+
+std::shared_ptr<Texture> TextureLoader::load(const std::string& texturePath)
+{
+	auto texture = std::make_shared<Texture>();
+	texture->textureID = placeholder.get();
+
+	inFlight++;
+	stats.queued++;
+	{
+		std::lock_guard<std::mutex> lock(decodedMutex);
+		decoding++;
+	}
+
+	std::weak_ptr<Texture> weakTexture = texture;
+	threadPool.submit([this, weakTexture, texturePath]()
+	{
+		DecodedImage image;
+		image.texture = weakTexture;
+		image.path = texturePath;
+		image.pixels = stbi_load(texturePath.c_str(), &image.width, &image.height, &image.channels, 0);
+
+		std::lock_guard<std::mutex> lock(decodedMutex);
+		decoded.push_back(image);
+		decoding--;
+		// Still under the lock, or the destructor could wake up and free the condition variable first
+		decodeFinished.notify_one();
+	});
+
+	return texture;
+}
+
+void TextureLoader::update(double budgetMilliseconds)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	while (true)
+	{
+		DecodedImage image;
+		{
+			std::lock_guard<std::mutex> lock(decodedMutex);
+			if (decoded.empty())
+				break;
+			image = decoded.front();
+			decoded.pop_front();
+		}
+
+		if (!image.pixels)
+		{
+			std::cout << "Failed to load texture: " << image.path << std::endl;
+			stats.failed++;
+		}
+		else
+		{
+			// Dropped while loading, don't bother uploading
+			if (!image.texture.expired())
+				upload(image);
+			stbi_image_free(image.pixels);
+		}
+		inFlight--;
+
+		double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (elapsed >= budgetMilliseconds)
+			break;
+	}
+}
+
+void TextureLoader::upload(DecodedImage& image)
+{
+	std::shared_ptr<Texture> texture = image.texture.lock();
+	if (!texture)
+		return;
+
+	long long size = (long long)image.width * image.height * image.channels;
+
+	// Copy the pixels into a PBO, the driver then transfers them to the texture
+	// asynchronously instead of blocking glTexImage2D on a client memory copy
+	GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[nextPBO].get());
+	if (size > pboSizes[nextPBO])
+	{
+		pboSizes[nextPBO] = size;
+		pbos[nextPBO].setMemory(size);
+	}
+	// Respecifying orphans the old storage if a previous upload is still reading from it
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, pboSizes[nextPBO], nullptr, GL_STREAM_DRAW);
+	void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (!mapped)
+	{
+		GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		stats.failed++;
+		return;
+	}
+	memcpy(mapped, image.pixels, size);
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	nextPBO = (nextPBO + 1) % PBO_COUNT;
+
+	TextureHandle handle = TextureHandle::create("Texture");
+	GLState::bindTexture(0, GL_TEXTURE_2D, handle.get());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// With a PBO bound, the data pointer is an offset into it
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	unsigned int format = Texture::formatForChannels(image.channels);
+	glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	// Everyone holding this texture sees the real image from the next bind on
+	texture->adopt(std::move(handle), image.width, image.height, image.channels);
+	stats.uploaded++;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "texture.h"
+#include "thread_pool.h"
+
+// Decodes images on the thread pool and uploads them on the GL thread a few at a time.
+// load() returns straight away with a texture showing a placeholder, and the same
+// Texture object gets its real textureID once update() has uploaded it.
+class TextureLoader
+{
+public:
+	struct Stats
+	{
+		unsigned int queued = 0;
+		unsigned int uploaded = 0;
+		unsigned int failed = 0;
+	};
+
+	Stats stats;
+
+	TextureLoader(ThreadPool& threadPool);
+	// Waits for decodes still running on the pool
+	~TextureLoader();
+
+	std::shared_ptr<Texture> load(const std::string& texturePath);
+
+	// Call once per frame on the GL thread. Uploads decoded images through pixel buffer
+	// objects until budgetMilliseconds is spent (at least one image per call, so a big
+	// image can't stall loading forever).
+	void update(double budgetMilliseconds);
+
+	// Images still being decoded or waiting for upload
+	unsigned int pending() const { return inFlight.load(); }
+
+	unsigned int getPlaceholderID() const { return placeholder.get(); }
+
+private:
+	struct DecodedImage
+	{
+		// Weak, so textures nobody uses anymore aren't uploaded
+		std::weak_ptr<Texture> texture;
+		std::string path;
+		unsigned char* pixels;
+		int width;
+		int height;
+		int channels;
+	};
+
+	ThreadPool& threadPool;
+
+	// Filled by the workers, drained by update()
+	std::mutex decodedMutex;
+	std::deque<DecodedImage> decoded;
+	// Jobs submitted but not yet in decoded, guarded by decodedMutex. The destructor waits on
+	// decodeFinished for this to reach 0.
+	unsigned int decoding = 0;
+	std::condition_variable decodeFinished;
+	std::atomic<unsigned int> inFlight{ 0 };
+
+	TextureHandle placeholder;
+
+	// Uploads rotate through a few PBOs so we never write into one the driver is still reading
+	static const int PBO_COUNT = 3;
+	BufferHandle pbos[PBO_COUNT];
+	long long pboSizes[PBO_COUNT] = {};
+	int nextPBO = 0;
+
+	void upload(DecodedImage& image);
+};
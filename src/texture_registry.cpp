@@ -0,0 +1,66 @@
+#include "texture_registry.h"
+
+#include <filesystem>
+#include <iostream>
+
+TextureRegistry::TextureRegistry(TextureLoader* pLoader)
+	: loader(pLoader)
+{
+}
+
+std::shared_ptr<Texture> TextureRegistry::acquire(const std::string& texturePath)
+{
+	std::string key = canonicalPath(texturePath);
+
+	std::weak_ptr<Texture>& entry = textures[key];
+	if (std::shared_ptr<Texture> texture = entry.lock())
+		return texture;
+
+	std::shared_ptr<Texture> texture = loader ? loader->load(key) : std::make_shared<Texture>(key);
+	entry = texture;
+	return texture;
+}
+
+size_t TextureRegistry::residentCount()
+{
+	prune();
+	return textures.size();
+}
+
+size_t TextureRegistry::residentBytes()
+{
+	size_t bytes = 0;
+	for (auto& entry : textures)
+	{
+		if (std::shared_ptr<Texture> texture = entry.second.lock())
+			bytes += texture->memoryBytes();
+	}
+	return bytes;
+}
+
+void TextureRegistry::printReport()
+{
+	std::cout << "Textures: " << residentCount() << " resident, "
+		<< residentBytes() / (1024.0 * 1024.0) << " MB" << std::endl;
+}
+
+void TextureRegistry::prune()
+{
+	for (auto it = textures.begin(); it != textures.end();)
+	{
+		if (it->second.expired())
+			it = textures.erase(it);
+		else
+			++it;
+	}
+}
+
+std::string TextureRegistry::canonicalPath(const std::string& texturePath)
+{
+	std::error_code error;
+	std::filesystem::path canonical = std::filesystem::weakly_canonical(texturePath, error);
+	if (error)
+		return texturePath;
+	// Forward slashes everywhere so the same file always maps to the same key
+	return canonical.generic_string();
+}
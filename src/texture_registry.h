@@ -0,0 +1,34 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "texture.h"
+#include "texture_loader.h"
+
+// Hands out one shared Texture per image file, so models using the same image
+// don't decode and upload it again. The registry only holds weak references:
+// once the last user drops its handle the Texture is destroyed and its GPU memory freed.
+class TextureRegistry
+{
+public:
+	// Without a loader, textures are loaded synchronously on first acquire
+	TextureRegistry(TextureLoader* loader = nullptr);
+
+	// Returns the texture for this file, loading it if nobody holds it right now.
+	// Different spellings of the same path ("a/../b.png", "b.png") share one texture.
+	std::shared_ptr<Texture> acquire(const std::string& texturePath);
+
+	// Live textures and the GPU memory they use
+	size_t residentCount();
+	size_t residentBytes();
+	void printReport();
+
+private:
+	TextureLoader* loader;
+	std::unordered_map<std::string, std::weak_ptr<Texture>> textures;
+
+	// Drops entries whose texture has been destroyed
+	void prune();
+	static std::string canonicalPath(const std::string& texturePath);
+};
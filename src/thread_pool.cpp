@@ -0,0 +1,110 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	if (threadCount == 0)
+	{
+		// hardware_concurrency() is 0 when it can't tell, don't let the - 1 wrap around
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	for (unsigned int i = 0; i < threadCount; i++)
+		workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	jobAvailable.notify_all();
+
+	// Workers drain whatever is still queued before exiting
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+void ThreadPool::submit(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(std::move(job));
+	}
+	jobAvailable.notify_one();
+}
+
+void ThreadPool::workerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+			if (jobs.empty())
+				return;
+
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		job();
+	}
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grainSize, const std::function<void(size_t begin, size_t end)>& function)
+{
+	if (count == 0)
+		return;
+
+	grainSize = std::max<size_t>(grainSize, 1);
+	size_t chunkCount = (count + grainSize - 1) / grainSize;
+	if (chunkCount == 1)
+	{
+		function(0, count);
+		return;
+	}
+
+	// Shared with the helper jobs, which can still be sitting in the queue after we return
+	struct State
+	{
+		std::atomic<size_t> nextChunk{ 0 };
+		std::atomic<size_t> chunksDone{ 0 };
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+	auto state = std::make_shared<State>();
+
+	// Everyone grabs chunks until there are none left.
+	// The function is only called while a chunk is claimed, and the caller waits for
+	// every claimed chunk to finish, so the reference stays valid for those calls.
+	const std::function<void(size_t, size_t)>* functionPtr = &function;
+	auto runChunks = [state, functionPtr, count, grainSize, chunkCount]()
+	{
+		size_t chunk;
+		while ((chunk = state->nextChunk.fetch_add(1)) < chunkCount)
+		{
+			size_t begin = chunk * grainSize;
+			(*functionPtr)(begin, std::min(begin + grainSize, count));
+			if (state->chunksDone.fetch_add(1) + 1 == chunkCount)
+			{
+				std::lock_guard<std::mutex> lock(state->mutex);
+				state->finished.notify_all();
+			}
+		}
+	};
+
+	size_t helpers = std::min<size_t>(workers.size(), chunkCount - 1);
+	for (size_t i = 0; i < helpers; i++)
+		submit(runChunks);
+
+	runChunks();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->finished.wait(lock, [&] { return state->chunksDone.load() == chunkCount; });
+}
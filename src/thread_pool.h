@@ -0,0 +1,39 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads pulling jobs off a shared queue.
+// Jobs must not touch OpenGL, the context only lives on the main thread.
+class ThreadPool
+{
+public:
+	// 0 picks one thread per hardware thread, minus one for the main thread
+	explicit ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Runs the job on a worker at some point, fire and forget
+	void submit(std::function<void()> job);
+
+	// Splits [0, count) into chunks of at most grainSize and runs function(begin, end)
+	// on each, spread over the workers and the calling thread. Returns once every chunk is done.
+	// Safe to call from inside a job, the caller always makes progress itself.
+	void parallelFor(size_t count, size_t grainSize, const std::function<void(size_t begin, size_t end)>& function);
+
+	unsigned int threadCount() const { return (unsigned int)workers.size(); }
+
+private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	bool stopping = false;
+
+	void workerLoop();
+};
@@ -0,0 +1,145 @@
+#include "vertex_format.h"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstring>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
+struct QuantizedVertex
+{
+	// x, y, z and padding, keeps the uv 4 byte aligned
+	uint16_t position[4];
+	uint32_t uv;
+};
+static_assert(sizeof(QuantizedVertex) == 12, "QuantizedVertex must match the attribute layout");
+
+unsigned int vertexStride(VertexFormat format)
+{
+	switch (format)
+	{
+	case VERTEX_FORMAT_POSITION_UV:
+		return sizeof(float) * 5;
+	case VERTEX_FORMAT_QUANTIZED:
+		return sizeof(QuantizedVertex);
+	default:
+		return 0;
+	}
+}
+
+void setupVertexAttributes(VertexFormat format)
+{
+	unsigned int stride = vertexStride(format);
+	switch (format)
+	{
+	case VERTEX_FORMAT_POSITION_UV:
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, 0);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * 3));
+		break;
+	case VERTEX_FORMAT_QUANTIZED:
+		// Normalized, so the vertex fetch already converts to floats in [0, 1]
+		glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, 0);
+		glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(QuantizedVertex, uv));
+		break;
+	default:
+		return;
+	}
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+}
+
+// Flat meshes have no extent along some axis, anything non-zero keeps the division finite
+static glm::vec3 quantizationExtent(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+	return glm::max(boundsMax - boundsMin, glm::vec3(1e-6f));
+}
+
+std::vector<unsigned char> encodeVertices(VertexFormat format, const std::vector<float>& positions, const std::vector<float>& uvs,
+	const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+	size_t vertexCount = positions.size() / 3;
+	std::vector<unsigned char> vertices(vertexCount * vertexStride(format));
+	glm::vec3 extent = quantizationExtent(boundsMin, boundsMax);
+
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		glm::vec3 position(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]);
+		glm::vec2 uv(0.0f);
+		if (i * 2 + 1 < uvs.size())
+			uv = glm::vec2(uvs[i * 2], uvs[i * 2 + 1]);
+
+		switch (format)
+		{
+		case VERTEX_FORMAT_POSITION_UV:
+		{
+			float* vertex = (float*)vertices.data() + i * 5;
+			std::memcpy(vertex, &position, sizeof(float) * 3);
+			std::memcpy(vertex + 3, &uv, sizeof(float) * 2);
+			break;
+		}
+		case VERTEX_FORMAT_QUANTIZED:
+		{
+			// packUnorm clamps, so positions a hair outside the bounds don't wrap around
+			QuantizedVertex vertex;
+			uint64_t packed = glm::packUnorm4x16(glm::vec4((position - boundsMin) / extent, 0.0f));
+			std::memcpy(vertex.position, &packed, sizeof(vertex.position));
+			// Half floats rather than unorm so tiling uvs outside [0, 1] still work
+			vertex.uv = glm::packHalf2x16(uv);
+			std::memcpy(vertices.data() + i * sizeof(QuantizedVertex), &vertex, sizeof(QuantizedVertex));
+			break;
+		}
+		default:
+			break;
+		}
+	}
+	return vertices;
+}
+
+void decodeVertices(VertexFormat format, const void* vertices, size_t vertexCount, const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+	std::vector<float>& positions, std::vector<float>& uvs)
+{
+	positions.resize(vertexCount * 3);
+	uvs.resize(vertexCount * 2);
+	const unsigned char* bytes = (const unsigned char*)vertices;
+	glm::vec3 extent = quantizationExtent(boundsMin, boundsMax);
+
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		glm::vec3 position(0.0f);
+		glm::vec2 uv(0.0f);
+		switch (format)
+		{
+		case VERTEX_FORMAT_POSITION_UV:
+		{
+			float vertex[5];
+			std::memcpy(vertex, bytes + i * sizeof(vertex), sizeof(vertex));
+			position = glm::vec3(vertex[0], vertex[1], vertex[2]);
+			uv = glm::vec2(vertex[3], vertex[4]);
+			break;
+		}
+		case VERTEX_FORMAT_QUANTIZED:
+		{
+			QuantizedVertex vertex;
+			std::memcpy(&vertex, bytes + i * sizeof(QuantizedVertex), sizeof(QuantizedVertex));
+			uint64_t packed;
+			std::memcpy(&packed, vertex.position, sizeof(packed));
+			position = boundsMin + glm::vec3(glm::unpackUnorm4x16(packed)) * extent;
+			uv = glm::unpackHalf2x16(vertex.uv);
+			break;
+		}
+		default:
+			break;
+		}
+		std::memcpy(&positions[i * 3], &position, sizeof(float) * 3);
+		std::memcpy(&uvs[i * 2], &uv, sizeof(float) * 2);
+	}
+}
+
+glm::mat4 positionDecodeMatrix(VertexFormat format, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+	if (format != VERTEX_FORMAT_QUANTIZED)
+		return glm::mat4(1.0f);
+	return glm::scale(glm::translate(glm::mat4(1.0f), boundsMin), quantizationExtent(boundsMin, boundsMax));
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// How a mesh's vertices are laid out in GPU memory. Attributes are interleaved, so one
+// vertex is one contiguous fetch, and always land at locations 0 (position) and 1 (uv).
+enum VertexFormat
+{
+	// Position as 3 floats, uv as 2 floats. 20 bytes.
+	VERTEX_FORMAT_POSITION_UV,
+	// Position as 3 normalized 16-bit integers across the mesh bounds (plus 2 bytes of padding),
+	// uv as 2 half floats. 12 bytes. The shader sees positions in [0, 1], multiplying by
+	// positionDecodeMatrix() maps them back to model space.
+	VERTEX_FORMAT_QUANTIZED,
+	VERTEX_FORMAT_COUNT
+};
+
+unsigned int vertexStride(VertexFormat format);
+// Points the attributes of the bound VAO at the bound GL_ARRAY_BUFFER
+void setupVertexAttributes(VertexFormat format);
+
+// Interleaves separate position (3 floats) and uv (2 floats) arrays into format.
+// boundsMin/boundsMax must contain every position, quantized formats are relative to them.
+std::vector<unsigned char> encodeVertices(VertexFormat format, const std::vector<float>& positions, const std::vector<float>& uvs,
+	const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+// The inverse of encodeVertices, for CPU copies of geometry that was stored encoded.
+// Quantized positions come back within a step (1/65535 of the bounds) of what went in.
+void decodeVertices(VertexFormat format, const void* vertices, size_t vertexCount, const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+	std::vector<float>& positions, std::vector<float>& uvs);
+// Maps positions as the shader reads them back to model space, identity for unquantized formats.
+// Renderers fold it into the model transform so no shader has to know the format.
+glm::mat4 positionDecodeMatrix(VertexFormat format, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
@@ -0,0 +1,177 @@
+#include "world.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+std::vector<size_t>& World::componentSizes()
+{
+	static std::vector<size_t> sizes;
+	return sizes;
+}
+
+unsigned int World::registerComponent(size_t size)
+{
+	std::vector<size_t>& sizes = componentSizes();
+	if (sizes.size() >= MAX_COMPONENT_TYPES)
+	{
+		// Nothing sensible to fall back to, every mask would be wrong from here on
+		std::cout << "ERROR::WORLD::TOO_MANY_COMPONENT_TYPES (max " << MAX_COMPONENT_TYPES << ")" << std::endl;
+		std::abort();
+	}
+	sizes.push_back(size);
+	return (unsigned int)sizes.size() - 1;
+}
+
+static size_t alignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+uint32_t World::findOrCreateArchetype(ComponentMask mask)
+{
+	auto found = archetypeLookup.find(mask);
+	if (found != archetypeLookup.end())
+		return found->second;
+
+	Archetype archetype;
+	archetype.mask = mask;
+	size_t rowSize = sizeof(EntityHandle);
+	for (unsigned int id = 0; id < MAX_COMPONENT_TYPES; id++)
+	{
+		if (mask & (ComponentMask(1) << id))
+		{
+			archetype.components.push_back(id);
+			archetype.sizes.push_back((uint32_t)componentSizes()[id]);
+			rowSize += componentSizes()[id];
+		}
+	}
+
+	// As many rows as fit once every array has been padded out to the column alignment
+	size_t padding = (archetype.components.size() + 1) * COLUMN_ALIGNMENT;
+	archetype.capacity = (uint32_t)std::max<size_t>(1, (CHUNK_SIZE - padding) / rowSize);
+	size_t offset = 0;
+	for (size_t i = 0; i < archetype.components.size(); i++)
+	{
+		archetype.offsets[archetype.components[i]] = (uint32_t)offset;
+		offset = alignUp(offset + archetype.sizes[i] * archetype.capacity, COLUMN_ALIGNMENT);
+	}
+	archetype.handleOffset = (uint32_t)offset;
+
+	archetypes.push_back(std::move(archetype));
+	uint32_t index = (uint32_t)archetypes.size() - 1;
+	archetypeLookup[mask] = index;
+	return index;
+}
+
+EntityHandle World::allocateHandle()
+{
+	EntityHandle entity;
+	if (!freeSlots.empty())
+	{
+		entity.index = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		entity.index = (uint32_t)slots.size();
+		slots.emplace_back();
+	}
+	entity.generation = slots[entity.index].generation;
+	aliveCount++;
+	return entity;
+}
+
+void World::allocateRow(uint32_t archetypeIndex, EntityHandle entity, uint32_t& chunkIndex, uint32_t& row)
+{
+	Archetype& archetype = archetypes[archetypeIndex];
+	if (archetype.chunks.empty() || archetype.chunks.back().count == archetype.capacity)
+	{
+		Chunk chunk;
+		// new[] aligns to at least 16 bytes, which is all the columns need
+		chunk.data.reset(new unsigned char[CHUNK_SIZE]);
+		archetype.chunks.push_back(std::move(chunk));
+	}
+	chunkIndex = (uint32_t)archetype.chunks.size() - 1;
+	Chunk& chunk = archetype.chunks.back();
+	row = chunk.count++;
+	handles(archetype, chunk)[row] = entity;
+}
+
+void World::removeRow(uint32_t archetypeIndex, uint32_t chunkIndex, uint32_t row)
+{
+	Archetype& archetype = archetypes[archetypeIndex];
+	Chunk& chunk = archetype.chunks[chunkIndex];
+	Chunk& last = archetype.chunks.back();
+	uint32_t lastRow = last.count - 1;
+	if (&chunk != &last || row != lastRow)
+	{
+		for (size_t i = 0; i < archetype.components.size(); i++)
+		{
+			uint32_t offset = archetype.offsets[archetype.components[i]];
+			size_t size = archetype.sizes[i];
+			std::memcpy(chunk.data.get() + offset + row * size, last.data.get() + offset + lastRow * size, size);
+		}
+		EntityHandle moved = handles(archetype, last)[lastRow];
+		handles(archetype, chunk)[row] = moved;
+		slots[moved.index].chunk = chunkIndex;
+		slots[moved.index].row = row;
+	}
+	if (--last.count == 0)
+		archetype.chunks.pop_back();
+}
+
+void World::moveToArchetype(EntityHandle entity, ComponentMask mask)
+{
+	Slot& slot = slots[entity.index];
+	uint32_t from = slot.archetype;
+	uint32_t fromChunk = slot.chunk;
+	uint32_t fromRow = slot.row;
+	// May add an archetype, so no references into the archetypes before this
+	uint32_t to = findOrCreateArchetype(mask);
+	uint32_t toChunk, toRow;
+	allocateRow(to, entity, toChunk, toRow);
+
+	Archetype& source = archetypes[from];
+	Archetype& destination = archetypes[to];
+	unsigned char* sourceData = source.chunks[fromChunk].data.get();
+	unsigned char* destinationData = destination.chunks[toChunk].data.get();
+	for (size_t i = 0; i < source.components.size(); i++)
+	{
+		unsigned int id = source.components[i];
+		if (!(mask & (ComponentMask(1) << id)))
+			continue;
+		size_t size = source.sizes[i];
+		std::memcpy(destinationData + destination.offsets[id] + toRow * size, sourceData + source.offsets[id] + fromRow * size, size);
+	}
+
+	removeRow(from, fromChunk, fromRow);
+	slot.archetype = to;
+	slot.chunk = toChunk;
+	slot.row = toRow;
+}
+
+void World::reportRemovingLastComponent(EntityHandle entity)
+{
+	std::cout << "ERROR::WORLD::REMOVING_LAST_COMPONENT of entity " << entity.index << ", destroy it instead" << std::endl;
+}
+
+void World::destroy(EntityHandle entity)
+{
+	if (!isAlive(entity))
+		return;
+	Slot& slot = slots[entity.index];
+	removeRow(slot.archetype, slot.chunk, slot.row);
+	slot.archetype = NO_ARCHETYPE;
+	slot.generation++;
+	freeSlots.push_back(entity.index);
+	aliveCount--;
+}
+
+size_t World::chunkCount() const
+{
+	size_t count = 0;
+	for (const Archetype& archetype : archetypes)
+		count += archetype.chunks.size();
+	return count;
+}
@@ -0,0 +1,232 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// Refers to an entity in a World. The index is reused once the entity is destroyed, the
+// generation isn't, so a handle kept around after destroy() stops resolving instead of
+// silently pointing at whatever took the slot.
+struct EntityHandle
+{
+	uint32_t index = UINT32_MAX;
+	uint32_t generation = 0;
+
+	bool operator==(const EntityHandle& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const EntityHandle& other) const { return !(*this == other); }
+};
+
+// One bit per component type
+typedef uint64_t ComponentMask;
+
+// Entity-component storage grouped by archetype, the set of component types an entity has.
+// Every archetype keeps its entities in fixed size chunks, and inside a chunk each component
+// type is its own tightly packed array (structure of arrays). A system asking for Position and
+// Rotation gets two arrays per chunk and walks them front to back, nothing else it doesn't
+// read comes through the cache.
+//
+// Components are plain structs that get moved around with memcpy: trivially copyable, at most
+// 16 byte aligned, and nothing that owns memory. Adding or removing a component moves the
+// entity to another archetype, destroying one moves the archetype's last entity into its row.
+// Both invalidate component pointers, so don't change the structure of the World from inside
+// eachChunk()/each(), and re-get() pointers afterwards.
+//
+// Not thread safe. Systems can split the chunks of a query over a ThreadPool themselves.
+class World
+{
+public:
+	static const unsigned int MAX_COMPONENT_TYPES = 64;
+	static const size_t CHUNK_SIZE = 16 * 1024;
+	static const size_t COLUMN_ALIGNMENT = 16;
+
+	World() = default;
+	World(const World&) = delete;
+	World& operator=(const World&) = delete;
+
+	template<typename... Components>
+	EntityHandle create(const Components&... components)
+	{
+		static_assert(sizeof...(Components) > 0, "an entity needs at least one component");
+		ComponentMask mask = maskOf<Components...>();
+		uint32_t archetypeIndex = findOrCreateArchetype(mask);
+		EntityHandle entity = allocateHandle();
+		Slot& slot = slots[entity.index];
+		slot.archetype = archetypeIndex;
+		allocateRow(archetypeIndex, entity, slot.chunk, slot.row);
+		Archetype& archetype = archetypes[archetypeIndex];
+		Chunk& chunk = archetype.chunks[slot.chunk];
+		int expand[] = { 0, (std::memcpy(column<Components>(archetype, chunk) + slot.row, &components, sizeof(Components)), 0)... };
+		(void)expand;
+		return entity;
+	}
+
+	void destroy(EntityHandle entity);
+	bool isAlive(EntityHandle entity) const
+	{
+		return entity.index < slots.size() && slots[entity.index].generation == entity.generation && slots[entity.index].archetype != NO_ARCHETYPE;
+	}
+
+	// nullptr if the entity is gone or doesn't have the component
+	template<typename T>
+	T* get(EntityHandle entity)
+	{
+		if (!isAlive(entity))
+			return nullptr;
+		const Slot& slot = slots[entity.index];
+		Archetype& archetype = archetypes[slot.archetype];
+		if (!(archetype.mask & maskOf<T>()))
+			return nullptr;
+		return column<T>(archetype, archetype.chunks[slot.chunk]) + slot.row;
+	}
+
+	template<typename T>
+	bool has(EntityHandle entity) const
+	{
+		return isAlive(entity) && (archetypes[slots[entity.index].archetype].mask & maskOf<T>()) != 0;
+	}
+
+	// Overwrites the component if the entity already has one
+	template<typename T>
+	void add(EntityHandle entity, const T& component)
+	{
+		if (!isAlive(entity))
+			return;
+		ComponentMask mask = archetypes[slots[entity.index].archetype].mask;
+		if (!(mask & maskOf<T>()))
+			moveToArchetype(entity, mask | maskOf<T>());
+		*get<T>(entity) = component;
+	}
+
+	// Entities can't be left without components: removing the only one is logged and ignored,
+	// destroy() the entity instead
+	template<typename T>
+	void remove(EntityHandle entity)
+	{
+		if (!isAlive(entity))
+			return;
+		ComponentMask mask = archetypes[slots[entity.index].archetype].mask;
+		if (mask == maskOf<T>())
+			reportRemovingLastComponent(entity);
+		else if (mask & maskOf<T>())
+			moveToArchetype(entity, mask & ~maskOf<T>());
+	}
+
+	// Calls function(count, Components*...) for every non-empty chunk whose entities have all of
+	// Components and none of exclude. The arrays run in parallel: index i in each is entity i of
+	// the chunk. Chunks come in a fixed order (archetypes by creation, then chunks) until the
+	// structure of the World changes, so two queries can line up their results by position.
+	template<typename... Components, typename Function>
+	void eachChunk(Function function, ComponentMask exclude = 0)
+	{
+		ComponentMask required = maskOf<Components...>();
+		for (Archetype& archetype : archetypes)
+		{
+			if ((archetype.mask & required) != required || (archetype.mask & exclude) != 0)
+				continue;
+			for (Chunk& chunk : archetype.chunks)
+			{
+				if (chunk.count > 0)
+					function((size_t)chunk.count, column<Components>(archetype, chunk)...);
+			}
+		}
+	}
+
+	// Same query, one function(Components&...) call per entity
+	template<typename... Components, typename Function>
+	void each(Function function, ComponentMask exclude = 0)
+	{
+		eachChunk<Components...>([&](size_t count, Components*... arrays)
+			{
+				for (size_t i = 0; i < count; i++)
+					function(arrays[i]...);
+			}, exclude);
+	}
+
+	template<typename... Components>
+	static ComponentMask maskOf()
+	{
+		ComponentMask mask = 0;
+		int expand[] = { 0, (mask |= ComponentMask(1) << componentId<Components>(), 0)... };
+		(void)expand;
+		return mask;
+	}
+
+	// Number of live entities
+	size_t size() const { return aliveCount; }
+	size_t archetypeCount() const { return archetypes.size(); }
+	size_t chunkCount() const;
+
+private:
+	static const uint32_t NO_ARCHETYPE = UINT32_MAX;
+
+	struct Chunk
+	{
+		std::unique_ptr<unsigned char[]> data;
+		uint32_t count = 0;
+	};
+
+	struct Archetype
+	{
+		ComponentMask mask = 0;
+		// Component ids in ascending order, and their sizes
+		std::vector<unsigned int> components;
+		std::vector<uint32_t> sizes;
+		// Byte offset of each component's array inside a chunk, by component id. The entity
+		// handles come last, so a row can be traced back to its slot.
+		uint32_t offsets[MAX_COMPONENT_TYPES] = {};
+		uint32_t handleOffset = 0;
+		uint32_t capacity = 0;
+		std::vector<Chunk> chunks;
+	};
+
+	struct Slot
+	{
+		uint32_t generation = 0;
+		uint32_t archetype = NO_ARCHETYPE;
+		uint32_t chunk = 0;
+		uint32_t row = 0;
+	};
+
+	std::vector<Archetype> archetypes;
+	std::unordered_map<ComponentMask, uint32_t> archetypeLookup;
+	std::vector<Slot> slots;
+	std::vector<uint32_t> freeSlots;
+	size_t aliveCount = 0;
+
+	// Ids are handed out the first time a type is used and shared by every World.
+	// Register each type from one thread first (creating an entity with it does).
+	template<typename T>
+	static unsigned int componentId()
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "components are moved with memcpy");
+		static_assert(alignof(T) <= COLUMN_ALIGNMENT, "components can be at most 16 byte aligned");
+		static const unsigned int id = registerComponent(sizeof(T));
+		return id;
+	}
+	static unsigned int registerComponent(size_t size);
+	// By component id
+	static std::vector<size_t>& componentSizes();
+
+	template<typename T>
+	static T* column(Archetype& archetype, Chunk& chunk)
+	{
+		return reinterpret_cast<T*>(chunk.data.get() + archetype.offsets[componentId<T>()]);
+	}
+	static EntityHandle* handles(Archetype& archetype, Chunk& chunk)
+	{
+		return reinterpret_cast<EntityHandle*>(chunk.data.get() + archetype.handleOffset);
+	}
+
+	uint32_t findOrCreateArchetype(ComponentMask mask);
+	EntityHandle allocateHandle();
+	// Appends a row with uninitialized components to the archetype's last chunk
+	void allocateRow(uint32_t archetypeIndex, EntityHandle entity, uint32_t& chunkIndex, uint32_t& row);
+	// Fills the hole with the archetype's last row, so only the last chunk is ever partly full
+	void removeRow(uint32_t archetypeIndex, uint32_t chunkIndex, uint32_t row);
+	// Copies the components both archetypes have, the new ones are left uninitialized
+	void moveToArchetype(EntityHandle entity, ComponentMask mask);
+	static void reportRemovingLastComponent(EntityHandle entity);
+};
@@ -0,0 +1,93 @@
+// Offline mesh converter. Turns every input OBJ or glTF into a binary mesh file (see src/mesh_file.h)
+// next to it as <name>.mesh, optimized, encoded and split into meshlets so loading it is a
+// memory map. With -r the LOD chain is simplified and stored in the same file.
+//
+// Usage: convert_mesh [-q] [-r 0.5,0.25,0.125] input.obj|.gltf|.glb [more ...]
+//   -q  store quantized vertices (VERTEX_FORMAT_QUANTIZED) instead of floats
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "mesh_file.h"
+#include "mesh_importer.h"
+#include "mesh_simplifier.h"
+#include "thread_pool.h"
+
+static std::vector<float> parseRatios(const std::string& text)
+{
+	std::vector<float> ratios;
+	std::stringstream stream(text);
+	std::string item;
+	while (std::getline(stream, item, ','))
+		ratios.push_back((float)std::atof(item.c_str()));
+	return ratios;
+}
+
+static std::string meshPath(const std::string& input)
+{
+	size_t dot = input.find_last_of('.');
+	std::string stem = dot == std::string::npos ? input : input.substr(0, dot);
+	return stem + ".mesh";
+}
+
+int main(int argc, char** argv)
+{
+	VertexFormat format = VERTEX_FORMAT_POSITION_UV;
+	std::vector<float> ratios;
+	std::vector<std::string> inputs;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "-q")
+			format = VERTEX_FORMAT_QUANTIZED;
+		else if (argument == "-r" && i + 1 < argc)
+			ratios = parseRatios(argv[++i]);
+		else
+			inputs.push_back(argument);
+	}
+	if (inputs.empty())
+	{
+		std::cout << "Usage: convert_mesh [-q] [-r 0.5,0.25,0.125] input.obj|.gltf|.glb [more ...]" << std::endl;
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	ThreadPool threadPool;
+	std::vector<MeshData> meshes(inputs.size());
+	for (size_t i = 0; i < inputs.size(); i++)
+	{
+		if (!importMesh(inputs[i], meshes[i], &threadPool))
+			return 1;
+	}
+
+	std::vector<std::vector<SimplifiedMesh>> chains(meshes.size());
+	if (!ratios.empty())
+		chains = MeshSimplifier::buildLodChains(meshes, ratios, threadPool);
+
+	int result = 0;
+	for (size_t i = 0; i < inputs.size(); i++)
+	{
+		// Quantized levels share the full detail bounds, so they line up exactly
+		MeshBounds bounds = computeMeshBounds(meshes[i].positions);
+		std::vector<CookedLod> lods;
+		lods.push_back(MeshFile::cook(meshes[i], format, bounds.min, bounds.max, 0.0f));
+		for (const SimplifiedMesh& level : chains[i])
+			lods.push_back(MeshFile::cook(level.mesh, format, bounds.min, bounds.max, level.error));
+
+		std::string path = meshPath(inputs[i]);
+		if (!MeshFile::write(path, format, bounds, lods))
+		{
+			result = 1;
+			continue;
+		}
+		std::cout << inputs[i] << " -> " << path << ": " << lods.size() << " levels, " << meshes[i].triangleCount() << " triangles, "
+			<< vertexStride(format) << " bytes/vertex" << std::endl;
+	}
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Converted " << inputs.size() << " meshes in " << milliseconds << " ms" << std::endl;
+	return result;
+}
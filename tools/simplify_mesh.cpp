@@ -0,0 +1,82 @@
+// Offline LOD generator. Simplifies every input OBJ to each target ratio and writes the levels
+// next to it as <name>_lod1.obj, <name>_lod2.obj, ... together with the error to pass to Model::addLod.
+//
+// Usage: simplify_mesh [-r 0.5,0.25,0.125] input.obj [more.obj ...]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "mesh_simplifier.h"
+#include "obj_file.h"
+#include "thread_pool.h"
+
+static std::vector<float> parseRatios(const std::string& text)
+{
+	std::vector<float> ratios;
+	std::stringstream stream(text);
+	std::string item;
+	while (std::getline(stream, item, ','))
+		ratios.push_back((float)std::atof(item.c_str()));
+	return ratios;
+}
+
+static std::string lodPath(const std::string& input, size_t level)
+{
+	size_t dot = input.find_last_of('.');
+	std::string stem = dot == std::string::npos ? input : input.substr(0, dot);
+	return stem + "_lod" + std::to_string(level) + ".obj";
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<float> ratios = { 0.5f, 0.25f, 0.125f };
+	std::vector<std::string> inputs;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "-r" && i + 1 < argc)
+			ratios = parseRatios(argv[++i]);
+		else
+			inputs.push_back(argument);
+	}
+	if (inputs.empty() || ratios.empty())
+	{
+		std::cout << "Usage: simplify_mesh [-r 0.5,0.25,0.125] input.obj [more.obj ...]" << std::endl;
+		return 1;
+	}
+
+	ThreadPool threadPool;
+	std::vector<MeshData> meshes(inputs.size());
+	for (size_t i = 0; i < inputs.size(); i++)
+	{
+		if (!loadObj(inputs[i], meshes[i], &threadPool))
+			return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::vector<SimplifiedMesh>> chains = MeshSimplifier::buildLodChains(meshes, ratios, threadPool);
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	int result = 0;
+	for (size_t i = 0; i < inputs.size(); i++)
+	{
+		std::cout << inputs[i] << ": " << meshes[i].triangleCount() << " triangles" << std::endl;
+		for (size_t level = 0; level < chains[i].size(); level++)
+		{
+			const SimplifiedMesh& lod = chains[i][level];
+			std::string path = lodPath(inputs[i], level + 1);
+			if (!saveObj(path, lod.mesh))
+				result = 1;
+
+			float achieved = meshes[i].triangleCount() ? (float)lod.mesh.triangleCount() / meshes[i].triangleCount() : 0.0f;
+			std::cout << "  " << path << ": target " << ratios[level] << ", " << lod.mesh.triangleCount() << " triangles ("
+				<< achieved << "), error " << lod.error << std::endl;
+		}
+	}
+	std::cout << "Simplified " << inputs.size() << " meshes on " << threadPool.threadCount() + 1 << " threads in " << milliseconds << " ms" << std::endl;
+	return result;
+}